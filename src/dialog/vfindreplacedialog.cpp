@@ -31,6 +31,7 @@ void VFindReplaceDialog::setupUI()
     m_findNextBtn->setDefault(true);
     m_findPrevBtn = new QPushButton(tr("Find &Previous"));
     m_findPrevBtn->setProperty("FlatBtn", true);
+    m_matchLabel = new QLabel();
 
     // Replace
     QLabel *replaceLabel = new QLabel(tr("&Replace with:"));
@@ -66,6 +67,7 @@ void VFindReplaceDialog::setupUI()
     gridLayout->addWidget(m_findEdit, 0, 1);
     gridLayout->addWidget(m_findNextBtn, 0, 2);
     gridLayout->addWidget(m_findPrevBtn, 0, 3);
+    gridLayout->addWidget(m_matchLabel, 0, 4, 1, 2);
     gridLayout->addWidget(replaceLabel, 1, 0);
     gridLayout->addWidget(m_replaceEdit, 1, 1);
     gridLayout->addWidget(m_replaceBtn, 1, 2);
@@ -187,9 +189,26 @@ void VFindReplaceDialog::openDialog(QString p_text)
 
 void VFindReplaceDialog::handleFindTextChanged(const QString &p_text)
 {
+    if (p_text.isEmpty()) {
+        m_matchLabel->clear();
+    }
+
     emit findTextChanged(p_text, m_options);
 }
 
+void VFindReplaceDialog::updateMatchCount(int p_index, int p_count)
+{
+    if (p_count < 0 || m_findEdit->text().isEmpty()) {
+        m_matchLabel->clear();
+    } else if (p_count == 0) {
+        m_matchLabel->setText(tr("No match"));
+    } else if (p_index > 0) {
+        m_matchLabel->setText(tr("Match %1 of %2").arg(p_index).arg(p_count));
+    } else {
+        m_matchLabel->setText(tr("%1 matches").arg(p_count));
+    }
+}
+
 void VFindReplaceDialog::advancedBtnToggled(bool p_checked)
 {
     if (p_checked) {
@@ -8,6 +8,7 @@
 class QLineEdit;
 class QPushButton;
 class QCheckBox;
+class QLabel;
 
 enum FindOption
 {
@@ -27,6 +28,9 @@ public:
     // edit tab.
     void updateState(DocType p_docType, bool p_editMode);
 
+    // Show "match @p_index of @p_count". Clear it if @p_count is -1.
+    void updateMatchCount(int p_index, int p_count);
+
 signals:
     void dialogClosed();
     void findTextChanged(const QString &p_text, uint p_options);
@@ -62,6 +66,7 @@ private:
 
     QLineEdit *m_findEdit;
     QLineEdit *m_replaceEdit;
+    QLabel *m_matchLabel;
     QPushButton *m_findNextBtn;
     QPushButton *m_findPrevBtn;
     QPushButton *m_replaceBtn;
@@ -0,0 +1,148 @@
+#include <QtWidgets>
+#include "vsearchdialog.h"
+#include "vsearchengine.h"
+
+VSearchDialog::VSearchDialog(VSearchEngine *p_engine, QWidget *p_parent)
+    : QDialog(p_parent), m_engine(p_engine)
+{
+    m_searchTimer = new QTimer(this);
+    m_searchTimer->setSingleShot(true);
+    m_searchTimer->setInterval(300);
+    connect(m_searchTimer, &QTimer::timeout,
+            this, &VSearchDialog::startSearch);
+
+    setupUI();
+
+    connect(m_engine, &VSearchEngine::searchFinished,
+            this, &VSearchDialog::handleSearchFinished);
+    connect(m_engine, &VSearchEngine::indexingProgress,
+            this, &VSearchDialog::handleIndexingProgress);
+    connect(m_engine, &VSearchEngine::indexingFinished,
+            this, &VSearchDialog::handleIndexingFinished);
+}
+
+void VSearchDialog::setupUI()
+{
+    m_queryEdit = new QLineEdit();
+    m_queryEdit->setPlaceholderText(tr("word \"some phrase\" pref* -exclude OR other"));
+    connect(m_queryEdit, &QLineEdit::textChanged,
+            m_searchTimer, static_cast<void (QTimer::*)()>(&QTimer::start));
+    connect(m_queryEdit, &QLineEdit::returnPressed,
+            this, &VSearchDialog::startSearch);
+
+    m_rebuildBtn = new QPushButton(tr("&Rebuild Index"));
+    m_rebuildBtn->setToolTip(tr("Rebuild the search index of all the notebooks"));
+    connect(m_rebuildBtn, &QPushButton::clicked,
+            this, &VSearchDialog::rebuildIndex);
+
+    QHBoxLayout *inputLayout = new QHBoxLayout();
+    inputLayout->addWidget(new QLabel(tr("Search:")));
+    inputLayout->addWidget(m_queryEdit);
+    inputLayout->addWidget(m_rebuildBtn);
+
+    m_resultTree = new QTreeWidget();
+    m_resultTree->setHeaderHidden(true);
+    m_resultTree->setColumnCount(1);
+    connect(m_resultTree, &QTreeWidget::itemActivated,
+            this, &VSearchDialog::handleItemActivated);
+
+    m_statusLabel = new QLabel();
+
+    QVBoxLayout *mainLayout = new QVBoxLayout();
+    mainLayout->addLayout(inputLayout);
+    mainLayout->addWidget(m_resultTree);
+    mainLayout->addWidget(m_statusLabel);
+
+    setLayout(mainLayout);
+    setModal(false);
+    resize(600, 500);
+    setWindowTitle(tr("Search Notebooks"));
+}
+
+void VSearchDialog::openDialog()
+{
+    show();
+    raise();
+    activateWindow();
+    m_queryEdit->setFocus();
+    m_queryEdit->selectAll();
+}
+
+void VSearchDialog::startSearch()
+{
+    m_searchTimer->stop();
+
+    QString query = m_queryEdit->text().trimmed();
+    if (query.isEmpty()) {
+        m_resultTree->clear();
+        m_statusLabel->clear();
+        return;
+    }
+
+    m_statusLabel->setText(tr("Searching..."));
+    m_engine->search(query);
+}
+
+void VSearchDialog::handleSearchFinished(const QString &p_query,
+                                         const QVector<VSearchResult> &p_results,
+                                         qint64 p_elapsed)
+{
+    if (p_query != m_queryEdit->text().trimmed()) {
+        return;
+    }
+
+    m_resultTree->clear();
+    for (auto const &result : p_results) {
+        QTreeWidgetItem *fileItem = new QTreeWidgetItem(m_resultTree);
+        fileItem->setText(0, QString("%1 (%2)").arg(QFileInfo(result.m_filePath).fileName())
+                                               .arg(result.m_matches.size()));
+        fileItem->setToolTip(0, result.m_filePath);
+        fileItem->setData(0, Qt::UserRole, result.m_filePath);
+        fileItem->setData(0, Qt::UserRole + 1, -1);
+
+        for (auto const &match : result.m_matches) {
+            QTreeWidgetItem *lineItem = new QTreeWidgetItem(fileItem);
+            lineItem->setText(0, QString("%1: %2").arg(match.m_lineNumber + 1)
+                                                  .arg(match.m_text));
+            lineItem->setData(0, Qt::UserRole, result.m_filePath);
+            lineItem->setData(0, Qt::UserRole + 1, match.m_lineNumber);
+        }
+    }
+
+    m_resultTree->expandAll();
+    m_statusLabel->setText(tr("%1 notes found in %2 ms").arg(p_results.size()).arg(p_elapsed));
+}
+
+void VSearchDialog::rebuildIndex()
+{
+    if (m_engine->rebuildIndex()) {
+        m_rebuildBtn->setEnabled(false);
+        m_statusLabel->setText(tr("Indexing..."));
+    }
+}
+
+void VSearchDialog::handleIndexingProgress(int p_value)
+{
+    m_statusLabel->setText(tr("Indexing %1 notes...").arg(p_value));
+}
+
+void VSearchDialog::handleIndexingFinished(bool p_succeed, const VNotebookScanner::Stats &p_stats)
+{
+    m_rebuildBtn->setEnabled(true);
+    if (p_succeed) {
+        m_statusLabel->setText(tr("Index rebuilt: %1 notes in %2 ms (%3 files/s, %4 MB/s)")
+                                 .arg(p_stats.m_files)
+                                 .arg(p_stats.m_elapsed)
+                                 .arg(p_stats.filesPerSecond(), 0, 'f', 0)
+                                 .arg(p_stats.mbPerSecond(), 0, 'f', 1));
+        startSearch();
+    } else {
+        m_statusLabel->setText(tr("Fail to rebuild index"));
+    }
+}
+
+void VSearchDialog::handleItemActivated(QTreeWidgetItem *p_item, int /* p_column */)
+{
+    emit resultActivated(p_item->data(0, Qt::UserRole).toString(),
+                         p_item->data(0, Qt::UserRole + 1).toInt());
+}
@@ -0,0 +1,60 @@
+#ifndef VSEARCHDIALOG_H
+#define VSEARCHDIALOG_H
+
+#include <QDialog>
+#include <QString>
+#include <QVector>
+#include "vsearchindex.h"
+
+class QLineEdit;
+class QPushButton;
+class QLabel;
+class QTreeWidget;
+class QTreeWidgetItem;
+class QTimer;
+class VSearchEngine;
+
+// Non-modal dialog to search all the notebooks.
+class VSearchDialog : public QDialog
+{
+    Q_OBJECT
+public:
+    VSearchDialog(VSearchEngine *p_engine, QWidget *p_parent = 0);
+
+    // Show the dialog and focus the search input.
+    void openDialog();
+
+signals:
+    // Request to open @p_filePath at line @p_lineNumber (-1 for none).
+    void resultActivated(const QString &p_filePath, int p_lineNumber);
+
+private slots:
+    void startSearch();
+
+    void handleSearchFinished(const QString &p_query,
+                              const QVector<VSearchResult> &p_results,
+                              qint64 p_elapsed);
+
+    void rebuildIndex();
+
+    void handleIndexingProgress(int p_value);
+
+    void handleIndexingFinished(bool p_succeed, const VNotebookScanner::Stats &p_stats);
+
+    void handleItemActivated(QTreeWidgetItem *p_item, int p_column);
+
+private:
+    void setupUI();
+
+    VSearchEngine *m_engine;
+
+    QLineEdit *m_queryEdit;
+    QPushButton *m_rebuildBtn;
+    QLabel *m_statusLabel;
+    QTreeWidget *m_resultTree;
+
+    // Search after user stops typing.
+    QTimer *m_searchTimer;
+};
+
+#endif // VSEARCHDIALOG_H
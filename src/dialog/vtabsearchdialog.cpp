@@ -0,0 +1,289 @@
+#include <QtWidgets>
+#include <QtConcurrent>
+#include "vtabsearchdialog.h"
+#include "veditarea.h"
+#include "vedittab.h"
+#include "vfindreplacedialog.h"
+#include "utils/vtextmatcher.h"
+
+const int VTabSearchDialog::c_maxLinesPerTab = 100;
+
+// Search a tab snapshot. Used by QtConcurrent::mapped().
+struct VTabSearcher
+{
+    typedef VTabSearchResult result_type;
+
+    VTabSearcher(const VTextMatcher &p_matcher, const QAtomicInt *p_cancel, int p_maxLines)
+        : m_matcher(p_matcher), m_cancel(p_cancel), m_maxLines(p_maxLines)
+    {
+    }
+
+    VTabSearchResult operator()(const VTabSnapshot &p_snapshot) const
+    {
+        VTabSearchResult result;
+        result.m_tabIndex = p_snapshot.m_tabIndex;
+
+        const QString &content = p_snapshot.m_content;
+        VTextMatches matches;
+        m_matcher.findAll(content, matches, 0, m_cancel);
+        result.m_nrMatches = matches.size();
+
+        // Map the matches to lines in one pass.
+        int lineNum = 0;
+        int lineStart = 0;
+        for (int i = 0; i < matches.size() && result.m_lines.size() < m_maxLines; ++i) {
+            int pos = matches.position(i);
+            int lineEnd = content.indexOf('\n', lineStart);
+            while (lineEnd != -1 && lineEnd < pos) {
+                lineStart = lineEnd + 1;
+                ++lineNum;
+                lineEnd = content.indexOf('\n', lineStart);
+            }
+
+            if (!result.m_lines.isEmpty() && result.m_lines.last().m_lineNumber == lineNum) {
+                continue;
+            }
+
+            if (lineEnd == -1) {
+                lineEnd = content.size();
+            }
+
+            result.m_lines.append(VSearchMatch(lineNum,
+                                               content.mid(lineStart, lineEnd - lineStart).trimmed()));
+        }
+
+        return result;
+    }
+
+    VTextMatcher m_matcher;
+    const QAtomicInt *m_cancel;
+    int m_maxLines;
+};
+
+VTabSearchDialog::VTabSearchDialog(VEditArea *p_editArea, QWidget *p_parent)
+    : QDialog(p_parent), m_editArea(p_editArea), m_cancel(0),
+      m_hasPendingSearch(false)
+{
+    m_searchTimer = new QTimer(this);
+    m_searchTimer->setSingleShot(true);
+    m_searchTimer->setInterval(300);
+    connect(m_searchTimer, &QTimer::timeout,
+            this, &VTabSearchDialog::startSearch);
+
+    m_searchWatcher = new QFutureWatcher<VTabSearchResult>(this);
+    connect(m_searchWatcher, &QFutureWatcher<VTabSearchResult>::finished,
+            this, &VTabSearchDialog::handleSearchFinished);
+
+    setupUI();
+}
+
+VTabSearchDialog::~VTabSearchDialog()
+{
+    m_cancel.store(1);
+    m_searchWatcher->waitForFinished();
+}
+
+void VTabSearchDialog::setupUI()
+{
+    m_queryEdit = new QLineEdit();
+    m_queryEdit->setPlaceholderText(tr("Enter text to search"));
+    connect(m_queryEdit, &QLineEdit::textChanged,
+            m_searchTimer, static_cast<void (QTimer::*)()>(&QTimer::start));
+    connect(m_queryEdit, &QLineEdit::returnPressed,
+            this, &VTabSearchDialog::startSearch);
+
+    m_cancelBtn = new QPushButton(tr("&Cancel"));
+    m_cancelBtn->setToolTip(tr("Cancel the running search"));
+    m_cancelBtn->setEnabled(false);
+    connect(m_cancelBtn, &QPushButton::clicked,
+            this, &VTabSearchDialog::cancelSearch);
+
+    QHBoxLayout *inputLayout = new QHBoxLayout();
+    inputLayout->addWidget(new QLabel(tr("Search:")));
+    inputLayout->addWidget(m_queryEdit);
+    inputLayout->addWidget(m_cancelBtn);
+
+    m_caseSensitiveCheck = new QCheckBox(tr("Case sensitive"));
+    m_wholeWordOnlyCheck = new QCheckBox(tr("Whole word only"));
+    m_regularExpressionCheck = new QCheckBox(tr("Regular expression"));
+    connect(m_caseSensitiveCheck, &QCheckBox::stateChanged,
+            this, &VTabSearchDialog::startSearch);
+    connect(m_wholeWordOnlyCheck, &QCheckBox::stateChanged,
+            this, &VTabSearchDialog::startSearch);
+    connect(m_regularExpressionCheck, &QCheckBox::stateChanged,
+            this, &VTabSearchDialog::startSearch);
+
+    QHBoxLayout *optionLayout = new QHBoxLayout();
+    optionLayout->addWidget(m_caseSensitiveCheck);
+    optionLayout->addWidget(m_wholeWordOnlyCheck);
+    optionLayout->addWidget(m_regularExpressionCheck);
+    optionLayout->addStretch();
+
+    m_resultTree = new QTreeWidget();
+    m_resultTree->setHeaderHidden(true);
+    m_resultTree->setColumnCount(1);
+    connect(m_resultTree, &QTreeWidget::itemActivated,
+            this, &VTabSearchDialog::handleItemActivated);
+
+    m_statusLabel = new QLabel();
+
+    QVBoxLayout *mainLayout = new QVBoxLayout();
+    mainLayout->addLayout(inputLayout);
+    mainLayout->addLayout(optionLayout);
+    mainLayout->addWidget(m_resultTree);
+    mainLayout->addWidget(m_statusLabel);
+
+    setLayout(mainLayout);
+    setModal(false);
+    resize(600, 500);
+    setWindowTitle(tr("Search Opened Notes"));
+}
+
+void VTabSearchDialog::openDialog(const QString &p_text)
+{
+    show();
+    raise();
+    activateWindow();
+    if (!p_text.isEmpty()) {
+        m_queryEdit->setText(p_text);
+    }
+
+    m_queryEdit->setFocus();
+    m_queryEdit->selectAll();
+}
+
+uint VTabSearchDialog::currentOptions() const
+{
+    uint options = 0;
+    if (m_caseSensitiveCheck->isChecked()) {
+        options |= FindOption::CaseSensitive;
+    }
+
+    if (m_wholeWordOnlyCheck->isChecked()) {
+        options |= FindOption::WholeWordOnly;
+    }
+
+    if (m_regularExpressionCheck->isChecked()) {
+        options |= FindOption::RegularExpression;
+    }
+
+    return options;
+}
+
+void VTabSearchDialog::startSearch()
+{
+    m_searchTimer->stop();
+
+    if (m_searchWatcher->isRunning()) {
+        // Search again after the superseded one stops.
+        m_cancel.store(1);
+        m_hasPendingSearch = true;
+        return;
+    }
+
+    m_hasPendingSearch = false;
+    m_resultTree->clear();
+    m_tabs.clear();
+
+    QString query = m_queryEdit->text();
+    if (query.isEmpty()) {
+        m_statusLabel->clear();
+        return;
+    }
+
+    VTextMatcher matcher(query, currentOptions());
+    if (!matcher.isValid()) {
+        m_statusLabel->setText(tr("Invalid regular expression"));
+        return;
+    }
+
+    // Take the snapshots in GUI thread.
+    QVector<VEditTab *> tabs = m_editArea->getAllTabs();
+    QList<VTabSnapshot> snapshots;
+    for (int i = 0; i < tabs.size(); ++i) {
+        m_tabs.append(tabs[i]);
+
+        VTabSnapshot snapshot;
+        snapshot.m_tabIndex = i;
+        snapshot.m_content = tabs[i]->getContent();
+        snapshots.append(snapshot);
+    }
+
+    m_cancel.store(0);
+    m_cancelBtn->setEnabled(true);
+    m_statusLabel->setText(tr("Searching..."));
+    m_elapsedTimer.start();
+    m_searchWatcher->setFuture(QtConcurrent::mapped(snapshots,
+                                                    VTabSearcher(matcher, &m_cancel, c_maxLinesPerTab)));
+}
+
+void VTabSearchDialog::cancelSearch()
+{
+    m_searchTimer->stop();
+    m_hasPendingSearch = false;
+    if (m_searchWatcher->isRunning()) {
+        m_cancel.store(1);
+    }
+}
+
+void VTabSearchDialog::handleSearchFinished()
+{
+    m_cancelBtn->setEnabled(false);
+
+    if (m_hasPendingSearch) {
+        // Drop the stale results.
+        startSearch();
+        return;
+    }
+
+    if (m_cancel.load()) {
+        m_statusLabel->setText(tr("Search cancelled"));
+        return;
+    }
+
+    int nrMatches = 0;
+    int nrTabs = 0;
+    QList<VTabSearchResult> results = m_searchWatcher->future().results();
+    for (auto const &result : results) {
+        VEditTab *tab = m_tabs.value(result.m_tabIndex);
+        if (result.m_nrMatches == 0 || !tab || !tab->getFile()) {
+            continue;
+        }
+
+        VFile *file = tab->getFile();
+        QTreeWidgetItem *tabItem = new QTreeWidgetItem(m_resultTree);
+        tabItem->setText(0, QString("%1 (%2)").arg(file->getName()).arg(result.m_nrMatches));
+        tabItem->setToolTip(0, file->retrivePath());
+        tabItem->setData(0, Qt::UserRole, result.m_tabIndex);
+        tabItem->setData(0, Qt::UserRole + 1, -1);
+
+        for (auto const &line : result.m_lines) {
+            QTreeWidgetItem *lineItem = new QTreeWidgetItem(tabItem);
+            lineItem->setText(0, QString("%1: %2").arg(line.m_lineNumber + 1)
+                                                  .arg(line.m_text));
+            lineItem->setData(0, Qt::UserRole, result.m_tabIndex);
+            lineItem->setData(0, Qt::UserRole + 1, line.m_lineNumber);
+        }
+
+        ++nrTabs;
+        nrMatches += result.m_nrMatches;
+    }
+
+    m_resultTree->expandAll();
+    m_statusLabel->setText(tr("%1 matches in %2 of %3 opened notes in %4 ms")
+                             .arg(nrMatches)
+                             .arg(nrTabs)
+                             .arg(m_tabs.size())
+                             .arg(m_elapsedTimer.elapsed()));
+}
+
+void VTabSearchDialog::handleItemActivated(QTreeWidgetItem *p_item, int /* p_column */)
+{
+    VEditTab *tab = m_tabs.value(p_item->data(0, Qt::UserRole).toInt());
+    if (!tab || !m_editArea->locateTab(tab)) {
+        m_statusLabel->setText(tr("The note has been closed"));
+        return;
+    }
+
+    tab->scrollToLine(p_item->data(0, Qt::UserRole + 1).toInt());
+}
@@ -0,0 +1,105 @@
+#ifndef VTABSEARCHDIALOG_H
+#define VTABSEARCHDIALOG_H
+
+#include <QDialog>
+#include <QString>
+#include <QVector>
+#include <QPointer>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QFutureWatcher>
+#include "vsearchindex.h"
+
+class QLineEdit;
+class QPushButton;
+class QCheckBox;
+class QLabel;
+class QTreeWidget;
+class QTreeWidgetItem;
+class QTimer;
+class VEditArea;
+class VEditTab;
+
+// Snapshot of the content of an opened tab.
+struct VTabSnapshot
+{
+    // Index in the tabs of the search.
+    int m_tabIndex;
+
+    QString m_content;
+};
+
+// Matches of an opened tab.
+struct VTabSearchResult
+{
+    VTabSearchResult() : m_tabIndex(-1), m_nrMatches(0)
+    {
+    }
+
+    int m_tabIndex;
+
+    int m_nrMatches;
+
+    // Matched lines with context, sorted by line number.
+    QVector<VSearchMatch> m_lines;
+};
+
+// Non-modal dialog to search all the tabs opened in all the split windows.
+// Tabs are searched in parallel over snapshots of their content, including
+// the unsaved changes.
+class VTabSearchDialog : public QDialog
+{
+    Q_OBJECT
+public:
+    VTabSearchDialog(VEditArea *p_editArea, QWidget *p_parent = 0);
+
+    ~VTabSearchDialog();
+
+    // Show the dialog and focus the search input with @p_text.
+    void openDialog(const QString &p_text);
+
+private slots:
+    void startSearch();
+
+    void cancelSearch();
+
+    void handleSearchFinished();
+
+    void handleItemActivated(QTreeWidgetItem *p_item, int p_column);
+
+private:
+    void setupUI();
+
+    // Bit OR of FindOption.
+    uint currentOptions() const;
+
+    VEditArea *m_editArea;
+
+    QLineEdit *m_queryEdit;
+    QCheckBox *m_caseSensitiveCheck;
+    QCheckBox *m_wholeWordOnlyCheck;
+    QCheckBox *m_regularExpressionCheck;
+    QPushButton *m_cancelBtn;
+    QLabel *m_statusLabel;
+    QTreeWidget *m_resultTree;
+
+    // Search after user stops typing.
+    QTimer *m_searchTimer;
+
+    QFutureWatcher<VTabSearchResult> *m_searchWatcher;
+
+    QAtomicInt m_cancel;
+
+    // Whether to search again after the running search is cancelled.
+    bool m_hasPendingSearch;
+
+    // Tabs of the running or last search.
+    QVector<QPointer<VEditTab> > m_tabs;
+
+    QElapsedTimer m_elapsedTimer;
+
+    // Max number of matched lines to show per tab.
+    static const int c_maxLinesPerTab;
+};
+
+#endif // VTABSEARCHDIALOG_H
@@ -10,6 +10,8 @@ extern VConfigManager vconfig;
 
 const int HGMarkdownHighlighter::initCapacity = 1024;
 
+const int HGMarkdownHighlighter::c_largeFileMarginBlocks = 200;
+
 void HGMarkdownHighlighter::resizeBuffer(int newCap)
 {
     if (newCap == capacity) {
@@ -30,7 +32,9 @@ HGMarkdownHighlighter::HGMarkdownHighlighter(const QVector<HighlightingStyle> &s
                                              QTextDocument *parent)
     : QSyntaxHighlighter(parent), highlightingStyles(styles),
       m_codeBlockStyles(codeBlockStyles), m_numOfCodeBlockHighlightsToRecv(0),
-      parsing(0), waitInterval(waitInterval), content(NULL), capacity(0), result(NULL)
+      parsing(0), waitInterval(waitInterval), content(NULL), capacity(0), result(NULL),
+      m_largeFileMode(false), m_firstVisibleBlock(0), m_lastVisibleBlock(0),
+      m_firstParsedBlock(-1), m_lastParsedBlock(-1)
 {
     codeBlockStartExp = QRegExp(VUtils::c_fencedCodeBlockStartRegExp);
     codeBlockEndExp = QRegExp(VUtils::c_fencedCodeBlockEndRegExp);
@@ -145,7 +149,7 @@ exit:
     highlightChanged();
 }
 
-void HGMarkdownHighlighter::initBlockHighlightFromResult(int nrBlocks)
+void HGMarkdownHighlighter::initBlockHighlightFromResult(int nrBlocks, int p_offset)
 {
     blockHighlights.resize(nrBlocks);
     for (int i = 0; i < blockHighlights.size(); ++i) {
@@ -168,13 +172,15 @@ void HGMarkdownHighlighter::initBlockHighlightFromResult(int nrBlocks)
                 elem_cursor = elem_cursor->next;
                 continue;
             }
-            initBlockHighlihgtOne(elem_cursor->pos, elem_cursor->end, i);
+            initBlockHighlihgtOne(elem_cursor->pos + p_offset,
+                                  elem_cursor->end + p_offset,
+                                  i);
             elem_cursor = elem_cursor->next;
         }
     }
 }
 
-void HGMarkdownHighlighter::initHtmlCommentRegionsFromResult()
+void HGMarkdownHighlighter::initHtmlCommentRegionsFromResult(int p_offset)
 {
     m_commentRegions.clear();
 
@@ -189,7 +195,8 @@ void HGMarkdownHighlighter::initHtmlCommentRegionsFromResult()
             continue;
         }
 
-        m_commentRegions.push_back(VCommentRegion(elem->pos, elem->end));
+        m_commentRegions.push_back(VCommentRegion(elem->pos + p_offset,
+                                                  elem->end + p_offset));
 
         elem = elem->next;
     }
@@ -299,16 +306,21 @@ void HGMarkdownHighlighter::parse()
     }
 
     int nrBlocks = document->blockCount();
-    parseInternal();
+    int offset = 0;
+    if (m_largeFileMode) {
+        parseInternal(fetchTextToParse(offset));
+    } else {
+        parseInternal(document->toPlainText());
+    }
 
     if (highlightingStyles.isEmpty()) {
         qWarning() << "HighlightingStyles is not set";
         return;
     }
 
-    initBlockHighlightFromResult(nrBlocks);
+    initBlockHighlightFromResult(nrBlocks, offset);
 
-    initHtmlCommentRegionsFromResult();
+    initHtmlCommentRegionsFromResult(offset);
 
     if (result) {
         pmh_free_elements(result);
@@ -318,10 +330,33 @@ void HGMarkdownHighlighter::parse()
     parsing.store(0);
 }
 
-void HGMarkdownHighlighter::parseInternal()
+QString HGMarkdownHighlighter::fetchTextToParse(int &p_offset)
 {
-    QString text = document->toPlainText();
-    QByteArray ba = text.toUtf8();
+    int lastBlock = document->blockCount() - 1;
+    m_firstParsedBlock = qBound(0, m_firstVisibleBlock - c_largeFileMarginBlocks, lastBlock);
+    m_lastParsedBlock = qBound(m_firstParsedBlock,
+                               m_lastVisibleBlock + c_largeFileMarginBlocks,
+                               lastBlock);
+
+    QTextBlock block = document->findBlockByNumber(m_firstParsedBlock);
+    p_offset = block.position();
+
+    QString text;
+    for (int i = m_firstParsedBlock; i <= m_lastParsedBlock && block.isValid(); ++i) {
+        if (i > m_firstParsedBlock) {
+            text.append('\n');
+        }
+
+        text.append(block.text());
+        block = block.next();
+    }
+
+    return text;
+}
+
+void HGMarkdownHighlighter::parseInternal(const QString &p_text)
+{
+    QByteArray ba = p_text.toUtf8();
     const char *data = (const char *)ba.data();
    int len = ba.size();
 
@@ -356,13 +391,52 @@ void HGMarkdownHighlighter::handleContentChange(int /* position */, int charsRem
 void HGMarkdownHighlighter::timerTimeout()
 {
     parse();
-    if (!updateCodeBlocks()) {
+    if (m_largeFileMode) {
+        rehighlightParsedBlocks();
+    } else if (!updateCodeBlocks()) {
         rehighlight();
     }
 
     highlightChanged();
 }
 
+void HGMarkdownHighlighter::rehighlightParsedBlocks()
+{
+    QTextBlock block = document->findBlockByNumber(m_firstParsedBlock);
+    for (int i = m_firstParsedBlock; i <= m_lastParsedBlock && block.isValid(); ++i) {
+        rehighlightBlock(block);
+        block = block.next();
+    }
+}
+
+void HGMarkdownHighlighter::setLargeFileMode(bool p_enabled)
+{
+    if (m_largeFileMode == p_enabled) {
+        return;
+    }
+
+    m_largeFileMode = p_enabled;
+    m_codeBlockHighlights.clear();
+    m_numOfCodeBlockHighlightsToRecv = 0;
+    m_firstParsedBlock = m_lastParsedBlock = -1;
+}
+
+void HGMarkdownHighlighter::setVisibleBlockRange(int p_firstBlock, int p_lastBlock)
+{
+    m_firstVisibleBlock = p_firstBlock;
+    m_lastVisibleBlock = p_lastBlock;
+
+    if (!m_largeFileMode) {
+        return;
+    }
+
+    // Parse again if it scrolls out of the parsed range.
+    if ((p_firstBlock < m_firstParsedBlock || p_lastBlock > m_lastParsedBlock)
+        && !timer->isActive()) {
+        timer->start();
+    }
+}
+
 void HGMarkdownHighlighter::updateHighlight()
 {
     timer->stop();
@@ -498,7 +572,7 @@ void HGMarkdownHighlighter::setCodeBlockHighlights(const QList<HLUnitPos> &p_uni
 
 exit:
     --m_numOfCodeBlockHighlightsToRecv;
-    if (m_numOfCodeBlockHighlightsToRecv <= 0) {
+    if (m_numOfCodeBlockHighlightsToRecv <= 0 && !m_largeFileMode) {
         rehighlight();
     }
 }
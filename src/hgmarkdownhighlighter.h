@@ -116,6 +116,14 @@ public:
     // Request to update highlihgt (re-parse and re-highlight)
     void setCodeBlockHighlights(const QList<HLUnitPos> &p_units);
 
+    // In large file mode, only the blocks around the visible range are parsed
+    // and re-highlighted, and code blocks are not highlighted.
+    void setLargeFileMode(bool p_enabled);
+
+    // Blocks [@p_firstBlock, @p_lastBlock] are visible now.
+    // Only used in large file mode.
+    void setVisibleBlockRange(int p_firstBlock, int p_lastBlock);
+
 signals:
     void highlightCompleted();
     void codeBlocksUpdated(const QList<VCodeBlock> &p_codeBlocks);
@@ -164,23 +172,47 @@ private:
     int capacity;
     pmh_element **result;
 
+    bool m_largeFileMode;
+
+    // Visible block range in large file mode.
+    int m_firstVisibleBlock;
+    int m_lastVisibleBlock;
+
+    // Block range parsed last time in large file mode.
+    int m_firstParsedBlock;
+    int m_lastParsedBlock;
+
     static const int initCapacity;
 
+    // Number of blocks to parse above and below the visible range
+    // in large file mode.
+    static const int c_largeFileMarginBlocks;
+
     void resizeBuffer(int newCap);
     void highlightCodeBlock(const QString &text);
     void highlightLinkWithSpacesInURL(const QString &p_text);
     void parse();
-    void parseInternal();
-    void initBlockHighlightFromResult(int nrBlocks);
+
+    // Parse @p_text. Positions in the result are relative to @p_text.
+    void parseInternal(const QString &p_text);
+
+    // @p_offset: the position of the parsed text in document.
+    void initBlockHighlightFromResult(int nrBlocks, int p_offset);
     void initBlockHighlihgtOne(unsigned long pos, unsigned long end,
                                int styleIndex);
 
+    // Text of the blocks around the visible range. Update the parsed range.
+    QString fetchTextToParse(int &p_offset);
+
+    // Re-highlight the blocks parsed last time.
+    void rehighlightParsedBlocks();
+
     // Return true if there are fenced code blocks and it will call rehighlight() later.
     // Return false if there is none.
     bool updateCodeBlocks();
 
     // Fetch all the HTML comment regions from parsing result.
-    void initHtmlCommentRegionsFromResult();
+    void initHtmlCommentRegionsFromResult(int p_offset);
 
     // Whether @p_block is totally inside a HTML comment.
     bool isBlockInsideCommentRegion(const QTextBlock &p_block) const;
@@ -137,5 +137,10 @@ int main(int argc, char *argv[])
 
     w.show();
 
-    return app.exec();
+    int ret = app.exec();
+
+    // Write the pending directory configs.
+    VConfigManager::flushDirectoryConfigs();
+
+    return ret;
 }
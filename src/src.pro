@@ -4,7 +4,7 @@
 #
 #-------------------------------------------------
 
-QT       += core gui webenginewidgets webchannel network svg printsupport
+QT       += core gui webenginewidgets webchannel network svg printsupport concurrent
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 
@@ -70,7 +70,21 @@ SOURCES += main.cpp\
     vvimindicator.cpp \
     vbuttonwithwidget.cpp \
     vtabindicator.cpp \
-    dialog/vupdater.cpp
+    dialog/vupdater.cpp \
+    vunusedimagecollector.cpp \
+    vimagesaver.cpp \
+    utils/vtokenizer.cpp \
+    vsearchindex.cpp \
+    vsearchengine.cpp \
+    dialog/vsearchdialog.cpp \
+    vchangebus.cpp \
+    vnotebookscanner.cpp \
+    vnotebookcache.cpp \
+    vtransferengine.cpp \
+    vfilewatcher.cpp \
+    utils/vtextmatcher.cpp \
+    dialog/vtabsearchdialog.cpp \
+    vundohistory.cpp
 
 HEADERS  += vmainwindow.h \
     vdirectorytree.h \
@@ -128,7 +142,21 @@ HEADERS  += vmainwindow.h \
     vbuttonwithwidget.h \
     vedittabinfo.h \
     vtabindicator.h \
-    dialog/vupdater.h
+    dialog/vupdater.h \
+    vunusedimagecollector.h \
+    vimagesaver.h \
+    utils/vtokenizer.h \
+    vsearchindex.h \
+    vsearchengine.h \
+    dialog/vsearchdialog.h \
+    vchangebus.h \
+    vnotebookscanner.h \
+    vnotebookcache.h \
+    vtransferengine.h \
+    vfilewatcher.h \
+    utils/vtextmatcher.h \
+    dialog/vtabsearchdialog.h \
+    vundohistory.h
 
 RESOURCES += \
     vnote.qrc \
@@ -133,13 +133,6 @@ void VEditUtils::moveCursorFirstNonSpaceCharacter(QTextCursor &p_cursor,
     p_cursor.setPosition(block.position() + idx, p_mode);
 }
 
-void VEditUtils::removeObjectReplacementCharacter(QString &p_text)
-{
-    QRegExp orcBlockExp(QString("[\\n|^][ |\\t]*\\xfffc[ |\\t]*(?=\\n)"));
-    p_text.remove(orcBlockExp);
-    p_text.remove(QChar::ObjectReplacementCharacter);
-}
-
 QString VEditUtils::selectedText(const QTextCursor &p_cursor)
 {
     QString text = p_cursor.selectedText();
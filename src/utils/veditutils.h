@@ -40,11 +40,6 @@ public:
     // Need to call setTextCursor() to make it take effect.
     static bool insertListMarkAsPreviousBlock(QTextCursor &p_cursor);
 
-    // Remove ObjectReplaceCharacter in p_text.
-    // If the ObjectReplaceCharacter is in a block with only other spaces, remove the
-    // whole block.
-    static void removeObjectReplacementCharacter(QString &p_text);
-
     // p_cursor.selectedText() will use U+2029 (QChar::ParagraphSeparator)
     // instead of \n for a new line.
     // This function will translate it to \n.
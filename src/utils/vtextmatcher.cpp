@@ -0,0 +1,232 @@
+#include "vtextmatcher.h"
+
+#include <QDebug>
+#include "dialog/vfindreplacedialog.h"
+
+int VTextMatches::size() const
+{
+    return m_positions.size();
+}
+
+bool VTextMatches::isEmpty() const
+{
+    return m_positions.isEmpty();
+}
+
+void VTextMatches::clear()
+{
+    m_positions.clear();
+    m_lengths.clear();
+}
+
+int VTextMatches::position(int p_idx) const
+{
+    return m_positions[p_idx];
+}
+
+int VTextMatches::length(int p_idx) const
+{
+    return m_lengths[p_idx];
+}
+
+void VTextMatches::append(int p_pos, int p_len)
+{
+    m_positions.append(p_pos);
+    m_lengths.append(p_len);
+}
+
+int VTextMatches::lowerBound(int p_pos) const
+{
+    // Matches do not overlap, so the ends are sorted too.
+    int left = 0, right = m_positions.size();
+    while (left < right) {
+        int mid = left + (right - left) / 2;
+        if (m_positions[mid] + m_lengths[mid] > p_pos) {
+            right = mid;
+        } else {
+            left = mid + 1;
+        }
+    }
+
+    return left;
+}
+
+void VTextMatches::replace(int p_start, int p_oldEnd, int p_newEnd, const VTextMatches &p_matches)
+{
+    int first = lowerBound(p_start);
+    int last = first;
+    while (last < m_positions.size() && m_positions[last] < p_oldEnd) {
+        ++last;
+    }
+
+    int delta = p_newEnd - p_oldEnd;
+    if (delta != 0) {
+        for (int i = last; i < m_positions.size(); ++i) {
+            m_positions[i] += delta;
+        }
+    }
+
+    m_positions.remove(first, last - first);
+    m_lengths.remove(first, last - first);
+
+    if (!p_matches.isEmpty()) {
+        m_positions.insert(first, p_matches.size(), 0);
+        m_lengths.insert(first, p_matches.size(), 0);
+        for (int i = 0; i < p_matches.size(); ++i) {
+            m_positions[first + i] = p_matches.m_positions[i];
+            m_lengths[first + i] = p_matches.m_lengths[i];
+        }
+    }
+}
+
+VTextMatcher::VTextMatcher()
+    : m_options(0)
+{
+}
+
+VTextMatcher::VTextMatcher(const QString &p_text, uint p_options)
+    : m_text(p_text), m_options(p_options)
+{
+    Qt::CaseSensitivity cs = (p_options & FindOption::CaseSensitive) ? Qt::CaseSensitive
+                                                                      : Qt::CaseInsensitive;
+    if (p_options & FindOption::RegularExpression) {
+        QRegularExpression::PatternOptions opts = QRegularExpression::MultilineOption;
+        if (cs == Qt::CaseInsensitive) {
+            opts |= QRegularExpression::CaseInsensitiveOption;
+        }
+
+        m_regExp.setPattern(p_text);
+        m_regExp.setPatternOptions(opts);
+        m_regExp.optimize();
+        if (!m_regExp.isValid()) {
+            qWarning() << "invalid regular expression" << p_text << m_regExp.errorString();
+        }
+    } else {
+        m_matcher.setPattern(p_text);
+        m_matcher.setCaseSensitivity(cs);
+    }
+}
+
+bool VTextMatcher::isValid() const
+{
+    if (m_text.isEmpty()) {
+        return false;
+    }
+
+    return !(m_options & FindOption::RegularExpression) || m_regExp.isValid();
+}
+
+const QString &VTextMatcher::getText() const
+{
+    return m_text;
+}
+
+uint VTextMatcher::getOptions() const
+{
+    return m_options;
+}
+
+void VTextMatcher::findAll(const QString &p_text, VTextMatches &p_matches, int p_offset,
+                           const QAtomicInt *p_cancel) const
+{
+    if (!isValid()) {
+        return;
+    }
+
+    bool wholeWord = m_options & FindOption::WholeWordOnly;
+    if (m_options & FindOption::RegularExpression) {
+        QRegularExpressionMatchIterator it = m_regExp.globalMatch(p_text);
+        while (it.hasNext()) {
+            if (p_cancel && p_cancel->load()) {
+                return;
+            }
+
+            QRegularExpressionMatch match = it.next();
+            int pos = match.capturedStart();
+            int len = match.capturedLength();
+
+            // Matches do not span lines, like QTextDocument::find().
+            int lineEnd = p_text.indexOf('\n', pos);
+            if (lineEnd != -1 && lineEnd < pos + len) {
+                len = lineEnd - pos;
+            }
+
+            if (len > 0 && (!wholeWord || isWholeWord(p_text, pos, len))) {
+                p_matches.append(p_offset + pos, len);
+            }
+        }
+    } else {
+        const QChar *data = p_text.constData();
+        int size = p_text.size();
+        int len = m_text.size();
+        int pos = m_matcher.indexIn(data, size, 0);
+        while (pos != -1) {
+            if (p_cancel && p_cancel->load()) {
+                return;
+            }
+
+            if (!wholeWord || isWholeWord(p_text, pos, len)) {
+                p_matches.append(p_offset + pos, len);
+                pos = m_matcher.indexIn(data, size, pos + len);
+            } else {
+                pos = m_matcher.indexIn(data, size, pos + 1);
+            }
+        }
+    }
+}
+
+QString VTextMatcher::replacement(const QString &p_text, int p_pos,
+                                  const QString &p_replaceText) const
+{
+    if (!(m_options & FindOption::RegularExpression)
+        || !p_replaceText.contains('\\')) {
+        return p_replaceText;
+    }
+
+    QRegularExpressionMatch match = m_regExp.match(p_text, p_pos,
+                                                   QRegularExpression::NormalMatch,
+                                                   QRegularExpression::AnchoredMatchOption);
+    if (!match.hasMatch()) {
+        return p_replaceText;
+    }
+
+    QString result;
+    result.reserve(p_replaceText.size());
+    int size = p_replaceText.size();
+    for (int i = 0; i < size; ++i) {
+        QChar ch = p_replaceText[i];
+        if (ch != '\\' || i + 1 == size) {
+            result.append(ch);
+            continue;
+        }
+
+        QChar next = p_replaceText[i + 1];
+        if (next == '\\') {
+            result.append(next);
+            ++i;
+        } else if (next.isDigit()) {
+            int group = next.digitValue();
+            ++i;
+            if (i + 1 < size && p_replaceText[i + 1].isDigit()) {
+                int group2 = group * 10 + p_replaceText[i + 1].digitValue();
+                if (group2 <= m_regExp.captureCount()) {
+                    group = group2;
+                    ++i;
+                }
+            }
+
+            result.append(match.captured(group));
+        } else {
+            result.append(ch);
+        }
+    }
+
+    return result;
+}
+
+bool VTextMatcher::isWholeWord(const QString &p_text, int p_pos, int p_len)
+{
+    int end = p_pos + p_len;
+    return (p_pos == 0 || !p_text[p_pos - 1].isLetterOrNumber())
+           && (end == p_text.size() || !p_text[end].isLetterOrNumber());
+}
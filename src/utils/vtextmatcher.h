@@ -0,0 +1,82 @@
+#ifndef VTEXTMATCHER_H
+#define VTEXTMATCHER_H
+
+#include <QString>
+#include <QVector>
+#include <QStringMatcher>
+#include <QRegularExpression>
+#include <QAtomicInt>
+
+// Matches sorted by position, stored as compact arrays.
+// Matches do not overlap and do not span lines.
+class VTextMatches
+{
+public:
+    int size() const;
+
+    bool isEmpty() const;
+
+    void clear();
+
+    int position(int p_idx) const;
+
+    int length(int p_idx) const;
+
+    void append(int p_pos, int p_len);
+
+    // Get the index of the first match ending after @p_pos.
+    int lowerBound(int p_pos) const;
+
+    // Update matches after the text in [@p_start, @p_oldEnd) is replaced
+    // by the text in [@p_start, @p_newEnd), whose matches are @p_matches.
+    void replace(int p_start, int p_oldEnd, int p_newEnd, const VTextMatches &p_matches);
+
+private:
+    QVector<int> m_positions;
+    QVector<int> m_lengths;
+};
+
+// Find all the occurences of a text in a plain text snapshot, whose lines
+// are separated by '\n'.
+// Literal text is searched via QStringMatcher, and regular expression is
+// compiled only once.
+class VTextMatcher
+{
+public:
+    VTextMatcher();
+
+    // @p_options: FindOption.
+    VTextMatcher(const QString &p_text, uint p_options);
+
+    // Whether the text is not empty and the regular expression is valid.
+    bool isValid() const;
+
+    const QString &getText() const;
+
+    uint getOptions() const;
+
+    // Find all the matches in @p_text and append them to @p_matches.
+    // @p_offset will be added to the positions of the matches.
+    // Stop if @p_cancel is set. Thread-safe.
+    void findAll(const QString &p_text, VTextMatches &p_matches, int p_offset = 0,
+                 const QAtomicInt *p_cancel = NULL) const;
+
+    // Get the text to replace the match at @p_pos of @p_text with.
+    // For regular expression, \1 to \99 in @p_replaceText are replaced by
+    // the captured texts and \\ by a backslash.
+    QString replacement(const QString &p_text, int p_pos, const QString &p_replaceText) const;
+
+private:
+    // Whether the match at @p_pos with length @p_len is a whole word.
+    static bool isWholeWord(const QString &p_text, int p_pos, int p_len);
+
+    QString m_text;
+
+    uint m_options;
+
+    QStringMatcher m_matcher;
+
+    QRegularExpression m_regExp;
+};
+
+#endif // VTEXTMATCHER_H
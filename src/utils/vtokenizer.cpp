@@ -0,0 +1,77 @@
+#include "vtokenizer.h"
+
+// Treat '_' as part of a word for identifiers.
+static inline bool isWordChar(QChar p_ch)
+{
+    return p_ch.isLetterOrNumber() || p_ch == '_';
+}
+
+bool VTokenizer::isCJK(QChar p_ch)
+{
+    ushort uc = p_ch.unicode();
+    return (uc >= 0x4E00 && uc <= 0x9FFF)     // CJK Unified Ideographs.
+           || (uc >= 0x3400 && uc <= 0x4DBF)  // CJK Extension A.
+           || (uc >= 0xF900 && uc <= 0xFAFF)  // CJK Compatibility Ideographs.
+           || (uc >= 0x3040 && uc <= 0x30FF)  // Hiragana and Katakana.
+           || (uc >= 0xAC00 && uc <= 0xD7AF); // Hangul Syllables.
+}
+
+QVector<VToken> VTokenizer::tokenize(const QString &p_text)
+{
+    return tokenizeInternal(p_text, false);
+}
+
+QVector<VToken> VTokenizer::tokenizeQuery(const QString &p_text)
+{
+    return tokenizeInternal(p_text, true);
+}
+
+QVector<VToken> VTokenizer::tokenizeInternal(const QString &p_text, bool p_isQuery)
+{
+    QVector<VToken> tokens;
+    int position = 0;
+    int line = 0;
+    int size = p_text.size();
+    int i = 0;
+    while (i < size) {
+        QChar ch = p_text[i];
+        if (ch == '\n') {
+            ++line;
+            ++i;
+            continue;
+        }
+
+        if (isCJK(ch)) {
+            int start = i;
+            while (i < size && isCJK(p_text[i])) {
+                ++i;
+            }
+
+            int len = i - start;
+            for (int j = 0; j < len; ++j) {
+                if (!p_isQuery || len == 1) {
+                    tokens.append(VToken(p_text.mid(start + j, 1), position, line));
+                }
+
+                if (j + 1 < len) {
+                    tokens.append(VToken(p_text.mid(start + j, 2), position, line));
+                }
+
+                // Keep the positions of a query identical to those of the
+                // indexed text for phrase matching.
+                ++position;
+            }
+        } else if (isWordChar(ch)) {
+            int start = i;
+            while (i < size && isWordChar(p_text[i]) && !isCJK(p_text[i])) {
+                ++i;
+            }
+
+            tokens.append(VToken(p_text.mid(start, i - start).toCaseFolded(), position++, line));
+        } else {
+            ++i;
+        }
+    }
+
+    return tokens;
+}
@@ -0,0 +1,51 @@
+#ifndef VTOKENIZER_H
+#define VTOKENIZER_H
+
+#include <QString>
+#include <QVector>
+
+struct VToken
+{
+    VToken() : m_position(0), m_line(0)
+    {
+    }
+
+    VToken(const QString &p_term, int p_position, int p_line)
+        : m_term(p_term), m_position(p_position), m_line(p_line)
+    {
+    }
+
+    // Normalized term.
+    QString m_term;
+
+    // Index of the token in the text. Overlapped tokens share the same position.
+    int m_position;
+
+    // Line number of the token, based on 0.
+    int m_line;
+};
+
+// Split text into terms for full-text search.
+// Words of letters and digits are case folded.
+// CJK text, which has no spaces between words, is split into overlapped
+// bigrams. Each CJK character is also indexed as a unigram at the same
+// position of the bigram it starts, so single-character queries work.
+class VTokenizer
+{
+public:
+    // Tokenize @p_text for indexing.
+    static QVector<VToken> tokenize(const QString &p_text);
+
+    // Tokenize @p_text in a query. Unigrams are produced only for
+    // single CJK characters so that a CJK word becomes a phrase of bigrams.
+    static QVector<VToken> tokenizeQuery(const QString &p_text);
+
+    static bool isCJK(QChar p_ch);
+
+private:
+    VTokenizer() {}
+
+    static QVector<VToken> tokenizeInternal(const QString &p_text, bool p_isQuery);
+};
+
+#endif // VTOKENIZER_H
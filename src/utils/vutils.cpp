@@ -19,7 +19,13 @@
 #include <QElapsedTimer>
 #include <QValidator>
 #include <QRegExpValidator>
-#include <QRegExp>
+#include <QRegularExpression>
+#include <QHash>
+#include <QTextCodec>
+#include <QTextDecoder>
+#include <QTextEncoder>
+#include <cstring>
+#include <limits>
 
 #include "vfile.h"
 #include "vnote.h"
@@ -50,14 +56,54 @@ void VUtils::initAvailableLanguage()
     s_availableLanguages.append(QPair<QString, QString>("zh_CN", "Chinese"));
 }
 
+// Size in bytes of the chunks to decode or encode a file.
+static const int c_fileChunkSize = 4 * 1024 * 1024;
+
+// Decode UTF-8 @p_data of @p_size bytes into a presized string chunk by chunk.
+static QString decodeUtf8(const char *p_data, int p_size)
+{
+    QString text;
+    text.reserve(p_size);
+
+    QTextDecoder decoder(QTextCodec::codecForName("UTF-8"));
+    for (int pos = 0; pos < p_size; pos += c_fileChunkSize) {
+        text.append(decoder.toUnicode(p_data + pos, qMin(c_fileChunkSize, p_size - pos)));
+    }
+
+    // Translate the line endings like the Text mode, which is not needed
+    // in most files.
+    if (std::memchr(p_data, '\r', p_size)) {
+        text.replace(QStringLiteral("\r\n"), QStringLiteral("\n"));
+    }
+
+    return text;
+}
+
 QString VUtils::readFileFromDisk(const QString &filePath)
 {
     QFile file(filePath);
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    if (!file.open(QIODevice::ReadOnly)) {
         qWarning() << "fail to read file" << filePath;
         return QString();
     }
-    QString fileText(file.readAll());
+
+    qint64 size = file.size();
+    if (size > std::numeric_limits<int>::max()) {
+        qWarning() << "file is too large to read" << filePath << size;
+        return QString();
+    }
+
+    QString fileText;
+    uchar *data = size > 0 ? file.map(0, size) : NULL;
+    if (data) {
+        fileText = decodeUtf8(reinterpret_cast<const char *>(data), (int)size);
+        file.unmap(data);
+    } else {
+        // Sequential devices or compressed resources.
+        QByteArray bytes = file.readAll();
+        fileText = decodeUtf8(bytes.constData(), bytes.size());
+    }
+
     file.close();
     qDebug() << "read file content:" << filePath;
     return fileText;
@@ -70,8 +116,19 @@ bool VUtils::writeFileToDisk(const QString &filePath, const QString &text)
         qWarning() << "fail to open file" << filePath << "to write";
         return false;
     }
-    QTextStream stream(&file);
-    stream << text;
+
+    // The encoder keeps the state of surrogate pairs across chunks.
+    QTextEncoder encoder(QTextCodec::codecForName("UTF-8"), QTextCodec::IgnoreHeader);
+    const int chunkSize = c_fileChunkSize / 4;
+    for (int pos = 0; pos < text.size(); pos += chunkSize) {
+        QByteArray bytes = encoder.fromUnicode(text.constData() + pos,
+                                               qMin(chunkSize, text.size() - pos));
+        if (file.write(bytes) != bytes.size()) {
+            qWarning() << "fail to write file" << filePath;
+            return false;
+        }
+    }
+
     file.close();
     qDebug() << "write file content:" << filePath;
     return true;
@@ -162,54 +219,96 @@ QVector<ImageLink> VUtils::fetchImagesFromMarkdownFile(VFile *p_file,
         return images;
     }
 
-    const QString &text = p_file->getContent();
-    if (text.isEmpty()) {
-        if (!isOpened) {
-            p_file->close();
+    images = fetchImagesFromMarkdownText(p_file->getContent(),
+                                         p_file->retriveBasePath(),
+                                         p_type);
+
+    if (!isOpened) {
+        p_file->close();
+    }
+
+    return images;
+}
+
+QStringList VUtils::fetchImageUrlsFromMarkdownText(const QString &p_text)
+{
+    // QRegularExpression is thread-safe and compiled only once.
+    static const QRegularExpression regExp(c_imageLinkRegExp,
+                                           QRegularExpression::OptimizeOnFirstUsageOption);
+
+    QStringList urls;
+    if (p_text.isEmpty()) {
+        return urls;
+    }
+
+    QRegularExpressionMatchIterator it = regExp.globalMatch(p_text);
+    while (it.hasNext()) {
+        QRegularExpressionMatch match = it.next();
+        QString url = match.captured(2).trimmed();
+        if (!url.isEmpty()) {
+            urls.append(url);
         }
+    }
+
+    return urls;
+}
 
+QVector<ImageLink> VUtils::fetchImagesFromMarkdownText(const QString &p_text,
+                                                       const QString &p_basePath,
+                                                       ImageLink::ImageLinkType p_type)
+{
+    QVector<ImageLink> images;
+    QStringList urls = fetchImageUrlsFromMarkdownText(p_text);
+    if (urls.isEmpty()) {
         return images;
     }
 
-    QRegExp regExp(c_imageLinkRegExp);
-    QString basePath = p_file->retriveBasePath();
-    int pos = 0;
-    while (pos < text.size() && (pos = regExp.indexIn(text, pos)) != -1) {
-        QString imageUrl = regExp.capturedTexts()[2].trimmed();
+    QString basePath = QDir::cleanPath(p_basePath);
 
-        ImageLink link;
-        QFileInfo info(basePath, imageUrl);
-        if (info.exists()) {
-            if (info.isNativePath()) {
-                // Local file.
-                link.m_path = QDir::cleanPath(info.absoluteFilePath());
-
-                if (QDir::isRelativePath(imageUrl)) {
-                    link.m_type = p_file->isInternalImageFolder(VUtils::basePathFromPath(link.m_path)) ?
-                                  ImageLink::LocalRelativeInternal : ImageLink::LocalRelativeExternal;
+    // Resolved links of each distinct URL to avoid stat the same file again.
+    QHash<QString, ImageLink> resolvedLinks;
+    for (auto const &imageUrl : urls) {
+        auto it = resolvedLinks.find(imageUrl);
+        if (it == resolvedLinks.end()) {
+            ImageLink link;
+            QUrl url(imageUrl);
+            if (url.scheme().size() > 1 && url.scheme() != "file") {
+                // Skip the stat for remote links like http://.
+                link.m_path = url.toString();
+                link.m_type = ImageLink::Remote;
+            } else {
+                QFileInfo info(basePath, imageUrl);
+                if (info.exists()) {
+                    if (info.isNativePath()) {
+                        // Local file.
+                        link.m_path = QDir::cleanPath(info.absoluteFilePath());
+
+                        if (QDir::isRelativePath(imageUrl)) {
+                            // Image folder is right within the folder of the note.
+                            bool internal = basePathFromPath(basePathFromPath(link.m_path)) == basePath;
+                            link.m_type = internal ? ImageLink::LocalRelativeInternal
+                                                   : ImageLink::LocalRelativeExternal;
+                        } else {
+                            link.m_type = ImageLink::LocalAbsolute;
+                        }
+                    } else {
+                        link.m_type = ImageLink::Resource;
+                        link.m_path = imageUrl;
+                    }
                 } else {
-                    link.m_type = ImageLink::LocalAbsolute;
+                    link.m_path = url.toString();
+                    link.m_type = ImageLink::Remote;
                 }
-            } else {
-                link.m_type = ImageLink::Resource;
-                link.m_path = imageUrl;
             }
-        } else {
-            QUrl url(imageUrl);
-            link.m_path = url.toString();
-            link.m_type = ImageLink::Remote;
+
+            it = resolvedLinks.insert(imageUrl, link);
         }
 
+        const ImageLink &link = it.value();
         if (link.m_type & p_type) {
             images.push_back(link);
             qDebug() << "fetch one image:" << link.m_type << link.m_path;
         }
-
-        pos += regExp.matchedLength();
-    }
-
-    if (!isOpened) {
-        p_file->close();
     }
 
     return images;
@@ -337,7 +436,8 @@ int VUtils::showMessage(QMessageBox::Icon p_icon, const QString &p_title, const
     return msgBox.exec();
 }
 
-QString VUtils::generateCopiedFileName(const QString &p_dirPath, const QString &p_fileName)
+QString VUtils::generateCopiedFileName(const QString &p_dirPath, const QString &p_fileName,
+                                       const QStringList &p_reservedNames)
 {
     QString suffix;
     QString base = p_fileName;
@@ -351,7 +451,7 @@ QString VUtils::generateCopiedFileName(const QString &p_dirPath, const QString &
     QString name = p_fileName;
     QString filePath = dir.filePath(name);
     int index = 0;
-    while (QFile(filePath).exists()) {
+    while (QFile(filePath).exists() || p_reservedNames.contains(name)) {
         QString seq;
         if (index > 0) {
             seq = QString::number(index);
@@ -363,13 +463,14 @@ QString VUtils::generateCopiedFileName(const QString &p_dirPath, const QString &
     return name;
 }
 
-QString VUtils::generateCopiedDirName(const QString &p_parentDirPath, const QString &p_dirName)
+QString VUtils::generateCopiedDirName(const QString &p_parentDirPath, const QString &p_dirName,
+                                      const QStringList &p_reservedNames)
 {
     QDir dir(p_parentDirPath);
     QString name = p_dirName;
     QString dirPath = dir.filePath(name);
     int index = 0;
-    while (QDir(dirPath).exists()) {
+    while (QDir(dirPath).exists() || p_reservedNames.contains(name)) {
         QString seq;
         if (index > 0) {
             seq = QString::number(index);
@@ -2,6 +2,7 @@
 #define VUTILS_H
 
 #include <QString>
+#include <QStringList>
 #include <QColor>
 #include <QVector>
 #include <QPair>
@@ -42,14 +43,21 @@ struct ImageLink
 class VUtils
 {
 public:
+    // Read a UTF-8 file. It is memory-mapped and decoded in chunks, and
+    // "\r\n" is translated to "\n" only if there is any CR.
     static QString readFileFromDisk(const QString &filePath);
+
+    // Write @text to a file in UTF-8, encoded chunk by chunk.
     static bool writeFileToDisk(const QString &filePath, const QString &text);
     // Transform FFFFFF string to QRgb
     static QRgb QRgbFromString(const QString &str);
     static QString generateImageFileName(const QString &path, const QString &title,
                                          const QString &format = "png");
-    static QString generateCopiedFileName(const QString &p_dirPath, const QString &p_fileName);
-    static QString generateCopiedDirName(const QString &p_parentDirPath, const QString &p_dirName);
+    // @p_reservedNames: names not existing yet but should not be used.
+    static QString generateCopiedFileName(const QString &p_dirPath, const QString &p_fileName,
+                                          const QStringList &p_reservedNames = QStringList());
+    static QString generateCopiedDirName(const QString &p_parentDirPath, const QString &p_dirName,
+                                         const QStringList &p_reservedNames = QStringList());
     static void processStyle(QString &style, const QVector<QPair<QString, QString> > &varMap);
 
     // Return the last directory name of @p_path.
@@ -69,6 +77,18 @@ public:
     static QVector<ImageLink> fetchImagesFromMarkdownFile(VFile *p_file,
                                                           ImageLink::ImageLinkType p_type = ImageLink::All);
 
+    // Fetch all the image links in markdown text @p_text.
+    // @p_basePath is the folder of the note to resolve relative links.
+    // @p_type to filter the links returned.
+    // The text is scanned once and each distinct URL is resolved only once.
+    static QVector<ImageLink> fetchImagesFromMarkdownText(const QString &p_text,
+                                                          const QString &p_basePath,
+                                                          ImageLink::ImageLinkType p_type = ImageLink::All);
+
+    // Fetch the URLs of all the image links in markdown text @p_text without
+    // resolving them. Thread-safe.
+    static QStringList fetchImageUrlsFromMarkdownText(const QString &p_text);
+
     // Create directories along the @p_path.
     // @p_path could be /home/tamlok/abc, /home/tamlok/abc/.
     static bool makePath(const QString &p_path);
@@ -3967,10 +3967,9 @@ void VVim::processUndoAction(QList<Token> &p_tokens)
         repeat = to.m_repeat;
     }
 
-    QTextDocument *doc = m_editor->document();
     int i = 0;
-    for (i = 0; i < repeat && doc->isUndoAvailable(); ++i) {
-        doc->undo();
+    for (i = 0; i < repeat && m_editor->isUndoAvailable(); ++i) {
+        m_editor->undoChange();
     }
 
     message(tr("Undo %1 %2").arg(i).arg(i > 1 ? tr("changes") : tr("change")));
@@ -3989,10 +3988,9 @@ void VVim::processRedoAction(QList<Token> &p_tokens)
         repeat = to.m_repeat;
     }
 
-    QTextDocument *doc = m_editor->document();
     int i = 0;
-    for (i = 0; i < repeat && doc->isRedoAvailable(); ++i) {
-        doc->redo();
+    for (i = 0; i < repeat && m_editor->isRedoAvailable(); ++i) {
+        m_editor->redoChange();
     }
 
     message(tr("Redo %1 %2").arg(i).arg(i > 1 ? tr("changes") : tr("change")));
@@ -4450,13 +4448,10 @@ void VVim::convertCaseOfSelectedText(QTextCursor &p_cursor, bool p_toLower)
 
 void VVim::saveToRegister(const QString &p_text)
 {
-    QString text(p_text);
-    VEditUtils::removeObjectReplacementCharacter(text);
-
-    qDebug() << QString("save text(%1) to register(%2)").arg(text).arg(m_regName);
+    qDebug() << QString("save text(%1) to register(%2)").arg(p_text).arg(m_regName);
 
     Register &reg = m_registers[m_regName];
-    reg.update(text);
+    reg.update(p_text);
 
     if (!reg.isBlackHoleRegister() && !reg.isUnnamedRegister()) {
         // Save it to unnamed register.
@@ -608,7 +608,6 @@ private:
     void convertCaseOfSelectedText(QTextCursor &p_cursor, bool p_toLower);
 
     // Save @p_text to the Register pointed by m_regName.
-    // Remove QChar::ObjectReplacementCharacter before saving.
     void saveToRegister(const QString &p_text);
 
     // Move @p_cursor according to @p_moveMode and @p_token.
@@ -0,0 +1,30 @@
+#include "vchangebus.h"
+
+#include <QDir>
+#include <QDebug>
+#include "vnote.h"
+
+extern VNote *g_vnote;
+
+VChangeBus::VChangeBus(QObject *p_parent)
+    : QObject(p_parent)
+{
+}
+
+void VChangeBus::publish(const VChange &p_change)
+{
+    emit changed(p_change);
+}
+
+void VChangeBus::post(VChange::Type p_type, const QString &p_notebookPath,
+                      const QString &p_path, bool p_isDirectory)
+{
+    if (!g_vnote) {
+        return;
+    }
+
+    g_vnote->getChangeBus()->publish(VChange(p_type,
+                                             QDir::cleanPath(p_notebookPath),
+                                             QDir::cleanPath(p_path),
+                                             p_isDirectory));
+}
@@ -0,0 +1,61 @@
+#ifndef VCHANGEBUS_H
+#define VCHANGEBUS_H
+
+#include <QObject>
+#include <QString>
+
+// A change of the notes on disk made by VNote.
+struct VChange
+{
+    enum Type
+    {
+        // A file or directory is created, modified or added.
+        Updated = 0,
+        // A file or directory is deleted or removed.
+        Removed,
+        NotebookAdded,
+        NotebookRemoved
+    };
+
+    VChange() : m_type(Updated), m_isDirectory(false)
+    {
+    }
+
+    VChange(Type p_type, const QString &p_notebookPath,
+            const QString &p_path, bool p_isDirectory)
+        : m_type(p_type), m_notebookPath(p_notebookPath),
+          m_path(p_path), m_isDirectory(p_isDirectory)
+    {
+    }
+
+    Type m_type;
+
+    QString m_notebookPath;
+
+    // Absolute path of the file or directory.
+    // It is the notebook path for notebook changes.
+    QString m_path;
+
+    bool m_isDirectory;
+};
+
+// Internal bus to publish changes of notebooks, directories and files
+// to services such as the search indexer.
+// Should be used in the GUI thread.
+class VChangeBus : public QObject
+{
+    Q_OBJECT
+public:
+    explicit VChangeBus(QObject *p_parent = 0);
+
+    void publish(const VChange &p_change);
+
+    // Publish a change via the bus of VNote.
+    static void post(VChange::Type p_type, const QString &p_notebookPath,
+                     const QString &p_path, bool p_isDirectory = false);
+
+signals:
+    void changed(const VChange &p_change);
+};
+
+#endif // VCHANGEBUS_H
@@ -1,6 +1,7 @@
 #include "vconfigmanager.h"
 #include <QDir>
 #include <QFile>
+#include <QFileInfo>
 #include <QString>
 #include <QJsonArray>
 #include <QJsonObject>
@@ -8,6 +9,11 @@
 #include <QtDebug>
 #include <QTextEdit>
 #include <QStandardPaths>
+#include <QSaveFile>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+#include <QCoreApplication>
 #include "utils/vutils.h"
 #include "vstyleparser.h"
 
@@ -28,6 +34,30 @@ const QString VConfigManager::c_dangerBtnStyle = QString("QPushButton {color: #f
                                                          "QPushButton::hover {color: #fff; border-color: #ac2925; background-color: #c9302c;}");
 const QString VConfigManager::c_vnoteNotebookFolderName = QString("vnote_notebooks");
 
+// Directory configs not written to disk yet.
+struct PendingDirConfigs
+{
+    PendingDirConfigs() : m_batchLevel(0)
+    {
+    }
+
+    // Protect m_configs. Held during writes so readers never see a config
+    // neither pending nor written.
+    QMutex m_mutex;
+
+    // Cleaned directory path -> config.
+    QHash<QString, QJsonObject> m_configs;
+
+    // Nesting level of the batches in the GUI thread.
+    int m_batchLevel;
+};
+
+static PendingDirConfigs &pendingDirConfigs()
+{
+    static PendingDirConfigs pending;
+    return pending;
+}
+
 VConfigManager::VConfigManager()
     : userSettings(NULL), defaultSettings(NULL)
 {
@@ -133,6 +163,12 @@ void VConfigManager::initialize()
     m_enablePreviewImageConstraint = getConfigFromSettings("global",
                                                            "enable_preview_image_constraint").toBool();
 
+    m_imagePreviewScreens = getConfigFromSettings("global",
+                                                  "image_preview_screens").toInt();
+    if (m_imagePreviewScreens < 0) {
+        m_imagePreviewScreens = 0;
+    }
+
     m_enableImageConstraint = getConfigFromSettings("global",
                                                     "enable_image_constraint").toBool();
 
@@ -142,11 +178,36 @@ void VConfigManager::initialize()
     m_imageFolder = getConfigFromSettings("global",
                                           "image_folder").toString();
 
+    m_enableContentAddressedImages = getConfigFromSettings("global",
+                                                           "enable_content_addressed_images").toBool();
+
+    m_imageFormat = getConfigFromSettings("global",
+                                          "image_format").toString().toLower();
+    if (m_imageFormat.isEmpty()) {
+        m_imageFormat = "png";
+    }
+
+    m_imageQuality = getConfigFromSettings("global",
+                                           "image_quality").toInt();
+    if (m_imageQuality < -1 || m_imageQuality > 100) {
+        m_imageQuality = -1;
+    }
+
     m_enableTrailingSpaceHighlight = getConfigFromSettings("global",
                                                            "enable_trailing_space_highlight").toBool();
 
     m_enableVimMode = getConfigFromSettings("global",
                                             "enable_vim_mode").toBool();
+
+    m_largeFileSize = getConfigFromSettings("global",
+                                            "large_file_size").toLongLong();
+    m_largeFileLines = getConfigFromSettings("global",
+                                             "large_file_lines").toInt();
+
+    m_undoHistorySteps = getConfigFromSettings("global",
+                                               "undo_history_steps").toInt();
+    m_undoHistorySize = getConfigFromSettings("global",
+                                              "undo_history_size").toLongLong();
 }
 
 void VConfigManager::readPredefinedColorsFromSettings()
@@ -261,6 +322,15 @@ QString VConfigManager::fetchDirConfigFilePath(const QString &p_path)
 
 QJsonObject VConfigManager::readDirectoryConfig(const QString &path)
 {
+    {
+        PendingDirConfigs &pending = pendingDirConfigs();
+        QMutexLocker locker(&pending.m_mutex);
+        auto it = pending.m_configs.find(QDir::cleanPath(path));
+        if (it != pending.m_configs.end()) {
+            return it.value();
+        }
+    }
+
     QString configFile = fetchDirConfigFilePath(path);
 
     QFile config(configFile);
@@ -274,29 +344,152 @@ QJsonObject VConfigManager::readDirectoryConfig(const QString &path)
     return QJsonDocument::fromJson(configData).object();
 }
 
+QString VConfigManager::getDirectoryConfigFilePath(const QString &p_path)
+{
+    return QDir::cleanPath(QDir(p_path).filePath(c_dirConfigFile));
+}
+
 bool VConfigManager::directoryConfigExist(const QString &path)
 {
-     return QFileInfo::exists(fetchDirConfigFilePath(path));
+    {
+        PendingDirConfigs &pending = pendingDirConfigs();
+        QMutexLocker locker(&pending.m_mutex);
+        if (pending.m_configs.contains(QDir::cleanPath(path))) {
+            return true;
+        }
+    }
+
+    return QFileInfo::exists(fetchDirConfigFilePath(path));
 }
 
 bool VConfigManager::writeDirectoryConfig(const QString &path, const QJsonObject &configJson)
 {
-    QString configFile = fetchDirConfigFilePath(path);
+    if (!QFileInfo(path).isDir()) {
+        qWarning() << "fail to write configuration of non-existing directory:" << path;
+        return false;
+    }
 
-    QFile config(configFile);
+    QCoreApplication *app = QCoreApplication::instance();
+    bool inGuiThread = app && QThread::currentThread() == app->thread();
+
+    PendingDirConfigs &pending = pendingDirConfigs();
+    QMutexLocker locker(&pending.m_mutex);
+    if (inGuiThread && pending.m_batchLevel > 0) {
+        pending.m_configs.insert(QDir::cleanPath(path), configJson);
+        return true;
+    }
+
+    // The pending one, if any, is older than this one.
+    pending.m_configs.remove(QDir::cleanPath(path));
+    return writeDirectoryConfigToDisk(path, configJson);
+}
+
+void VConfigManager::beginDirectoryConfigBatch()
+{
+    PendingDirConfigs &pending = pendingDirConfigs();
+    QMutexLocker locker(&pending.m_mutex);
+    ++pending.m_batchLevel;
+}
+
+bool VConfigManager::endDirectoryConfigBatch()
+{
+    PendingDirConfigs &pending = pendingDirConfigs();
+    {
+        QMutexLocker locker(&pending.m_mutex);
+        Q_ASSERT(pending.m_batchLevel > 0);
+        if (--pending.m_batchLevel > 0) {
+            return true;
+        }
+    }
+
+    return flushDirectoryConfigs();
+}
+
+bool VConfigManager::flushDirectoryConfigs()
+{
+    PendingDirConfigs &pending = pendingDirConfigs();
+    QStringList failedPaths;
+    {
+        QMutexLocker locker(&pending.m_mutex);
+        if (pending.m_configs.isEmpty()) {
+            return true;
+        }
+
+        int nrWritten = 0;
+        auto it = pending.m_configs.begin();
+        while (it != pending.m_configs.end()) {
+            if (!QFileInfo(it.key()).isDir()) {
+                qWarning() << "drop configuration of non-existing directory:" << it.key();
+                it = pending.m_configs.erase(it);
+            } else if (writeDirectoryConfigToDisk(it.key(), it.value())) {
+                ++nrWritten;
+                it = pending.m_configs.erase(it);
+            } else {
+                // Keep it to retry on next flush.
+                failedPaths.append(it.key());
+                ++it;
+            }
+        }
+
+        qDebug() << "flushed" << nrWritten << "directory configurations";
+    }
+
+    if (failedPaths.isEmpty()) {
+        return true;
+    }
+
+    VUtils::showMessage(QMessageBox::Warning, QObject::tr("Warning"),
+                        QObject::tr("Fail to write the configurations of %1 folders.")
+                          .arg(failedPaths.size()),
+                        QObject::tr("They will be written again later and on exit. "
+                                    "Please check the permissions of these folders:\n%1")
+                          .arg(failedPaths.join("\n")),
+                        QMessageBox::Ok, QMessageBox::Ok, NULL);
+    return false;
+}
+
+bool VConfigManager::isDirectoryConfigPending(const QString &p_path)
+{
+    PendingDirConfigs &pending = pendingDirConfigs();
+    QMutexLocker locker(&pending.m_mutex);
+    return pending.m_configs.contains(QDir::cleanPath(p_path));
+}
+
+bool VConfigManager::writeDirectoryConfigToDisk(const QString &p_path, const QJsonObject &p_configJson)
+{
+    QString configFile = fetchDirConfigFilePath(p_path);
+
+    // Write to a temporary file and rename it to keep the old config intact
+    // on failure.
+    QSaveFile config(configFile);
     if (!config.open(QIODevice::WriteOnly)) {
         qWarning() << "fail to open directory configuration file for write:"
                    << configFile;
         return false;
     }
 
-    QJsonDocument configDoc(configJson);
+    QJsonDocument configDoc(p_configJson);
     config.write(configDoc.toJson());
+    if (!config.commit()) {
+        qWarning() << "fail to write directory configuration file:"
+                   << configFile << config.errorString();
+        return false;
+    }
+
     return true;
 }
 
 bool VConfigManager::deleteDirectoryConfig(const QString &path)
 {
+    {
+        PendingDirConfigs &pending = pendingDirConfigs();
+        QMutexLocker locker(&pending.m_mutex);
+        if (pending.m_configs.remove(QDir::cleanPath(path)) > 0
+            && !QFileInfo::exists(fetchDirConfigFilePath(path))) {
+            return true;
+        }
+    }
+
     QString configFile = fetchDirConfigFilePath(path);
 
     QFile config(configFile);
@@ -36,10 +36,37 @@ public:
 
     // Read config from the directory config json file into a QJsonObject.
     // @path is the directory containing the config json file.
+    // Pending writes are taken into account.
     static QJsonObject readDirectoryConfig(const QString &path);
 
+    // Write @configJson to the config file of directory @path atomically.
+    // Within a batch in the GUI thread, the write is queued and coalesced with
+    // later writes to the same config, and true is returned. Failures of the
+    // queued writes are reported when they are flushed.
     static bool writeDirectoryConfig(const QString &path, const QJsonObject &configJson);
+
+    // Queue the directory config writes in the GUI thread until the matching
+    // endDirectoryConfigBatch(). Could be nested.
+    static void beginDirectoryConfigBatch();
+
+    // Flush the queued writes if it is the outermost batch.
+    // Returns false if fail to write some of them.
+    static bool endDirectoryConfigBatch();
+
+    // Write all the pending directory configs to disk. Failed ones are kept
+    // pending and reported to user.
+    // Should be called before moving or deleting directories in disk and
+    // before exit.
+    static bool flushDirectoryConfigs();
+
+    // Whether the config of directory @p_path is queued and not written yet.
+    static bool isDirectoryConfigPending(const QString &p_path);
+
     static bool directoryConfigExist(const QString &path);
+
+    // Get the path of the directory config file in @p_path without checking
+    // the obsolete one.
+    static QString getDirectoryConfigFilePath(const QString &p_path);
     static bool deleteDirectoryConfig(const QString &path);
 
     static QString getLogFilePath();
@@ -179,6 +206,8 @@ public:
     inline bool getEnablePreviewImageConstraint() const;
     inline void setEnablePreviewImageConstraint(bool p_enabled);
 
+    inline int getImagePreviewScreens() const;
+
     inline bool getEnableImageConstraint() const;
     inline void setEnableImageConstraint(bool p_enabled);
 
@@ -190,12 +219,27 @@ public:
     inline void setImageFolder(const QString &p_folder);
     inline bool isCustomImageFolder() const;
 
+    inline bool getEnableContentAddressedImages() const;
+    inline void setEnableContentAddressedImages(bool p_enabled);
+
+    inline const QString &getImageFormat() const;
+
+    inline int getImageQuality() const;
+
     inline bool getEnableTrailingSpaceHighlight() const;
     inline void setEnableTrailingSapceHighlight(bool p_enabled);
 
     inline bool getEnableVimMode() const;
     inline void setEnableVimMode(bool p_enabled);
 
+    inline qint64 getLargeFileSize() const;
+
+    inline int getLargeFileLines() const;
+
+    inline int getUndoHistorySteps() const;
+
+    inline qint64 getUndoHistorySize() const;
+
     // Get the folder the ini file exists.
     QString getConfigFolder() const;
 
@@ -239,6 +283,9 @@ private:
     // the new one; if not, use the c_dirConfigFile.
     static QString fetchDirConfigFilePath(const QString &p_path);
 
+    // Write @p_configJson to the config file of directory @p_path atomically.
+    static bool writeDirectoryConfigToDisk(const QString &p_path, const QJsonObject &p_configJson);
+
     // Default font and palette.
     QFont m_defaultEditFont;
     QPalette m_defaultEditPalette;
@@ -342,6 +389,10 @@ private:
     // Constrain the width of image preview in edit mode.
     bool m_enablePreviewImageConstraint;
 
+    // Only preview images within this number of screens around the viewport
+    // in edit mode. 0 to preview all the images.
+    int m_imagePreviewScreens;
+
     // Constrain the width of image in read mode.
     bool m_enableImageConstraint;
 
@@ -352,12 +403,36 @@ private:
     // Each notebook can specify its custom folder.
     QString m_imageFolder;
 
+    // Name inserted images by the hash of their content so that identical
+    // images are stored only once in an image folder.
+    bool m_enableContentAddressedImages;
+
+    // Format to encode inserted images, such as png and jpg.
+    QString m_imageFormat;
+
+    // Quality to encode inserted images, 0 to 100.
+    // For PNG, it is the inverse of compression level.
+    // -1 to use the default settings.
+    int m_imageQuality;
+
     // Enable trailing-space highlight.
     bool m_enableTrailingSpaceHighlight;
 
     // Enable Vim mode.
     bool m_enableVimMode;
 
+    // Notes larger than this size in bytes are edited in large file mode.
+    qint64 m_largeFileSize;
+
+    // Notes with more lines than this are edited in large file mode.
+    int m_largeFileLines;
+
+    // Max number of undo steps of each Markdown note in edit mode.
+    int m_undoHistorySteps;
+
+    // Max memory in bytes used by the undo history of each Markdown note.
+    qint64 m_undoHistorySize;
+
     // The name of the config file in each directory, obsolete.
     // Use c_dirConfigFile instead.
     static const QString c_obsoleteDirConfigFile;
@@ -853,6 +928,11 @@ inline void VConfigManager::setEnablePreviewImageConstraint(bool p_enabled)
                         m_enablePreviewImageConstraint);
 }
 
+inline int VConfigManager::getImagePreviewScreens() const
+{
+    return m_imagePreviewScreens;
+}
+
 inline bool VConfigManager::getEnableImageConstraint() const
 {
     return m_enableImageConstraint;
@@ -910,6 +990,32 @@ inline bool VConfigManager::isCustomImageFolder() const
     return m_imageFolder != getDefaultConfig("global", "image_folder").toString();
 }
 
+inline bool VConfigManager::getEnableContentAddressedImages() const
+{
+    return m_enableContentAddressedImages;
+}
+
+inline void VConfigManager::setEnableContentAddressedImages(bool p_enabled)
+{
+    if (m_enableContentAddressedImages == p_enabled) {
+        return;
+    }
+
+    m_enableContentAddressedImages = p_enabled;
+    setConfigToSettings("global", "enable_content_addressed_images",
+                        m_enableContentAddressedImages);
+}
+
+inline const QString &VConfigManager::getImageFormat() const
+{
+    return m_imageFormat;
+}
+
+inline int VConfigManager::getImageQuality() const
+{
+    return m_imageQuality;
+}
+
 inline bool VConfigManager::getEnableTrailingSpaceHighlight() const
 {
     return m_enableTrailingSpaceHighlight;
@@ -942,4 +1048,24 @@ inline void VConfigManager::setEnableVimMode(bool p_enabled)
                         m_enableVimMode);
 }
 
+inline qint64 VConfigManager::getLargeFileSize() const
+{
+    return m_largeFileSize;
+}
+
+inline int VConfigManager::getLargeFileLines() const
+{
+    return m_largeFileLines;
+}
+
+inline int VConfigManager::getUndoHistorySteps() const
+{
+    return m_undoHistorySteps;
+}
+
+inline qint64 VConfigManager::getUndoHistorySize() const
+{
+    return m_undoHistorySize;
+}
+
 #endif // VCONFIGMANAGER_H
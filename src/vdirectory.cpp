@@ -3,16 +3,48 @@
 #include <QJsonObject>
 #include <QJsonArray>
 #include <QDebug>
+#include <QtConcurrent>
+#include <QThreadPool>
+#include <QHash>
 #include "vconfigmanager.h"
 #include "vfile.h"
 #include "utils/vutils.h"
+#include "vimagesaver.h"
+#include "vchangebus.h"
+#include "vnotebookcache.h"
+#include "vfilewatcher.h"
+#include "vnote.h"
 
 extern VConfigManager vconfig;
+extern VNote *g_vnote;
+
+// Max number of directory configs read concurrently by openAsync().
+static const int c_maxConcurrentLoads = 4;
+
+static QThreadPool *configLoaderPool()
+{
+    static QThreadPool pool;
+    pool.setMaxThreadCount(c_maxConcurrentLoads);
+    return &pool;
+}
+
+// Get the names of the items in section @p_section of @p_configJson.
+static QStringList itemNamesInConfig(const QJsonObject &p_configJson, const QString &p_section)
+{
+    QStringList names;
+    QJsonArray items = p_configJson[p_section].toArray();
+    for (int i = 0; i < items.size(); ++i) {
+        names.append(items[i].toObject()[DirConfig::c_name].toString());
+    }
+
+    return names;
+}
 
 VDirectory::VDirectory(VNotebook *p_notebook,
                        const QString &p_name, QObject *p_parent)
     : QObject(p_parent), m_notebook(p_notebook), m_name(p_name), m_opened(false),
-      m_expanded(false)
+      m_expanded(false), m_loadWatcher(NULL), m_loading(false),
+      m_loadConfigModified(-1), m_loadConfigSize(-1)
 {
 }
 
@@ -22,37 +54,263 @@ bool VDirectory::open()
         return true;
     }
 
-    V_ASSERT(m_subDirs.isEmpty() && m_files.isEmpty());
-
     QString path = retrivePath();
+    qint64 modified, size;
+    if (fillFromCache(path, modified, size)) {
+        return true;
+    }
+
     QJsonObject configJson = VConfigManager::readDirectoryConfig(path);
     if (configJson.isEmpty()) {
         qWarning() << "invalid directory configuration in path" << path;
         return false;
     }
 
+    return fillFromConfig(configJson, modified, size);
+}
+
+bool VDirectory::openAsync()
+{
+    if (m_opened) {
+        return true;
+    }
+
+    if (m_loading) {
+        return false;
+    }
+
+    // Stat is cheap enough to do here.
+    QString path = retrivePath();
+    qint64 modified, size;
+    if (fillFromCache(path, modified, size)) {
+        return true;
+    }
+
+    if (!m_loadWatcher) {
+        m_loadWatcher = new QFutureWatcher<QJsonObject>(this);
+        connect(m_loadWatcher, &QFutureWatcher<QJsonObject>::finished,
+                this, &VDirectory::handleConfigLoaded);
+    }
+
+    m_loading = true;
+
+    // Reuse the reading of a previous loading cancelled by close().
+    if (m_loadWatcher->isRunning()) {
+        return false;
+    }
+
+    m_loadConfigModified = modified;
+    m_loadConfigSize = size;
+    m_loadWatcher->setFuture(QtConcurrent::run(configLoaderPool(),
+                                               &VConfigManager::readDirectoryConfig,
+                                               path));
+    return false;
+}
+
+void VDirectory::handleConfigLoaded()
+{
+    if (!m_loading) {
+        // Cancelled.
+        return;
+    }
+
+    m_loading = false;
+    if (m_opened) {
+        emit loaded(true);
+        return;
+    }
+
+    QJsonObject configJson = m_loadWatcher->result();
+    if (configJson.isEmpty()) {
+        qWarning() << "invalid directory configuration in path" << retrivePath();
+        emit loaded(false);
+        return;
+    }
+
+    emit loaded(fillFromConfig(configJson, m_loadConfigModified, m_loadConfigSize));
+}
+
+bool VDirectory::fillFromCache(const QString &p_path, qint64 &p_modified, qint64 &p_size)
+{
+    if (!VNotebookCache::statConfig(p_path, p_modified, p_size)) {
+        p_modified = p_size = -1;
+        return false;
+    }
+
+    QStringList subDirs, files;
+    if (!m_notebook->getCache()->lookup(p_path, p_modified, p_size, subDirs, files)) {
+        return false;
+    }
+
+    return fill(subDirs, files);
+}
+
+bool VDirectory::fillFromConfig(const QJsonObject &p_configJson, qint64 p_modified, qint64 p_size)
+{
+    QStringList subDirs = itemNamesInConfig(p_configJson, DirConfig::c_subDirectories);
+    QStringList files = itemNamesInConfig(p_configJson, DirConfig::c_files);
+
+    // The stat is taken before reading, so a change in between will just
+    // invalidate the entry.
+    if (p_size >= 0) {
+        m_notebook->getCache()->update(retrivePath(), p_modified, p_size, subDirs, files);
+    }
+
+    return fill(subDirs, files);
+}
+
+bool VDirectory::fill(const QStringList &p_subDirs, const QStringList &p_files)
+{
+    V_ASSERT(m_subDirs.isEmpty() && m_files.isEmpty());
+
     // [sub_directories] section
-    QJsonArray dirJson = configJson[DirConfig::c_subDirectories].toArray();
-    for (int i = 0; i < dirJson.size(); ++i) {
-        QJsonObject dirItem = dirJson[i].toObject();
-        VDirectory *dir = new VDirectory(m_notebook, dirItem[DirConfig::c_name].toString(), this);
-        m_subDirs.append(dir);
+    for (auto const &name : p_subDirs) {
+        m_subDirs.append(new VDirectory(m_notebook, name, this));
     }
 
     // [files] section
-    QJsonArray fileJson = configJson[DirConfig::c_files].toArray();
-    for (int i = 0; i < fileJson.size(); ++i) {
-        QJsonObject fileItem = fileJson[i].toObject();
-        VFile *file = new VFile(fileItem[DirConfig::c_name].toString(), this);
-        m_files.append(file);
+    for (auto const &name : p_files) {
+        m_files.append(new VFile(name, this));
     }
 
+    // Restore the expanded state of last session.
+    m_expanded = !m_subDirs.isEmpty()
+                 && m_notebook->getCache()->isExpanded(retrivePath());
+
     m_opened = true;
+
+    VFileWatcher::watch(retrivePath());
     return true;
 }
 
+bool VDirectory::reloadItems(QVector<VDirectory *> &p_removedDirs, QVector<VFile *> &p_removedFiles)
+{
+    if (!m_opened) {
+        return false;
+    }
+
+    QString path = retrivePath();
+    qint64 modified, size;
+    if (!VNotebookCache::statConfig(path, modified, size)) {
+        return false;
+    }
+
+    QJsonObject configJson = VConfigManager::readDirectoryConfig(path);
+    if (configJson.isEmpty()) {
+        qWarning() << "invalid directory configuration in path" << path;
+        return false;
+    }
+
+    QStringList subDirNames = itemNamesInConfig(configJson, DirConfig::c_subDirectories);
+    QStringList fileNames = itemNamesInConfig(configJson, DirConfig::c_files);
+    m_notebook->getCache()->update(path, modified, size, subDirNames, fileNames);
+
+    QString nbPath = m_notebook->getPath();
+    bool changed = false;
+
+    // Keep the existing items in the order of the config.
+    QHash<QString, VDirectory *> oldDirs;
+    for (auto dir : m_subDirs) {
+        oldDirs.insert(dir->getName(), dir);
+    }
+
+    QVector<VDirectory *> subDirs;
+    for (auto const &name : subDirNames) {
+        VDirectory *dir = oldDirs.take(name);
+        if (!dir) {
+            dir = new VDirectory(m_notebook, name, this);
+            VChangeBus::post(VChange::Updated, nbPath, dir->retrivePath(), true);
+            changed = true;
+        }
+
+        subDirs.append(dir);
+    }
+
+    for (auto dir : oldDirs) {
+        // The tabs may still refer to it.
+        QString dirPath = dir->retrivePath();
+        dir->setWatched(false);
+        m_notebook->getCache()->remove(dirPath);
+        VChangeBus::post(VChange::Removed, nbPath, dirPath, true);
+        p_removedDirs.append(dir);
+        dir->deleteLater();
+        changed = true;
+    }
+
+    QHash<QString, VFile *> oldFiles;
+    for (auto file : m_files) {
+        oldFiles.insert(file->getName(), file);
+    }
+
+    QVector<VFile *> files;
+    for (auto const &name : fileNames) {
+        VFile *file = oldFiles.take(name);
+        if (!file) {
+            file = new VFile(name, this);
+            VChangeBus::post(VChange::Updated, nbPath, file->retrivePath());
+            changed = true;
+        }
+
+        files.append(file);
+    }
+
+    for (auto file : oldFiles) {
+        VChangeBus::post(VChange::Removed, nbPath, file->retrivePath());
+        p_removedFiles.append(file);
+        file->deleteLater();
+        changed = true;
+    }
+
+    changed = changed || subDirs != m_subDirs || files != m_files;
+    m_subDirs = subDirs;
+    m_files = files;
+
+    if (m_subDirs.isEmpty()) {
+        m_expanded = false;
+    }
+
+    if (changed) {
+        qDebug() << "folder" << path << "reloaded:" << p_removedDirs.size()
+                 << "folders and" << p_removedFiles.size() << "notes removed";
+    }
+
+    return changed;
+}
+
+void VDirectory::setWatched(bool p_watched)
+{
+    if (!m_opened) {
+        return;
+    }
+
+    QString path = retrivePath();
+    if (p_watched) {
+        VFileWatcher::watch(path);
+    } else {
+        VFileWatcher::unwatch(path);
+    }
+
+    for (auto file : m_files) {
+        if (!file->isOpened()) {
+            continue;
+        }
+
+        if (p_watched) {
+            VFileWatcher::watch(file->retrivePath());
+        } else {
+            VFileWatcher::unwatch(file->retrivePath());
+        }
+    }
+
+    for (auto dir : m_subDirs) {
+        dir->setWatched(p_watched);
+    }
+}
+
 void VDirectory::close()
 {
+    m_loading = false;
+
     if (!m_opened) {
         return;
     }
@@ -71,6 +329,8 @@ void VDirectory::close()
     }
     m_files.clear();
 
+    VFileWatcher::unwatch(retrivePath());
+
     m_opened = false;
 }
 
@@ -153,7 +413,20 @@ bool VDirectory::writeToConfig() const
 
 bool VDirectory::writeToConfig(const QJsonObject &p_json) const
 {
-    return VConfigManager::writeDirectoryConfig(retrivePath(), p_json);
+    QString path = retrivePath();
+    if (!VConfigManager::writeDirectoryConfig(path, p_json)) {
+        return false;
+    }
+
+    // A pending write invalidates the entry instead.
+    qint64 modified, size;
+    if (VNotebookCache::statConfig(path, modified, size)) {
+        m_notebook->getCache()->update(path, modified, size,
+                                       itemNamesInConfig(p_json, DirConfig::c_subDirectories),
+                                       itemNamesInConfig(p_json, DirConfig::c_files));
+    }
+
+    return true;
 }
 
 void VDirectory::addNotebookConfig(QJsonObject &p_json) const
@@ -279,6 +552,8 @@ VFile *VDirectory::createFile(const QString &p_name)
         return NULL;
     }
 
+    VChangeBus::post(VChange::Updated, m_notebook->getPath(), ret->retrivePath());
+
     qDebug() << "note" << p_name << "created in folder" << m_name;
 
     return ret;
@@ -308,6 +583,8 @@ bool VDirectory::addFile(VFile *p_file, int p_index)
 
     p_file->setParent(this);
 
+    VChangeBus::post(VChange::Updated, m_notebook->getPath(), p_file->retrivePath());
+
     qDebug() << "note" << p_file->getName() << "added to folder" << m_name;
 
     return true;
@@ -356,6 +633,8 @@ bool VDirectory::addSubDirectory(VDirectory *p_dir, int p_index)
 
     p_dir->setParent(this);
 
+    VChangeBus::post(VChange::Updated, m_notebook->getPath(), p_dir->retrivePath(), true);
+
     qDebug() << "folder" << p_dir->getName() << "added to folder" << m_name;
 
     return true;
@@ -386,6 +665,8 @@ void VDirectory::deleteSubDirectory(VDirectory *p_subDir)
 
     p_subDir->close();
 
+    VConfigManager::flushDirectoryConfigs();
+
     removeSubDirectory(p_subDir);
 
     // Delete the entire directory
@@ -412,6 +693,10 @@ bool VDirectory::removeSubDirectory(VDirectory *p_dir)
         return false;
     }
 
+    m_notebook->getCache()->remove(p_dir->retrivePath());
+
+    VChangeBus::post(VChange::Removed, m_notebook->getPath(), p_dir->retrivePath(), true);
+
     qDebug() << "folder" << p_dir->getName() << "removed from folder" << m_name;
 
     return true;
@@ -430,6 +715,8 @@ bool VDirectory::removeFile(VFile *p_file)
         return false;
     }
 
+    VChangeBus::post(VChange::Removed, m_notebook->getPath(), p_file->retrivePath());
+
     qDebug() << "note" << p_file->getName() << "removed from folder" << m_name;
 
     return true;
@@ -448,6 +735,24 @@ void VDirectory::deleteFile(VFile *p_file)
     delete p_file;
 }
 
+QSet<QString> VDirectory::fetchImagesOfNotes(const VFile *p_exclude) const
+{
+    QSet<QString> images;
+    for (auto file : m_files) {
+        if (file == p_exclude || file->getDocType() != DocType::Markdown) {
+            continue;
+        }
+
+        QVector<ImageLink> links = VUtils::fetchImagesFromMarkdownFile(file,
+                                                                       ImageLink::LocalRelativeInternal);
+        for (auto const &link : links) {
+            images.insert(link.m_path);
+        }
+    }
+
+    return images;
+}
+
 bool VDirectory::rename(const QString &p_name)
 {
     if (m_name == p_name) {
@@ -459,9 +764,15 @@ bool VDirectory::rename(const QString &p_name)
     VDirectory *parentDir = getParentDirectory();
     V_ASSERT(parentDir);
     // Rename it in disk.
+    VConfigManager::flushDirectoryConfigs();
+
+    // Paths of the opened folders and notes within it will change.
+    setWatched(false);
+
     QDir dir(parentDir->retrivePath());
     if (!dir.rename(m_name, p_name)) {
         qWarning() << "fail to rename folder" << m_name << "to" << p_name << "in disk";
+        setWatched(true);
         return false;
     }
 
@@ -471,14 +782,99 @@ bool VDirectory::rename(const QString &p_name)
     if (!parentDir->writeToConfig()) {
         m_name = oldName;
         dir.rename(p_name, m_name);
+        setWatched(true);
         return false;
     }
 
+    setWatched(true);
+
+    m_notebook->getCache()->remove(dir.filePath(oldName));
+
+    VChangeBus::post(VChange::Removed, m_notebook->getPath(), dir.filePath(oldName), true);
+    VChangeBus::post(VChange::Updated, m_notebook->getPath(), retrivePath(), true);
+
     qDebug() << "folder renamed from" << oldName << "to" << m_name;
 
     return true;
 }
 
+QVector<VTransferItem> VDirectory::transferItemsOfFile(VDirectory *p_destDir, const QString &p_destName,
+                                                       VFile *p_srcFile, bool p_cut,
+                                                       QStringList &p_skippedImages,
+                                                       QStringList &p_obsoleteImages)
+{
+    QVector<VTransferItem> items;
+    QString srcPath = QDir::cleanPath(p_srcFile->retrivePath());
+    QString destPath = QDir::cleanPath(QDir(p_destDir->retrivePath()).filePath(p_destName));
+    items.append(VTransferItem(srcPath, destPath, p_cut));
+
+    if (p_srcFile->getDocType() != DocType::Markdown) {
+        return items;
+    }
+
+    QVector<ImageLink> images = VUtils::fetchImagesFromMarkdownFile(p_srcFile,
+                                                                    ImageLink::LocalRelativeInternal);
+    if (images.isEmpty()) {
+        return items;
+    }
+
+    // Content-addressed images still linked by other notes in the source
+    // directory should be copied instead of moved.
+    QSet<QString> sharedImages;
+    if (p_cut && vconfig.getEnableContentAddressedImages()) {
+        sharedImages = p_srcFile->getDirectory()->fetchImagesOfNotes(p_srcFile);
+    }
+
+    // Images are kept only when it is still Markdown.
+    if (VUtils::docTypeFromName(destPath) != DocType::Markdown) {
+        if (p_cut) {
+            for (auto const &link : images) {
+                if (!sharedImages.contains(link.m_path)
+                    && !p_obsoleteImages.contains(link.m_path)) {
+                    p_obsoleteImages.append(link.m_path);
+                }
+            }
+        }
+
+        return items;
+    }
+
+    QDir destDir(p_destDir->retrivePath());
+    QSet<QString> handledImages;
+    for (auto const &link : images) {
+        if (handledImages.contains(link.m_path) || !QFileInfo::exists(link.m_path)) {
+            continue;
+        }
+
+        handledImages.insert(link.m_path);
+
+        QString imageFolder = VUtils::directoryNameFromPath(VUtils::basePathFromPath(link.m_path));
+        QString destImagePath = QDir::cleanPath(QDir(destDir.filePath(imageFolder))
+                                                  .filePath(VUtils::fileNameFromPath(link.m_path)));
+        if (destImagePath == QDir::cleanPath(link.m_path)) {
+            // Within the same folder.
+            continue;
+        }
+
+        bool cutImage = p_cut && !sharedImages.contains(link.m_path);
+        if (QFileInfo::exists(destImagePath)) {
+            if (!VImageSaver::isContentAddressedName(destImagePath)
+                || QFileInfo(destImagePath).size() != QFileInfo(link.m_path).size()) {
+                p_skippedImages.append(link.m_path);
+            } else if (cutImage) {
+                // Identical content-addressed image exists already.
+                p_obsoleteImages.append(link.m_path);
+            }
+
+            continue;
+        }
+
+        items.append(VTransferItem(link.m_path, destImagePath, cutImage));
+    }
+
+    return items;
+}
+
 VFile *VDirectory::copyFile(VDirectory *p_destDir, const QString &p_destName,
                             VFile *p_srcFile, bool p_cut)
 {
@@ -492,21 +888,14 @@ VFile *VDirectory::copyFile(VDirectory *p_destDir, const QString &p_destName,
     DocType docType = p_srcFile->getDocType();
     DocType newDocType = VUtils::docTypeFromName(destPath);
 
-    QVector<ImageLink> images;
-    if (docType == DocType::Markdown) {
-        images = VUtils::fetchImagesFromMarkdownFile(p_srcFile,
-                                                     ImageLink::LocalRelativeInternal);
-    }
-
-    // Copy the file
-    if (!VUtils::copyFile(srcPath, destPath, p_cut)) {
-        return NULL;
-    }
-
     // Handle VDirectory and VFile
     int index = -1;
     VFile *destFile = NULL;
     if (p_cut) {
+        if (p_srcFile->isOpened()) {
+            VFileWatcher::unwatch(srcPath);
+        }
+
         // Remove the file from config
         srcDir->removeFile(p_srcFile);
 
@@ -518,6 +907,10 @@ VFile *VDirectory::copyFile(VDirectory *p_destDir, const QString &p_destName,
         } else {
             destFile = NULL;
         }
+
+        if (p_srcFile->isOpened()) {
+            VFileWatcher::watch(p_srcFile->retrivePath());
+        }
     } else {
         destFile = p_destDir->addFile(p_destName, -1);
     }
@@ -530,78 +923,10 @@ VFile *VDirectory::copyFile(VDirectory *p_destDir, const QString &p_destName,
         destFile->convert(docType, newDocType);
     }
 
-    // We need to copy internal images when it is still markdown.
-    if (!images.isEmpty()) {
-        if (newDocType == DocType::Markdown) {
-            QString parentPath = destFile->retriveBasePath();
-            int nrPasted = 0;
-            for (int i = 0; i < images.size(); ++i) {
-                const ImageLink &link = images[i];
-                if (!QFileInfo::exists(link.m_path)) {
-                    continue;
-                }
-
-                QString errStr;
-                bool ret = true;
-
-                QString imageFolder = VUtils::directoryNameFromPath(VUtils::basePathFromPath(link.m_path));
-                QString destImagePath = QDir(parentPath).filePath(imageFolder);
-                ret = VUtils::makePath(destImagePath);
-                if (!ret) {
-                    errStr = tr("Fail to create image folder <span style=\"%1\">%2</span>.")
-                               .arg(vconfig.c_dataTextStyle).arg(destImagePath);
-                } else {
-                    destImagePath = QDir(destImagePath).filePath(VUtils::fileNameFromPath(link.m_path));
-
-                    // Copy or Cut the images accordingly.
-                    if (destImagePath == link.m_path) {
-                        ret = false;
-                    } else {
-                        ret = VUtils::copyFile(link.m_path, destImagePath, p_cut);
-                    }
-
-                    if (ret) {
-                        qDebug() << (p_cut ? "Cut" : "Copy") << "image"
-                                 << link.m_path << "->" << destImagePath;
-
-                        nrPasted++;
-                    } else {
-                        errStr = tr("Please check if there already exists a file <span style=\"%1\">%2</span> "
-                                    "and then manually copy it and modify the note accordingly.")
-                                   .arg(vconfig.c_dataTextStyle).arg(destImagePath);
-                    }
-                }
-
-                if (!ret) {
-                    VUtils::showMessage(QMessageBox::Warning, tr("Warning"),
-                                        tr("Fail to copy image <span style=\"%1\">%2</span> while "
-                                           "%5 note <span style=\"%3\">%4</span>.")
-                                          .arg(vconfig.c_dataTextStyle).arg(link.m_path)
-                                          .arg(vconfig.c_dataTextStyle).arg(srcPath)
-                                          .arg(p_cut ? tr("moving") : tr("copying")),
-                                        errStr, QMessageBox::Ok, QMessageBox::Ok, NULL);
-                }
-            }
-
-            qDebug() << "pasted" << nrPasted << "images";
-        } else {
-            // Delete the images.
-            int deleted = 0;
-            for (int i = 0; i < images.size(); ++i) {
-                QFile file(images[i].m_path);
-                if (file.remove()) {
-                    ++deleted;
-                }
-            }
-
-            qDebug() << "delete" << deleted << "images since it is not Markdown any more for" << srcPath;
-        }
-    }
-
     return destFile;
 }
 
-// Copy @p_srcDir to be a sub-directory of @p_destDir with name @p_destName.
+// The data of @p_srcDir should have been transferred by VTransferEngine.
 VDirectory *VDirectory::copyDirectory(VDirectory *p_destDir, const QString &p_destName,
                                       VDirectory *p_srcDir, bool p_cut)
 {
@@ -613,15 +938,12 @@ VDirectory *VDirectory::copyDirectory(VDirectory *p_destDir, const QString &p_de
 
     VDirectory *srcParentDir = p_srcDir->getParentDirectory();
 
-    // Copy the directory
-    if (!VUtils::copyDirectory(srcPath, destPath, p_cut)) {
-        return NULL;
-    }
-
     // Handle VDirectory
     int index = -1;
     VDirectory *destDir = NULL;
     if (p_cut) {
+        p_srcDir->setWatched(false);
+
         // Remove the directory from config
         srcParentDir->removeSubDirectory(p_srcDir);
 
@@ -633,6 +955,8 @@ VDirectory *VDirectory::copyDirectory(VDirectory *p_destDir, const QString &p_de
         } else {
             destDir = NULL;
         }
+
+        p_srcDir->setWatched(true);
     } else {
         destDir = p_destDir->addSubDirectory(p_destName, -1);
     }
@@ -640,13 +964,75 @@ VDirectory *VDirectory::copyDirectory(VDirectory *p_destDir, const QString &p_de
     return destDir;
 }
 
+// Find the VDirectory of @p_path among the notebooks, opening the directories
+// on the path if needed.
+static VDirectory *loadDirectoryOfPath(const QString &p_path)
+{
+    for (auto nb : g_vnote->getNotebooks()) {
+        VDirectory *dir = nb->tryLoadDirectory(p_path);
+        if (dir) {
+            return dir;
+        }
+    }
+
+    return NULL;
+}
+
+bool VDirectory::updateConfigsOfTransfer(const QString &p_srcPath, const QString &p_destPath,
+                                         bool p_isDir, bool p_cut)
+{
+    VDirectory *destDir = loadDirectoryOfPath(VUtils::basePathFromPath(p_destPath));
+    if (!destDir) {
+        return false;
+    }
+
+    QString srcName = VUtils::fileNameFromPath(p_srcPath);
+    QString destName = VUtils::fileNameFromPath(p_destPath);
+    VDirectory *srcDir = loadDirectoryOfPath(VUtils::basePathFromPath(p_srcPath));
+    if (p_isDir) {
+        VDirectory *srcSubDir = srcDir ? srcDir->findSubDirectory(srcName) : NULL;
+        if (srcSubDir) {
+            return copyDirectory(destDir, destName, srcSubDir, p_cut) != NULL;
+        }
+
+        // The source is not in any config any more. Just add the dest.
+        return destDir->findSubDirectory(destName)
+               || destDir->addSubDirectory(destName, -1);
+    }
+
+    VFile *srcFile = srcDir ? srcDir->findFile(srcName) : NULL;
+    if (srcFile) {
+        return copyFile(destDir, destName, srcFile, p_cut) != NULL;
+    }
+
+    if (destDir->findFile(destName)) {
+        return true;
+    }
+
+    VFile *destFile = destDir->addFile(destName, -1);
+    if (!destFile) {
+        return false;
+    }
+
+    DocType docType = VUtils::docTypeFromName(p_srcPath);
+    DocType newDocType = VUtils::docTypeFromName(p_destPath);
+    if (docType != newDocType) {
+        destFile->convert(docType, newDocType);
+    }
+
+    return true;
+}
+
 void VDirectory::setExpanded(bool p_expanded)
 {
     if (p_expanded) {
         V_ASSERT(m_opened);
     }
 
-    m_expanded = p_expanded;
+    if (m_expanded != p_expanded) {
+        m_expanded = p_expanded;
+        m_notebook->getCache()->setExpanded(retrivePath(), p_expanded);
+    }
 }
 
 void VDirectory::reorderFiles(int p_first, int p_last, int p_destStart)
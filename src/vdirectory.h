@@ -3,12 +3,16 @@
 
 #include <QObject>
 #include <QString>
+#include <QStringList>
 #include <QVector>
 #include <QPointer>
 #include <QJsonObject>
+#include <QSet>
 #include "vnotebook.h"
+#include "vtransferengine.h"
 
 class VFile;
+template <typename T> class QFutureWatcher;
 
 class VDirectory : public QObject
 {
@@ -17,6 +21,13 @@ public:
     VDirectory(VNotebook *p_notebook,
                const QString &p_name, QObject *p_parent = 0);
     bool open();
+
+    // Open the directory without blocking. The config is read in background
+    // with a bounded number of concurrent reads.
+    // Returns true if it is opened already. Otherwise, starts loading if it
+    // is not loading yet and returns false. loaded() will be emitted later.
+    bool openAsync();
+
     void close();
     VDirectory *createSubDirectory(const QString &p_name);
 
@@ -48,22 +59,51 @@ public:
     // Delete @p_file both from disk and config, as well as its local images.
     void deleteFile(VFile *p_file);
 
+    // Fetch the local internal images linked by the Markdown notes directly
+    // in this directory except @p_exclude.
+    // Images may be shared among notes only when they are content-addressed,
+    // so callers should check enable_content_addressed_images first.
+    QSet<QString> fetchImagesOfNotes(const VFile *p_exclude) const;
+
     // Rename current directory to @p_name.
     bool rename(const QString &p_name);
 
-    // Copy @p_srcFile to @p_destDir, setting new name to @p_destName.
+    // Get the items to transfer to copy @p_srcFile to @p_destDir with new
+    // name @p_destName, including its local images.
     // @p_cut: copy or cut.
+    // @p_skippedImages: images not transferred since a different file with
+    // the same name exists in the target folder.
+    // @p_obsoleteImages: source images to remove once the items are
+    // transferred, since they are not needed after the cut.
+    static QVector<VTransferItem> transferItemsOfFile(VDirectory *p_destDir, const QString &p_destName,
+                                                      VFile *p_srcFile, bool p_cut,
+                                                      QStringList &p_skippedImages,
+                                                      QStringList &p_obsoleteImages);
+
+    // Update the configs after the items of transferItemsOfFile() are
+    // transferred.
     // Returns the dest VFile.
     static VFile *copyFile(VDirectory *p_destDir, const QString &p_destName,
                            VFile *p_srcFile, bool p_cut);
 
+    // Update the configs after @p_srcDir is transferred to be a sub-directory
+    // of @p_destDir with name @p_destName.
     static VDirectory *copyDirectory(VDirectory *p_destDir, const QString &p_destName,
                                      VDirectory *p_srcDir, bool p_cut);
 
+    // Update the configs after @p_srcPath is transferred to @p_destPath by
+    // paths, such as when the VDirectory or VFile objects are gone.
+    // Returns false if the related folders could not be found in any notebook.
+    static bool updateConfigsOfTransfer(const QString &p_srcPath, const QString &p_destPath,
+                                        bool p_isDir, bool p_cut);
+
     inline const QVector<VDirectory *> &getSubDirs() const;
     inline const QString &getName() const;
     inline void setName(const QString &p_name);
     inline bool isOpened() const;
+
+    // Whether openAsync() is in progress.
+    inline bool isLoading() const;
     inline VDirectory *getParentDirectory();
     inline const VDirectory *getParentDirectory() const;
     inline VNotebook *getNotebook();
@@ -90,7 +130,38 @@ public:
     // notebook.
     bool writeToConfig() const;
 
+    // Reload the sub-directories and files from the config file, which may
+    // be changed outside VNote. Existing items are kept.
+    // Removed items are returned in @p_removedDirs and @p_removedFiles. They
+    // are deleted later, so the caller should close their tabs right now.
+    // Returns true if anything changed.
+    bool reloadItems(QVector<VDirectory *> &p_removedDirs, QVector<VFile *> &p_removedFiles);
+
+signals:
+    // Emitted when the loading started by openAsync() finishes.
+    void loaded(bool p_succeed);
+
+private slots:
+    void handleConfigLoaded();
+
 private:
+    // Fill sub-directories named @p_subDirs and files named @p_files and
+    // mark it opened.
+    bool fill(const QStringList &p_subDirs, const QStringList &p_files);
+
+    // Watch or unwatch this directory and the opened directories and files
+    // within it.
+    void setWatched(bool p_watched);
+
+    // Fill from the notebook cache if the config file is not changed.
+    // @p_modified and @p_size will be set to the stat of the config file,
+    // or -1 if it does not exist.
+    bool fillFromCache(const QString &p_path, qint64 &p_modified, qint64 &p_size);
+
+    // Fill from @p_configJson read with config file stat @p_modified and
+    // @p_size, and update the notebook cache.
+    bool fillFromConfig(const QJsonObject &p_configJson, qint64 p_modified, qint64 p_size);
+
     // Get the path of @p_dir recursively
     QString retrivePath(const VDirectory *p_dir) const;
     // Get teh relative path of @p_dir recursively related to the notebook path
@@ -122,6 +193,14 @@ private:
     bool m_opened;
     // Whether expanded in the directory tree.
     bool m_expanded;
+
+    // Created on the first openAsync().
+    QFutureWatcher<QJsonObject> *m_loadWatcher;
+    bool m_loading;
+
+    // Stat of the config file before the reading of openAsync().
+    qint64 m_loadConfigModified;
+    qint64 m_loadConfigSize;
 };
 
 inline const QVector<VDirectory *> &VDirectory::getSubDirs() const
@@ -144,6 +223,11 @@ inline bool VDirectory::isOpened() const
     return m_opened;
 }
 
+inline bool VDirectory::isLoading() const
+{
+    return m_loading;
+}
+
 inline VDirectory *VDirectory::getParentDirectory()
 {
     return (VDirectory *)this->parent();
@@ -8,6 +8,7 @@
 #include "utils/vutils.h"
 #include "veditarea.h"
 #include "vconfigmanager.h"
+#include "vtransferengine.h"
 
 extern VConfigManager vconfig;
 extern VNote *g_vnote;
@@ -162,13 +163,16 @@ void VDirectoryTree::updateDirectoryTreeOne(QTreeWidgetItem *p_parent, int depth
         return;
     }
     VDirectory *dir = getVDirectory(p_parent);
-    if (!dir->open()) {
-        VUtils::showMessage(QMessageBox::Warning, tr("Warning"),
-                            tr("Fail to open folder <span style=\"%1\">%2</span>.")
-                              .arg(vconfig.c_dataTextStyle).arg(dir->getName()), "",
-                            QMessageBox::Ok, QMessageBox::Ok, this);
+    if (!dir->openAsync()) {
+        // Show the expand indicator until it is loaded.
+        p_parent->setChildIndicatorPolicy(QTreeWidgetItem::ShowIndicator);
+        connect(dir, &VDirectory::loaded,
+                this, &VDirectoryTree::handleDirectoryLoaded,
+                Qt::UniqueConnection);
         return;
     }
+
+    p_parent->setChildIndicatorPolicy(QTreeWidgetItem::DontShowIndicatorWhenChildless);
     const QVector<VDirectory *> &subDirs = dir->getSubDirs();
     for (int i = 0; i < subDirs.size(); ++i) {
         VDirectory *subDir = subDirs[i];
@@ -184,6 +188,37 @@ void VDirectoryTree::updateDirectoryTreeOne(QTreeWidgetItem *p_parent, int depth
     }
 }
 
+void VDirectoryTree::handleDirectoryLoaded(bool p_succeed)
+{
+    VDirectory *dir = dynamic_cast<VDirectory *>(sender());
+    if (!dir || !m_notebook || dir->getNotebook() != m_notebook) {
+        return;
+    }
+
+    bool isWidget;
+    QTreeWidgetItem *item = findVDirectory(dir, isWidget);
+    if (!item) {
+        return;
+    }
+
+    if (!p_succeed) {
+        qWarning() << "fail to open folder" << dir->retrivePath();
+        item->setChildIndicatorPolicy(QTreeWidgetItem::DontShowIndicatorWhenChildless);
+        item->setToolTip(0, tr("Fail to open folder %1").arg(dir->getName()));
+        return;
+    }
+
+    if (item->childCount() == 0) {
+        updateDirectoryTreeOne(item, 1);
+
+        // User expanded it while loading. Prefetch the next level.
+        if (item->isExpanded()) {
+            dir->setExpanded(true);
+            updateChildren(item);
+        }
+    }
+}
+
 void VDirectoryTree::handleItemCollapsed(QTreeWidgetItem *p_item)
 {
     VDirectory *dir = getVDirectory(p_item);
@@ -192,8 +227,14 @@ void VDirectoryTree::handleItemCollapsed(QTreeWidgetItem *p_item)
 
 void VDirectoryTree::handleItemExpanded(QTreeWidgetItem *p_item)
 {
-    updateChildren(p_item);
     VDirectory *dir = getVDirectory(p_item);
+    if (!dir->isOpened()) {
+        // Children will be filled when it is loaded.
+        return;
+    }
+
+    // Open the next level in background.
+    updateChildren(p_item);
     dir->setExpanded(true);
 }
 
@@ -400,6 +441,15 @@ void VDirectoryTree::deleteDirectory()
         return;
     }
     VDirectory *curDir = getVDirectory(curItem);
+    if (vnote->getTransferEngine()->isInvolved(curDir->retrivePath())) {
+        VUtils::showMessage(QMessageBox::Information, tr("Information"),
+                            tr("Folder <span style=\"%1\">%2</span> is being copied or moved.")
+                              .arg(vconfig.c_dataTextStyle).arg(curDir->getName()),
+                            tr("Please try again after it finishes."),
+                            QMessageBox::Ok, QMessageBox::Ok, this);
+        return;
+    }
+
     int ret = VUtils::showMessage(QMessageBox::Warning, tr("Warning"),
                                   tr("Are you sure to delete folder <span style=\"%1\">%2</span>?")
                                     .arg(vconfig.c_dataTextStyle).arg(curDir->getName()),
@@ -534,7 +584,7 @@ void VDirectoryTree::pasteDirectories(VDirectory *p_destDir)
     Q_ASSERT(!clip.isEmpty() && clip["operation"] == (int)ClipboardOpType::CopyDir);
     bool isCut = clip["is_cut"].toBool();
 
-    int nrPasted = 0;
+    int nrQueued = 0;
     for (int i = 0; i < m_copiedDirs.size(); ++i) {
         QPointer<VDirectory> srcDir = m_copiedDirs[i];
         if (!srcDir) {
@@ -544,14 +594,16 @@ void VDirectoryTree::pasteDirectories(VDirectory *p_destDir)
         VDirectory *srcParentDir = srcDir->getParentDirectory();
         if (srcParentDir == p_destDir && !isCut) {
             // Copy and paste in the same directory.
-            // Rename it to xx_copy
-            dirName = VUtils::generateCopiedDirName(srcParentDir->retrivePath(), dirName);
+            // Rename it to xx_copy, skipping the names of queued copies.
+            QString parentPath = srcParentDir->retrivePath();
+            dirName = VUtils::generateCopiedDirName(parentPath, dirName,
+                                                    vnote->getTransferEngine()->reservedNames(parentPath));
         }
         if (copyDirectory(p_destDir, dirName, srcDir, isCut)) {
-            nrPasted++;
+            nrQueued++;
         }
     }
-    qDebug() << "pasted" << nrPasted << "files successfully";
+    qDebug() << "queued" << nrQueued << "folders to paste";
     clipboard->clear();
     m_copiedDirs.clear();
 }
@@ -616,15 +668,63 @@ bool VDirectoryTree::copyDirectory(VDirectory *p_destDir, const QString &p_destN
 {
     qDebug() << "copy" << p_srcDir->getName() << "to" << p_destDir->getName()
              << "as" << p_destName;
-    QString srcName = p_srcDir->getName();
     QString srcPath = QDir::cleanPath(p_srcDir->retrivePath());
     QString destPath = QDir::cleanPath(QDir(p_destDir->retrivePath()).filePath(p_destName));
     if (srcPath == destPath) {
         return true;
     }
 
-    VDirectory *srcParentDir = p_srcDir->getParentDirectory();
-    VDirectory *destDir = VDirectory::copyDirectory(p_destDir, p_destName, p_srcDir, p_cut);
+    // Notes within it could not be opened until it is moved.
+    if (p_cut && !m_editArea->closeFile(p_srcDir, false)) {
+        return false;
+    }
+
+    QVector<VTransferItem> items;
+    items.append(VTransferItem(srcPath, destPath, p_cut));
+    VTransferJob *job = vnote->getTransferEngine()->addJob(
+        (p_cut ? tr("Moving folder %1") : tr("Copying folder %1")).arg(p_srcDir->getName()),
+        items);
+
+    // The data is moved before the configs are updated.
+    QPointer<VDirectory> destDir(p_destDir);
+    QPointer<VDirectory> srcDir(p_srcDir);
+    connect(job, &VTransferJob::finished,
+            this, [this, job, destDir, p_destName, srcDir, p_cut](bool p_succeed) {
+                handleDirectoryCopied(job, p_succeed, destDir, p_destName, srcDir, p_cut);
+            });
+    return true;
+}
+
+void VDirectoryTree::handleDirectoryCopied(const VTransferJob *p_job, bool p_succeed,
+                                           VDirectory *p_destDir, const QString &p_destName,
+                                           VDirectory *p_srcDir, bool p_cut)
+{
+    // A job cancelled too late still succeeds. The cancellation is shown in
+    // the status bar by VMainWindow.
+    if (!p_succeed && p_job->isCancelled()) {
+        return;
+    }
+
+    VDirectory *destDir = NULL;
+    VDirectory *srcParentDir = NULL;
+    if (p_succeed && p_destDir && p_srcDir) {
+        srcParentDir = p_srcDir->getParentDirectory();
+        destDir = VDirectory::copyDirectory(p_destDir, p_destName, p_srcDir, p_cut);
+    } else if (p_succeed) {
+        // The folders are gone during the transfer while the data has been
+        // transferred. Update the configs by the recorded paths or move the
+        // data back.
+        const VTransferItem &item = p_job->getItems().first();
+        if (VDirectory::updateConfigsOfTransfer(item.m_srcPath, item.m_destPath,
+                                                true, p_cut)) {
+            updateDirectoryTree();
+            return;
+        }
+
+        if (!VTransferEngine::revert(p_job)) {
+            qWarning() << "fail to revert the transfer of folder" << item.m_srcPath;
+        }
+    }
 
     if (destDir) {
         // Update QTreeWidget
@@ -644,14 +744,17 @@ bool VDirectoryTree::copyDirectory(VDirectory *p_destDir, const QString &p_destN
         // Broadcast this update
         emit directoryUpdated(destDir);
     } else {
+        QString info = p_job->getErrorString();
+        if (info.isEmpty()) {
+            info = tr("Please check if there already exists a folder with the same name.");
+        }
+
         VUtils::showMessage(QMessageBox::Warning, tr("Warning"),
                             tr("Fail to copy folder <span style=\"%1\">%2</span>.")
-                              .arg(vconfig.c_dataTextStyle).arg(srcName),
-                            tr("Please check if there already exists a folder with the same name."),
-                            QMessageBox::Ok, QMessageBox::Ok, this);
+                              .arg(vconfig.c_dataTextStyle)
+                              .arg(VUtils::fileNameFromPath(p_job->getItems().first().m_srcPath)),
+                            info, QMessageBox::Ok, QMessageBox::Ok, this);
     }
-
-    return destDir;
 }
 
 QTreeWidgetItem *VDirectoryTree::findVDirectory(const VDirectory *p_dir, bool &p_widget)
@@ -690,6 +793,19 @@ QTreeWidgetItem *VDirectoryTree::findVDirectory(const VDirectory *p_dir, bool &p
     return NULL;
 }
 
+void VDirectoryTree::updateDirectoryChildren(const VDirectory *p_dir)
+{
+    if (!m_notebook || p_dir->getNotebook() != m_notebook) {
+        return;
+    }
+
+    bool isRoot;
+    QTreeWidgetItem *item = findVDirectory(p_dir, isRoot);
+    if (item || isRoot) {
+        updateItemChildren(item);
+    }
+}
+
 bool VDirectoryTree::locateDirectory(const VDirectory *p_directory)
 {
     if (p_directory) {
@@ -23,6 +23,9 @@ public:
     explicit VDirectoryTree(VNote *vnote, QWidget *parent = 0);
     inline void setEditArea(VEditArea *p_editArea);
     bool locateDirectory(const VDirectory *p_directory);
+
+    // Sub-directories of @p_dir have been reloaded. Update its item.
+    void updateDirectoryChildren(const VDirectory *p_dir);
     inline const VNotebook *currentNotebook() const;
 
     // Implementations for VNavigationMode.
@@ -53,11 +56,17 @@ private slots:
     void pasteDirectoriesInCurDir();
     void openDirectoryLocation() const;
 
+    // A directory opened in background is loaded.
+    void handleDirectoryLoaded(bool p_succeed);
+
 protected:
     void mousePressEvent(QMouseEvent *event) Q_DECL_OVERRIDE;
     void keyPressEvent(QKeyEvent *event) Q_DECL_OVERRIDE;
 
 private:
+    // Fill the children of @p_parent up to @depth levels.
+    // If the directory of @p_parent is not opened yet, it will be opened in
+    // background and its children will be filled after it is loaded.
     void updateDirectoryTreeOne(QTreeWidgetItem *p_parent, int depth);
     void fillTreeItem(QTreeWidgetItem &p_item, const QString &p_name,
                       VDirectory *p_directory, const QIcon &p_icon);
@@ -70,8 +79,15 @@ private:
     inline QPointer<VDirectory> getVDirectory(QTreeWidgetItem *p_item) const;
     void copyDirectoryInfoToClipboard(const QJsonArray &p_dirs, bool p_cut);
     void pasteDirectories(VDirectory *p_destDir);
+    // Copy @p_srcDir to @p_destDir with name @p_destName in background.
+    // Returns false if it is not started.
     bool copyDirectory(VDirectory *p_destDir, const QString &p_destName,
                        VDirectory *p_srcDir, bool p_cut);
+
+    // Update the configs and the tree after the copy job @p_job finished.
+    void handleDirectoryCopied(const VTransferJob *p_job, bool p_succeed,
+                               VDirectory *p_destDir, const QString &p_destName,
+                               VDirectory *p_srcDir, bool p_cut);
     void updateChildren(QTreeWidgetItem *p_item);
     // Expand/create the directory tree nodes to @p_directory.
     QTreeWidgetItem *expandToVDirectory(const VDirectory *p_directory);
@@ -1,4 +1,5 @@
 #include <QtWidgets>
+#include <QtConcurrent>
 #include <QVector>
 #include <QDebug>
 #include "vedit.h"
@@ -6,13 +7,21 @@
 #include "vconfigmanager.h"
 #include "vtoc.h"
 #include "utils/vutils.h"
+#include "utils/veditutils.h"
 #include "veditoperations.h"
 #include "dialog/vfindreplacedialog.h"
 #include "vedittab.h"
+#include "vundohistory.h"
 
 extern VConfigManager vconfig;
 extern VNote *g_vnote;
 
+// Trailing spaces of the block are not computed yet.
+static const int c_trailingSpaceUnknown = -2;
+
+// The block has no trailing spaces.
+static const int c_trailingSpaceNone = -1;
+
 void VEditConfig::init(const QFontMetrics &p_metric)
 {
     if (vconfig.getTabStopWidth() > 0) {
@@ -37,10 +46,12 @@ void VEditConfig::init(const QFontMetrics &p_metric)
 }
 
 VEdit::VEdit(VFile *p_file, QWidget *p_parent)
-    : QTextEdit(p_parent), m_file(p_file), m_editOps(NULL)
+    : QTextEdit(p_parent), m_file(p_file), m_editOps(NULL),
+      m_largeFileMode(false), m_undoHistory(NULL), m_matchesRevision(-1), m_searchCancel(0),
+      m_searchRevision(-1), m_hasPendingSearch(false), m_peekPos(-1),
+      m_peekLastPos(-1), m_peekPending(false)
 {
     const int labelTimerInterval = 500;
-    const int extraSelectionHighlightTimer = 500;
     const int labelSize = 64;
 
     m_selectedWordColor = QColor("Yellow");
@@ -57,16 +68,11 @@ VEdit::VEdit(VFile *p_file, QWidget *p_parent)
     connect(m_labelTimer, &QTimer::timeout,
             this, &VEdit::labelTimerTimeout);
 
-    m_highlightTimer = new QTimer(this);
-    m_highlightTimer->setSingleShot(true);
-    m_highlightTimer->setInterval(extraSelectionHighlightTimer);
-    connect(m_highlightTimer, &QTimer::timeout,
-            this, &VEdit::doHighlightExtraSelections);
-
     connect(document(), &QTextDocument::modificationChanged,
             (VFile *)m_file, &VFile::setModified);
 
-    m_extraSelections.resize((int)SelectionId::MaxSelection);
+    m_matchers.resize((int)SelectionId::MaxSelection);
+    m_matches.resize((int)SelectionId::MaxSelection);
 
     updateFontAndPalette();
 
@@ -77,10 +83,21 @@ VEdit::VEdit(VFile *p_file, QWidget *p_parent)
 
     connect(this, &VEdit::selectionChanged,
             this, &VEdit::highlightSelectedWord);
+
+    // Trailing spaces and matches are painted only within the dirty region.
+    connect(document(), &QTextDocument::contentsChange,
+            this, &VEdit::handleContentsChange);
+
+    m_searchWatcher = new QFutureWatcher<VTextMatches>(this);
+    connect(m_searchWatcher, &QFutureWatcher<VTextMatches>::finished,
+            this, &VEdit::handleSearchFinished);
 }
 
 VEdit::~VEdit()
 {
+    m_searchCancel.store(1);
+    m_searchWatcher->waitForFinished();
+
     if (m_file) {
         disconnect(document(), &QTextDocument::modificationChanged,
                    (VFile *)m_file, &VFile::setModified);
@@ -159,39 +176,272 @@ void VEdit::insertImage()
     }
 }
 
+// Search in background and peek the first match after the start position.
+// Matches within the viewport are highlighted and peeked at once.
 bool VEdit::peekText(const QString &p_text, uint p_options)
 {
-    static int startPos = textCursor().selectionStart();
-    static int lastPos = startPos;
-    bool found = false;
+    QTextCursor cursor = textCursor();
+    int curPos = cursor.selectionStart();
+    if (m_peekPos == -1 || curPos != m_peekLastPos) {
+        // Cursor has been moved. Just start at current potition.
+        m_peekPos = curPos;
+        m_peekLastPos = curPos;
+    }
+
+    // Clear previous selection.
+    cursor.setPosition(m_peekPos);
+    setTextCursor(cursor);
 
     if (p_text.isEmpty()) {
-        // Clear previous selection
-        QTextCursor cursor = textCursor();
-        cursor.clearSelection();
-        cursor.setPosition(startPos);
-        setTextCursor(cursor);
-    } else {
-        QTextCursor cursor = textCursor();
-        int curPos = cursor.selectionStart();
-        if (curPos != lastPos) {
-            // Cursor has been moved. Just start at current potition.
-            startPos = curPos;
-            lastPos = curPos;
-        } else {
-            cursor.setPosition(startPos);
-            setTextCursor(cursor);
+        highlightTextAll("", p_options, SelectionId::SearchedKeyword);
+        emit searchMatchesChanged();
+        return false;
+    }
+
+    cancelSearch();
+
+    VTextMatcher matcher(p_text, p_options);
+    QTextDocument *doc = document();
+    int first, last;
+    visibleBlockRange(first, last);
+    QTextBlock lastBlock = doc->findBlockByNumber(last);
+    int startPos = doc->findBlockByNumber(first).position();
+    int endPos = lastBlock.position() + lastBlock.length() - 1;
+    cursor.setPosition(startPos);
+    cursor.setPosition(endPos, QTextCursor::KeepAnchor);
+
+    // Matches within the viewport only, which are replaced once the
+    // search finishes.
+    int id = (int)SelectionId::SearchedKeyword;
+    m_matchers[id] = VTextMatcher();
+    m_matches[id].clear();
+    matcher.findAll(VEditUtils::selectedText(cursor), m_matches[id], startPos);
+    viewport()->update();
+
+    bool found = false;
+    m_peekPending = true;
+    if (m_peekPos >= startPos && m_peekPos <= endPos) {
+        const VTextMatches &matches = m_matches[id];
+        for (int i = matches.lowerBound(m_peekPos); i < matches.size(); ++i) {
+            if (matches.position(i) >= m_peekPos) {
+                selectPeekedMatch(i);
+                found = true;
+                break;
+            }
         }
     }
-    bool wrapped = false;
-    found = findTextHelper(p_text, p_options, true, wrapped);
-    if (found) {
-        lastPos = textCursor().selectionStart();
-        found = true;
+
+    if (matcher.isValid()) {
+        searchAsync(matcher);
+    } else {
+        m_peekPending = false;
     }
+
+    emit searchMatchesChanged();
     return found;
 }
 
+void VEdit::selectPeekedMatch(int p_idx)
+{
+    const VTextMatches &matches = m_matches[(int)SelectionId::SearchedKeyword];
+    int pos = matches.position(p_idx);
+    QTextCursor cursor = textCursor();
+    cursor.setPosition(pos);
+    cursor.setPosition(pos + matches.length(p_idx), QTextCursor::KeepAnchor);
+    setTextCursor(cursor);
+
+    m_peekLastPos = pos;
+    m_peekPending = false;
+}
+
+void VEdit::searchAsync(const VTextMatcher &p_matcher)
+{
+    if (m_searchWatcher->isRunning()) {
+        m_searchCancel.store(1);
+        m_pendingSearch = p_matcher;
+        m_hasPendingSearch = true;
+        return;
+    }
+
+    startSearch(p_matcher);
+}
+
+void VEdit::startSearch(const VTextMatcher &p_matcher)
+{
+    m_hasPendingSearch = false;
+    m_searchCancel.store(0);
+    m_searchMatcher = p_matcher;
+    m_searchRevision = contentRevision();
+
+    QString text = toPlainText();
+    m_searchWatcher->setFuture(QtConcurrent::run([this, p_matcher, text]() {
+        VTextMatches matches;
+        p_matcher.findAll(text, matches, 0, &m_searchCancel);
+        return matches;
+    }));
+}
+
+void VEdit::cancelSearch()
+{
+    m_hasPendingSearch = false;
+    m_pendingSearch = VTextMatcher();
+    m_searchMatcher = VTextMatcher();
+    m_peekPending = false;
+    if (m_searchWatcher->isRunning()) {
+        m_searchCancel.store(1);
+    }
+}
+
+void VEdit::handleSearchFinished()
+{
+    if (m_hasPendingSearch) {
+        // Drop the stale results.
+        startSearch(m_pendingSearch);
+        return;
+    }
+
+    if (!m_searchMatcher.isValid()) {
+        // Cancelled.
+        return;
+    }
+
+    if (contentRevision() != m_searchRevision) {
+        // The snapshot is out of date.
+        startSearch(m_searchMatcher);
+        return;
+    }
+
+    int id = (int)SelectionId::SearchedKeyword;
+    m_matchers[id] = m_searchMatcher;
+    m_matches[id] = m_searchWatcher->result();
+    m_matchesRevision = m_searchRevision;
+    m_searchMatcher = VTextMatcher();
+
+    if (m_peekPending) {
+        // Peek the first match after the start position, or wrap.
+        m_peekPending = false;
+        const VTextMatches &matches = m_matches[id];
+        int idx = matches.lowerBound(m_peekPos);
+        while (idx < matches.size() && matches.position(idx) < m_peekPos) {
+            ++idx;
+        }
+
+        if (idx == matches.size()) {
+            idx = 0;
+        }
+
+        if (idx < matches.size()) {
+            selectPeekedMatch(idx);
+        }
+    }
+
+    viewport()->update();
+
+    emit searchMatchesChanged();
+}
+
+void VEdit::getSearchMatchInfo(int &p_index, int &p_count) const
+{
+    p_index = 0;
+    p_count = -1;
+
+    int id = (int)SelectionId::SearchedKeyword;
+    if (!m_matchers[id].isValid()) {
+        return;
+    }
+
+    const VTextMatches &matches = m_matches[id];
+    p_count = matches.size();
+
+    QTextCursor cursor = textCursor();
+    int idx = matches.lowerBound(cursor.selectionStart());
+    if (idx < matches.size()
+        && matches.position(idx) == cursor.selectionStart()
+        && matches.position(idx) + matches.length(idx) == cursor.selectionEnd()) {
+        p_index = idx + 1;
+    }
+}
+
+bool VEdit::isUndoAvailable() const
+{
+    if (m_undoHistory) {
+        return m_undoHistory->canUndo();
+    }
+
+    return document()->isUndoAvailable();
+}
+
+bool VEdit::isRedoAvailable() const
+{
+    if (m_undoHistory) {
+        return m_undoHistory->canRedo();
+    }
+
+    return document()->isRedoAvailable();
+}
+
+void VEdit::undoChange()
+{
+    if (m_undoHistory) {
+        afterUndoRedo(m_undoHistory->undo());
+    } else {
+        undo();
+    }
+}
+
+void VEdit::redoChange()
+{
+    if (m_undoHistory) {
+        afterUndoRedo(m_undoHistory->redo());
+    } else {
+        redo();
+    }
+}
+
+void VEdit::afterUndoRedo(int p_pos)
+{
+    if (p_pos == -1) {
+        return;
+    }
+
+    QTextCursor cursor = textCursor();
+    cursor.setPosition(p_pos);
+    setTextCursor(cursor);
+
+    setModified(!m_undoHistory->isClean());
+}
+
+void VEdit::getUndoInfo(int &p_steps, qint64 &p_bytes) const
+{
+    if (m_undoHistory) {
+        p_steps = m_undoHistory->undoSteps();
+        p_bytes = m_undoHistory->bytes();
+    } else {
+        p_steps = -1;
+        p_bytes = 0;
+    }
+}
+
+int VEdit::contentRevision() const
+{
+    if (m_undoHistory) {
+        return m_undoHistory->revision();
+    }
+
+    return document()->revision();
+}
+
+void VEdit::handleContentsChange(int p_position, int p_charsRemoved, int p_charsAdded)
+{
+    // The history should be updated first to bump the revision.
+    if (m_undoHistory) {
+        m_undoHistory->handleContentsChange(p_position, p_charsRemoved, p_charsAdded);
+    }
+
+    invalidateTrailingSpace(p_position, p_charsRemoved, p_charsAdded);
+    updateMatches(p_position, p_charsRemoved, p_charsAdded);
+}
+
 // Use QTextEdit::find() instead of QTextDocument::find() because the later has
 // bugs in searching backward.
 bool VEdit::findTextHelper(const QString &p_text, uint p_options,
@@ -250,49 +500,6 @@ bool VEdit::findTextHelper(const QString &p_text, uint p_options,
     return found;
 }
 
-QList<QTextCursor> VEdit::findTextAll(const QString &p_text, uint p_options)
-{
-    QList<QTextCursor> results;
-    if (p_text.isEmpty()) {
-        return results;
-    }
-    // Options
-    QTextDocument::FindFlags findFlags;
-    bool caseSensitive = false;
-    if (p_options & FindOption::CaseSensitive) {
-        findFlags |= QTextDocument::FindCaseSensitively;
-        caseSensitive = true;
-    }
-    if (p_options & FindOption::WholeWordOnly) {
-        findFlags |= QTextDocument::FindWholeWords;
-    }
-    // Use regular expression
-    bool useRegExp = false;
-    QRegExp exp;
-    if (p_options & FindOption::RegularExpression) {
-        useRegExp = true;
-        exp = QRegExp(p_text,
-                      caseSensitive ? Qt::CaseSensitive : Qt::CaseInsensitive);
-    }
-    int startPos = 0;
-    QTextCursor cursor;
-    QTextDocument *doc = document();
-    while (true) {
-        if (useRegExp) {
-            cursor = doc->find(exp, startPos, findFlags);
-        } else {
-            cursor = doc->find(p_text, startPos, findFlags);
-        }
-        if (cursor.isNull()) {
-            break;
-        } else {
-            results.append(cursor);
-            startPos = cursor.selectionEnd();
-        }
-    }
-    return results;
-}
-
 bool VEdit::findText(const QString &p_text, uint p_options, bool p_forward)
 {
     bool found = false;
@@ -303,16 +510,15 @@ bool VEdit::findText(const QString &p_text, uint p_options, bool p_forward)
     } else {
         bool wrapped = false;
         found = findTextHelper(p_text, p_options, p_forward, wrapped);
-        if (found) {
-            if (wrapped) {
-                showWrapLabel();
-            }
-            highlightSearchedWord(p_text, p_options);
-        } else {
-            // Simply clear previous highlight.
-            highlightSearchedWord("", p_options);
+        if (found && wrapped) {
+            showWrapLabel();
         }
+
+        // It clears previous highlight if not found.
+        highlightSearchedWord(p_text, p_options);
     }
+
+    emit searchMatchesChanged();
     qDebug() << "findText" << p_text << p_options << p_forward
              << (found ? "Found" : "NotFound");
     return found;
@@ -337,9 +543,14 @@ void VEdit::replaceText(const QString &p_text, uint p_options,
                       && (cursor.selectionEnd() == tmpCursor.selectionEnd());
         }
         if (matched) {
+            QTextBlock block = document()->findBlock(cursor.selectionStart());
+            VTextMatcher matcher(p_text, p_options);
+            QString replaceText = matcher.replacement(block.text(),
+                                                      cursor.selectionStart() - block.position(),
+                                                      p_replaceText);
             cursor.beginEditBlock();
             cursor.removeSelectedText();
-            cursor.insertText(p_replaceText);
+            cursor.insertText(replaceText);
             cursor.endEditBlock();
             setTextCursor(cursor);
         } else {
@@ -354,35 +565,37 @@ void VEdit::replaceText(const QString &p_text, uint p_options,
 void VEdit::replaceTextAll(const QString &p_text, uint p_options,
                            const QString &p_replaceText)
 {
-    // Replace from the start to the end and resotre the cursor.
+    VTextMatcher matcher(p_text, p_options);
+    QString text = toPlainText();
+    VTextMatches matches;
+    matcher.findAll(text, matches);
+
+    // Replace from the end within one edit block, so it is one undo step
+    // and unchanged blocks are kept. The cursor is adjusted by the document.
     QTextCursor cursor = textCursor();
+    QTextCursor tmpCursor(document());
     int nrReplaces = 0;
-    QTextCursor tmpCursor = cursor;
-    tmpCursor.setPosition(0);
-    setTextCursor(tmpCursor);
-    while (true) {
-        bool wrapped = false;
-        bool found = findTextHelper(p_text, p_options, true, wrapped);
-        if (!found) {
-            break;
-        } else {
-            if (wrapped) {
-                // Wrap back.
-                break;
-            }
-            nrReplaces++;
-            tmpCursor = textCursor();
-            tmpCursor.beginEditBlock();
-            tmpCursor.removeSelectedText();
-            tmpCursor.insertText(p_replaceText);
-            tmpCursor.endEditBlock();
-            setTextCursor(tmpCursor);
+    tmpCursor.beginEditBlock();
+    for (int i = matches.size() - 1; i >= 0; --i) {
+        int pos = matches.position(i);
+        int len = matches.length(i);
+        QString replaceText = matcher.replacement(text, pos, p_replaceText);
+        if (text.midRef(pos, len) == replaceText) {
+            continue;
         }
+
+        tmpCursor.setPosition(pos);
+        tmpCursor.setPosition(pos + len, QTextCursor::KeepAnchor);
+        tmpCursor.insertText(replaceText);
+        ++nrReplaces;
     }
+    tmpCursor.endEditBlock();
+
     // Restore cursor position.
     cursor.clearSelection();
     setTextCursor(cursor);
     qDebug() << "replace all" << nrReplaces << "occurences";
+    emit statusMessage(tr("%1 occurrences replaced").arg(nrReplaces));
 }
 
 void VEdit::showWrapLabel()
@@ -414,69 +627,157 @@ void VEdit::updateFontAndPalette()
     setPalette(vconfig.getBaseEditPalette());
 }
 
-void VEdit::highlightExtraSelections(bool p_now)
+void VEdit::highlightCurrentLine()
 {
-    m_highlightTimer->stop();
-    if (p_now) {
-        doHighlightExtraSelections();
-    } else {
-        m_highlightTimer->start();
+    QRectF rect;
+    if (vconfig.getHighlightCursorLine() && !isReadOnly()) {
+        rect = cursorLineRect();
     }
+
+    if (rect == m_cursorLineRect) {
+        return;
+    }
+
+    // Repaint only the old and new cursor lines.
+    updateDocumentRect(m_cursorLineRect);
+    updateDocumentRect(rect);
+    m_cursorLineRect = rect;
 }
 
-void VEdit::doHighlightExtraSelections()
+QRectF VEdit::cursorLineRect() const
 {
-    int nrExtra = m_extraSelections.size();
-    Q_ASSERT(nrExtra == (int)SelectionId::MaxSelection);
-    QList<QTextEdit::ExtraSelection> extraSelects;
-    for (int i = 0; i < nrExtra; ++i) {
-        extraSelects.append(m_extraSelections[i]);
+    QTextCursor cursor = textCursor();
+    QTextBlock block = cursor.block();
+    QRectF rect = document()->documentLayout()->blockBoundingRect(block);
+    if (m_config.m_highlightWholeBlock) {
+        return rect;
+    }
+
+    // A long block maybe splited into multiple visual lines.
+    QTextLine line = block.layout()->lineForTextPosition(cursor.positionInBlock());
+    if (line.isValid()) {
+        rect = QRectF(rect.left(), rect.top() + line.y(), rect.width(), line.height());
     }
 
-    setExtraSelections(extraSelects);
+    return rect;
 }
 
-void VEdit::highlightCurrentLine()
+void VEdit::updateDocumentRect(const QRectF &p_rect)
 {
-    QList<QTextEdit::ExtraSelection> &selects = m_extraSelections[(int)SelectionId::CurrentLine];
-    if (vconfig.getHighlightCursorLine() && !isReadOnly()) {
-        // Need to highlight current line.
-        selects.clear();
+    if (p_rect.isEmpty()) {
+        return;
+    }
 
-        // A long block maybe splited into multiple visual lines.
-        QTextEdit::ExtraSelection select;
-        select.format.setBackground(m_config.m_cursorLineBg);
-        select.format.setProperty(QTextFormat::FullWidthSelection, true);
+    // Full width.
+    int top = qFloor(p_rect.top()) - verticalScrollBar()->value();
+    viewport()->update(0, top, viewport()->width(), qCeil(p_rect.height()) + 1);
+}
 
-        QTextCursor cursor = textCursor();
-        if (m_config.m_highlightWholeBlock) {
-            cursor.movePosition(QTextCursor::StartOfBlock, QTextCursor::MoveAnchor, 1);
-            QTextBlock block = cursor.block();
-            int blockEnd = block.position() + block.length();
-            int pos = -1;
-            while (cursor.position() < blockEnd && pos != cursor.position()) {
-                QTextEdit::ExtraSelection newSelect = select;
-                newSelect.cursor = cursor;
-                selects.append(newSelect);
-
-                pos = cursor.position();
-                cursor.movePosition(QTextCursor::Down, QTextCursor::MoveAnchor, 1);
+void VEdit::paintEvent(QPaintEvent *p_event)
+{
+    // Paint the decorations of the blocks within the dirty region only.
+    // The text is painted above them.
+    {
+        QPainter painter(viewport());
+        QRect rect = p_event->rect();
+        QPointF offset(-horizontalScrollBar()->value(), -verticalScrollBar()->value());
+
+        if (vconfig.getHighlightCursorLine() && !isReadOnly()) {
+            QRectF lineRect = cursorLineRect();
+            lineRect.setLeft(0);
+            lineRect.setWidth(viewport()->width());
+            painter.fillRect(lineRect.translated(0, offset.y()), m_config.m_cursorLineBg);
+        }
+
+        QTextDocument *doc = document();
+        QAbstractTextDocumentLayout *layout = doc->documentLayout();
+        int startPos = layout->hitTest(QPointF(0, rect.top() - offset.y()), Qt::FuzzyHit);
+        int endPos = layout->hitTest(QPointF(0, rect.bottom() - offset.y()), Qt::FuzzyHit);
+        QTextBlock firstBlock = startPos < 0 ? doc->begin() : doc->findBlock(startPos);
+        QTextBlock lastBlock = endPos < 0 ? doc->lastBlock() : doc->findBlock(endPos);
+        startPos = firstBlock.position();
+        endPos = lastBlock.position() + lastBlock.length();
+
+        fillMatches(painter, SelectionId::SelectedWord, m_selectedWordColor,
+                    startPos, endPos, offset);
+
+        if (vconfig.getHighlightSearchedWord()) {
+            fillMatches(painter, SelectionId::SearchedKeyword, m_searchedWordColor,
+                        startPos, endPos, offset);
+        }
+
+        if (vconfig.getEnableTrailingSpaceHighlight()) {
+            // Do not highlight trailing spaces with current cursor right behind.
+            QTextCursor cursor = textCursor();
+            int cursorBlock = cursor.atBlockEnd() ? cursor.blockNumber() : -1;
+            int lastNum = lastBlock.blockNumber();
+            for (QTextBlock block = firstBlock;
+                 block.isValid() && block.blockNumber() <= lastNum;
+                 block = block.next()) {
+                if (!block.isVisible() || block.blockNumber() == cursorBlock) {
+                    continue;
+                }
+
+                int start = trailingSpaceOfBlock(block);
+                if (start != c_trailingSpaceNone) {
+                    fillBlockRange(painter, block, start, block.length() - 1,
+                                   m_trailingSpaceColor, offset);
+                }
             }
-        } else {
-            cursor.clearSelection();
-            select.cursor = cursor;
-            selects.append(select);
         }
-    } else {
-        // Need to clear current line highlight.
-        if (selects.isEmpty()) {
-            return;
+    }
+
+    QTextEdit::paintEvent(p_event);
+}
+
+void VEdit::fillBlockRange(QPainter &p_painter, const QTextBlock &p_block,
+                           int p_start, int p_end, const QColor &p_color,
+                           const QPointF &p_offset) const
+{
+    QTextLayout *layout = p_block.layout();
+    QTextLine line = layout->lineForTextPosition(p_start);
+    if (!line.isValid()) {
+        return;
+    }
+
+    QPointF pos = document()->documentLayout()->blockBoundingRect(p_block).topLeft()
+                  + p_offset;
+    // The range may span multiple visual lines.
+    for (int i = line.lineNumber(); i < layout->lineCount(); ++i) {
+        line = layout->lineAt(i);
+        if (line.textStart() >= p_end) {
+            break;
         }
 
-        selects.clear();
+        int start = qMax(p_start, line.textStart());
+        int end = qMin(p_end, line.textStart() + line.textLength());
+        qreal x1 = line.cursorToX(start);
+        qreal x2 = line.cursorToX(end);
+        QRectF rect(qMin(x1, x2), line.y(), qAbs(x2 - x1), line.height());
+        p_painter.fillRect(rect.translated(pos), p_color);
     }
+}
+
+void VEdit::fillMatches(QPainter &p_painter, SelectionId p_id, const QColor &p_color,
+                        int p_startPos, int p_endPos, const QPointF &p_offset) const
+{
+    const VTextMatches &matches = m_matches[(int)p_id];
+    QTextBlock block;
+    for (int i = matches.lowerBound(p_startPos);
+         i < matches.size() && matches.position(i) < p_endPos;
+         ++i) {
+        int pos = matches.position(i);
+        if (!block.isValid() || pos >= block.position() + block.length()) {
+            block = document()->findBlock(pos);
+        }
+
+        if (!block.isVisible()) {
+            continue;
+        }
 
-    highlightExtraSelections(true);
+        int start = pos - block.position();
+        fillBlockRange(p_painter, block, start, start + matches.length(i), p_color, p_offset);
+    }
 }
 
 void VEdit::setReadOnly(bool p_ro)
@@ -487,131 +788,189 @@ void VEdit::setReadOnly(bool p_ro)
 
 void VEdit::highlightSelectedWord()
 {
-    QList<QTextEdit::ExtraSelection> &selects = m_extraSelections[(int)SelectionId::SelectedWord];
-    if (!vconfig.getHighlightSelectedWord()) {
-        if (!selects.isEmpty()) {
-            selects.clear();
-            highlightExtraSelections(true);
+    QString text;
+    if (vconfig.getHighlightSelectedWord() && !m_largeFileMode) {
+        text = textCursor().selectedText().trimmed();
+        if (wordInSearchedSelection(text)) {
+            text.clear();
         }
+    }
+
+    highlightTextAll(text, FindOption::CaseSensitive, SelectionId::SelectedWord);
+}
 
+void VEdit::updateMatches(int p_position, int p_charsRemoved, int p_charsAdded)
+{
+    // Layout changes by the highlighter do not change the revision.
+    QTextDocument *doc = document();
+    int revision = contentRevision();
+    if (p_charsRemoved == p_charsAdded && revision == m_matchesRevision) {
         return;
     }
 
-    QString text = textCursor().selectedText().trimmed();
-    if (text.isEmpty() || wordInSearchedSelection(text)) {
-        selects.clear();
-        highlightExtraSelections(true);
-        return;
+    m_matchesRevision = revision;
+
+    // Re-match the changed blocks.
+    QTextBlock firstBlock = doc->findBlock(p_position);
+    QTextBlock lastBlock = doc->findBlock(p_position + p_charsAdded);
+    if (!firstBlock.isValid()) {
+        firstBlock = doc->lastBlock();
     }
 
-    QTextCharFormat format;
-    format.setBackground(m_selectedWordColor);
-    highlightTextAll(text, FindOption::CaseSensitive, SelectionId::SelectedWord,
-                     format);
+    if (!lastBlock.isValid()) {
+        lastBlock = doc->lastBlock();
+    }
+
+    int start = firstBlock.position();
+    int newEnd = lastBlock.position() + lastBlock.length() - 1;
+    int oldEnd = newEnd - p_charsAdded + p_charsRemoved;
+    QString text;
+    for (int i = 0; i < m_matchers.size(); ++i) {
+        if (!m_matchers[i].isValid()) {
+            continue;
+        }
+
+        if (text.isNull()) {
+            QTextCursor cursor(doc);
+            cursor.setPosition(start);
+            cursor.setPosition(newEnd, QTextCursor::KeepAnchor);
+            text = VEditUtils::selectedText(cursor);
+        }
+
+        VTextMatches matches;
+        m_matchers[i].findAll(text, matches, start);
+        m_matches[i].replace(start, oldEnd, newEnd, matches);
+    }
 }
 
-// Do not highlight trailing spaces with current cursor right behind.
-static void trailingSpaceFilter(VEdit *p_editor, QList<QTextEdit::ExtraSelection> &p_result)
+int VEdit::trailingSpaceOfBlock(const QTextBlock &p_block)
 {
-    QTextCursor cursor = p_editor->textCursor();
-    if (!cursor.atBlockEnd()) {
-        return;
+    int num = p_block.blockNumber();
+    if (num >= m_trailingSpaceCache.size()) {
+        m_trailingSpaceCache.resize(document()->blockCount());
+        m_trailingSpaceCache.fill(c_trailingSpaceUnknown);
     }
 
-    int cursorPos = cursor.position();
-    for (auto it = p_result.begin(); it != p_result.end(); ++it) {
-        if (it->cursor.selectionEnd() == cursorPos) {
-            p_result.erase(it);
-
-            // There will be only one.
-            return;
+    int &start = m_trailingSpaceCache[num];
+    if (start == c_trailingSpaceUnknown) {
+        QString text = p_block.text();
+        int idx = text.size();
+        while (idx > 0 && text[idx - 1].isSpace()) {
+            --idx;
         }
+
+        start = idx == text.size() ? c_trailingSpaceNone : idx;
     }
+
+    return start;
 }
 
-void VEdit::highlightTrailingSpace()
+void VEdit::invalidateTrailingSpace(int p_position, int p_charsRemoved, int p_charsAdded)
 {
-    if (!vconfig.getEnableTrailingSpaceHighlight()) {
-        QList<QTextEdit::ExtraSelection> &selects = m_extraSelections[(int)SelectionId::TrailingSapce];
-        if (!selects.isEmpty()) {
-            selects.clear();
-            highlightExtraSelections(true);
-        }
+    Q_UNUSED(p_charsRemoved);
+    updateBlockCache(m_trailingSpaceCache, c_trailingSpaceUnknown, p_position, p_charsAdded);
+}
+
+void VEdit::updateBlockCache(QVector<int> &p_cache, int p_unknown,
+                             int p_position, int p_charsAdded) const
+{
+    if (p_cache.isEmpty()) {
         return;
     }
 
-    QTextCharFormat format;
-    format.setBackground(m_trailingSpaceColor);
-    QString text("\\s+$");
-    highlightTextAll(text, FindOption::RegularExpression,
-                     SelectionId::TrailingSapce, format,
-                     trailingSpaceFilter);
+    QTextDocument *doc = document();
+    int nrBlocks = doc->blockCount();
+    int first = doc->findBlock(p_position).blockNumber();
+    if (first < 0) {
+        first = nrBlocks - 1;
+    }
+
+    int last = doc->findBlock(p_position + p_charsAdded).blockNumber();
+    if (last < 0) {
+        last = nrBlocks - 1;
+    }
+
+    // Blocks are added or removed right after the first changed block.
+    int delta = nrBlocks - p_cache.size();
+    if (delta > 0) {
+        p_cache.insert(qMin(first + 1, p_cache.size()), delta, p_unknown);
+    } else if (delta < 0) {
+        p_cache.remove(first + 1, -delta);
+    }
+
+    for (int i = first; i <= last && i < nrBlocks; ++i) {
+        p_cache[i] = p_unknown;
+    }
+}
+
+void VEdit::visibleBlockRange(int &p_first, int &p_last) const
+{
+    QTextDocument *doc = document();
+    QAbstractTextDocumentLayout *layout = doc->documentLayout();
+    int value = verticalScrollBar()->value();
+    int startPos = layout->hitTest(QPointF(0, value), Qt::FuzzyHit);
+    int endPos = layout->hitTest(QPointF(0, value + viewport()->height()), Qt::FuzzyHit);
+
+    QTextBlock startBlock = startPos < 0 ? doc->begin() : doc->findBlock(startPos);
+    QTextBlock endBlock = endPos < 0 ? doc->lastBlock() : doc->findBlock(endPos);
+
+    p_first = startBlock.blockNumber();
+    p_last = endBlock.blockNumber();
 }
 
 bool VEdit::wordInSearchedSelection(const QString &p_text)
 {
     QString text = p_text.trimmed();
-    QList<QTextEdit::ExtraSelection> &selects = m_extraSelections[(int)SelectionId::SearchedKeyword];
-    for (int i = 0; i < selects.size(); ++i) {
-        QString searchedWord = selects[i].cursor.selectedText();
-        if (text == searchedWord.trimmed()) {
-            return true;
-        }
+    const VTextMatches &matches = m_matches[(int)SelectionId::SearchedKeyword];
+    if (text.isEmpty() || matches.isEmpty()) {
+        return false;
     }
-    return false;
+
+    // Check the selection under cursor only.
+    QTextCursor cursor = textCursor();
+    int idx = matches.lowerBound(cursor.selectionStart());
+    return idx < matches.size()
+           && matches.position(idx) <= cursor.selectionStart()
+           && matches.position(idx) + matches.length(idx) >= cursor.selectionEnd();
 }
 
-void VEdit::highlightTextAll(const QString &p_text, uint p_options,
-                             SelectionId p_id, QTextCharFormat p_format,
-                             void (*p_filter)(VEdit *, QList<QTextEdit::ExtraSelection> &))
+void VEdit::highlightTextAll(const QString &p_text, uint p_options, SelectionId p_id)
 {
-    QList<QTextEdit::ExtraSelection> &selects = m_extraSelections[(int)p_id];
-    if (!p_text.isEmpty()) {
-        selects.clear();
-
-        QList<QTextCursor> occurs = findTextAll(p_text, p_options);
-        for (int i = 0; i < occurs.size(); ++i) {
-            QTextEdit::ExtraSelection select;
-            select.format = p_format;
-            select.cursor = occurs[i];
-            selects.append(select);
-        }
-    } else {
-        if (selects.isEmpty()) {
+    VTextMatcher &matcher = m_matchers[(int)p_id];
+    VTextMatches &matches = m_matches[(int)p_id];
+    if (p_text.isEmpty()) {
+        if (!matcher.isValid() && matches.isEmpty()) {
             return;
         }
-        selects.clear();
-    }
 
-    if (p_filter) {
-        p_filter(this, selects);
+        matcher = VTextMatcher();
+        matches.clear();
+    } else if (p_text != matcher.getText() || p_options != matcher.getOptions()) {
+        // Matches are kept up to date with the edits, so only new text
+        // needs to be searched.
+        matcher = VTextMatcher(p_text, p_options);
+        matches.clear();
+        m_matchesRevision = contentRevision();
+        matcher.findAll(toPlainText(), matches);
+    } else {
+        return;
     }
 
-    highlightExtraSelections();
+    viewport()->update();
 }
 
 void VEdit::highlightSearchedWord(const QString &p_text, uint p_options)
 {
-    QList<QTextEdit::ExtraSelection> &selects = m_extraSelections[(int)SelectionId::SearchedKeyword];
-    if (!vconfig.getHighlightSearchedWord() || p_text.isEmpty()) {
-        if (!selects.isEmpty()) {
-            selects.clear();
-            highlightExtraSelections(true);
-        }
-
-        return;
-    }
-
-    QTextCharFormat format;
-    format.setBackground(m_searchedWordColor);
-    highlightTextAll(p_text, p_options, SelectionId::SearchedKeyword, format);
+    // Matches are also used to count, so search even if highlight is disabled.
+    cancelSearch();
+    highlightTextAll(p_text, p_options, SelectionId::SearchedKeyword);
 }
 
 void VEdit::clearSearchedWordHighlight()
 {
-    QList<QTextEdit::ExtraSelection> &selects = m_extraSelections[(int)SelectionId::SearchedKeyword];
-    selects.clear();
-    highlightExtraSelections(true);
+    cancelSearch();
+    highlightTextAll("", 0, SelectionId::SearchedKeyword);
+    emit searchMatchesChanged();
 }
 
 void VEdit::contextMenuEvent(QContextMenuEvent *p_event)
@@ -621,6 +980,23 @@ void VEdit::contextMenuEvent(QContextMenuEvent *p_event)
 
     const QList<QAction *> actions = menu->actions();
 
+    if (m_undoHistory) {
+        // Redirect the standard actions to the bounded undo history.
+        for (auto act : actions) {
+            if (act->objectName() == "edit-undo") {
+                act->disconnect();
+                act->setEnabled(!isReadOnly() && isUndoAvailable());
+                connect(act, &QAction::triggered,
+                        this, &VEdit::undoChange);
+            } else if (act->objectName() == "edit-redo") {
+                act->disconnect();
+                act->setEnabled(!isReadOnly() && isRedoAvailable());
+                connect(act, &QAction::triggered,
+                        this, &VEdit::redoChange);
+            }
+        }
+    }
+
     if (!textCursor().hasSelection()) {
         VEditTab *editTab = dynamic_cast<VEditTab *>(parent());
         V_ASSERT(editTab);
@@ -661,6 +1037,23 @@ void VEdit::contextMenuEvent(QContextMenuEvent *p_event)
     delete menu;
 }
 
+void VEdit::keyPressEvent(QKeyEvent *p_event)
+{
+    if (m_undoHistory && !isReadOnly()) {
+        if (p_event == QKeySequence::Undo) {
+            undoChange();
+            p_event->accept();
+            return;
+        } else if (p_event == QKeySequence::Redo) {
+            redoChange();
+            p_event->accept();
+            return;
+        }
+    }
+
+    QTextEdit::keyPressEvent(p_event);
+}
+
 void VEdit::handleSaveExitAct()
 {
     emit saveAndRead();
@@ -686,14 +1079,25 @@ void VEdit::handleCursorPositionChanged()
     static QTextCursor lastCursor;
 
     QTextCursor cursor = textCursor();
+    QAbstractTextDocumentLayout *layout = document()->documentLayout();
     if (lastCursor.isNull() || cursor.blockNumber() != lastCursor.blockNumber()) {
         highlightCurrentLine();
-        highlightTrailingSpace();
+
+        // Trailing spaces are hidden with cursor right behind.
+        if (vconfig.getEnableTrailingSpaceHighlight()) {
+            if (!lastCursor.isNull() && lastCursor.document() == document()) {
+                updateDocumentRect(layout->blockBoundingRect(lastCursor.block()));
+            }
+
+            updateDocumentRect(layout->blockBoundingRect(cursor.block()));
+        }
     } else {
         // Judge whether we have trailing space at current line.
         QString text = cursor.block().text();
-        if (text.rbegin()->isSpace()) {
-            highlightTrailingSpace();
+        if (vconfig.getEnableTrailingSpaceHighlight()
+            && !text.isEmpty()
+            && text.rbegin()->isSpace()) {
+            updateDocumentRect(layout->blockBoundingRect(cursor.block()));
         }
 
         // Handle word-wrap in one block.
@@ -791,6 +1195,23 @@ void VEdit::requestUpdateVimStatus()
     }
 }
 
+void VEdit::setLargeFileMode(bool p_enabled)
+{
+    if (m_largeFileMode == p_enabled) {
+        return;
+    }
+
+    m_largeFileMode = p_enabled;
+
+    // Clear or restore the highlights.
+    highlightSelectedWord();
+}
+
+bool VEdit::isLargeFileMode() const
+{
+    return m_largeFileMode;
+}
+
 bool VEdit::jumpTitle(bool p_forward, int p_relativeLevel, int p_repeat)
 {
     Q_UNUSED(p_forward);
@@ -7,15 +7,22 @@
 #include <QVector>
 #include <QList>
 #include <QColor>
+#include <QRectF>
 #include <QFontMetrics>
+#include <QFutureWatcher>
+#include <QAtomicInt>
 #include "vconstants.h"
 #include "vtoc.h"
 #include "vfile.h"
+#include "utils/vtextmatcher.h"
 
 class VEditOperations;
 class QLabel;
 class QTimer;
+class QPainter;
+class QTextBlock;
 class VVim;
+class VUndoHistory;
 
 enum class SelectionId {
     CurrentLine = 0,
@@ -85,6 +92,27 @@ public:
     // Request to update Vim status.
     void requestUpdateVimStatus();
 
+    // In large file mode, selected word is not highlighted over the whole
+    // document.
+    virtual void setLargeFileMode(bool p_enabled);
+
+    bool isLargeFileMode() const;
+
+    // Get the 1-based index of the searched match under cursor (0 if none)
+    // and the count of the searched matches (-1 if not searched yet).
+    void getSearchMatchInfo(int &p_index, int &p_count) const;
+
+    // Undo and redo via the bounded history if there is one, otherwise via
+    // QTextDocument.
+    bool isUndoAvailable() const;
+    bool isRedoAvailable() const;
+    void undoChange();
+    void redoChange();
+
+    // Get the number of undo steps (-1 if not bounded) and the memory used by
+    // the bounded undo history.
+    void getUndoInfo(int &p_steps, qint64 &p_bytes) const;
+
 signals:
     // Request VEditTab to save and exit edit mode.
     void saveAndRead();
@@ -107,6 +135,9 @@ signals:
     // Emit when Vim status updated.
     void vimStatusUpdated(const VVim *p_vim);
 
+    // Emit when the searched matches have been updated.
+    void searchMatchesChanged();
+
 public slots:
     virtual void highlightCurrentLine();
 
@@ -124,40 +155,93 @@ private slots:
     void handleSaveExitAct();
     void handleDiscardExitAct();
     void handleEditAct();
-    void highlightTrailingSpace();
     void handleCursorPositionChanged();
 
+    void handleContentsChange(int p_position, int p_charsRemoved, int p_charsAdded);
+
+    void handleSearchFinished();
+
 protected:
     QPointer<VFile> m_file;
     VEditOperations *m_editOps;
 
     VEditConfig m_config;
 
+    // Whether it is editing a large file with some features degraded.
+    bool m_largeFileMode;
+
+    // Bounded undo history replacing the one of QTextDocument if not NULL.
+    VUndoHistory *m_undoHistory;
+
     virtual void updateFontAndPalette();
     virtual void contextMenuEvent(QContextMenuEvent *p_event) Q_DECL_OVERRIDE;
 
+    // Handle undo and redo shortcuts when using the bounded undo history.
+    virtual void keyPressEvent(QKeyEvent *p_event) Q_DECL_OVERRIDE;
+
     // Used to implement dragging mouse with Ctrl and left button pressed to scroll.
     virtual void mousePressEvent(QMouseEvent *p_event) Q_DECL_OVERRIDE;
     virtual void mouseReleaseEvent(QMouseEvent *p_event) Q_DECL_OVERRIDE;
     virtual void mouseMoveEvent(QMouseEvent *p_event) Q_DECL_OVERRIDE;
 
+    // Paint the cursor line, matches and trailing spaces under the text.
+    virtual void paintEvent(QPaintEvent *p_event) Q_DECL_OVERRIDE;
+
     // Update m_config according to VConfigManager.
     void updateConfig();
 
+    // Get the block numbers of the first and last visible blocks.
+    void visibleBlockRange(int &p_first, int &p_last) const;
+
+    // Update @p_cache indexed by block number after contents change at
+    // @p_position. Changed and new blocks are reset to @p_unknown.
+    void updateBlockCache(QVector<int> &p_cache, int p_unknown,
+                          int p_position, int p_charsAdded) const;
+
 private:
     QLabel *m_wrapLabel;
     QTimer *m_labelTimer;
 
-    // doHighlightExtraSelections() will highlight these selections.
-    // Selections are indexed by SelectionId.
-    QVector<QList<QTextEdit::ExtraSelection> > m_extraSelections;
-
     QColor m_selectedWordColor;
     QColor m_searchedWordColor;
     QColor m_trailingSpaceColor;
 
-    // Timer for extra selections highlight.
-    QTimer *m_highlightTimer;
+    // Block number -> position in block where trailing spaces start.
+    QVector<int> m_trailingSpaceCache;
+
+    // Matchers and matches of the whole document indexed by SelectionId.
+    // Only the matches within the dirty region are painted.
+    QVector<VTextMatcher> m_matchers;
+    QVector<VTextMatches> m_matches;
+
+    // Revision of the document when matches were last updated.
+    int m_matchesRevision;
+
+    // Search of the whole document in background for incremental search.
+    QFutureWatcher<VTextMatches> *m_searchWatcher;
+    QAtomicInt m_searchCancel;
+
+    // Matcher of the running search. Invalid if it is cancelled.
+    VTextMatcher m_searchMatcher;
+
+    // Revision of the document when the running search started.
+    int m_searchRevision;
+
+    // Search to start after the running one is cancelled.
+    VTextMatcher m_pendingSearch;
+    bool m_hasPendingSearch;
+
+    // Position to start incremental search from.
+    int m_peekPos;
+
+    // Position of last peeked match, used to detect cursor moves.
+    int m_peekLastPos;
+
+    // Whether the peeked match will be selected when the search finishes.
+    bool m_peekPending;
+
+    // Rect of the cursor line in document coordinates. Empty if not highlighted.
+    QRectF m_cursorLineRect;
 
     bool m_readyToScroll;
     bool m_mouseMoveScrolled;
@@ -166,20 +250,50 @@ private:
 
     void showWrapLabel();
 
-    // Trigger the timer to request highlight.
-    // If @p_now is true, stop the timer and highlight immediately.
-    void highlightExtraSelections(bool p_now = false);
+    // Invalidate the cached trailing spaces of the changed blocks.
+    void invalidateTrailingSpace(int p_position, int p_charsRemoved, int p_charsAdded);
+
+    // Update the matches of the changed blocks.
+    void updateMatches(int p_position, int p_charsRemoved, int p_charsAdded);
+
+    // Revision of the text which does not change with format changes.
+    int contentRevision() const;
+
+    // Move cursor to @p_pos after undo or redo via m_undoHistory.
+    void afterUndoRedo(int p_pos);
+
+    // Get the position in block where trailing spaces start, or -1 if none.
+    int trailingSpaceOfBlock(const QTextBlock &p_block);
+
+    // Find all the occurences of @p_text and highlight them.
+    // Clear the highlight if @p_text is empty.
+    void highlightTextAll(const QString &p_text, uint p_options, SelectionId p_id);
+
+    // Get the rect of the cursor line in document coordinates.
+    QRectF cursorLineRect() const;
+
+    // Repaint the viewport area of @p_rect in document coordinates.
+    void updateDocumentRect(const QRectF &p_rect);
+
+    // Fill the rects of [@p_start, @p_end) in @p_block.
+    // @p_offset: offset from document coordinates to viewport coordinates.
+    void fillBlockRange(QPainter &p_painter, const QTextBlock &p_block,
+                        int p_start, int p_end, const QColor &p_color,
+                        const QPointF &p_offset) const;
+
+    // Fill the matches of @p_id within [@p_startPos, @p_endPos).
+    void fillMatches(QPainter &p_painter, SelectionId p_id, const QColor &p_color,
+                     int p_startPos, int p_endPos, const QPointF &p_offset) const;
+
+    // Search @p_matcher in background. The running search is cancelled.
+    void searchAsync(const VTextMatcher &p_matcher);
 
-    // Do the real work to highlight extra selections.
-    void doHighlightExtraSelections();
+    void startSearch(const VTextMatcher &p_matcher);
 
-    // Find all the occurences of @p_text.
-    QList<QTextCursor> findTextAll(const QString &p_text, uint p_options);
+    void cancelSearch();
 
-    // @p_fileter: a function to filter out highlight results.
-    void highlightTextAll(const QString &p_text, uint p_options,
-                          SelectionId p_id, QTextCharFormat p_format,
-                          void (*p_filter)(VEdit *, QList<QTextEdit::ExtraSelection> &) = NULL);
+    // Select the peeked match @p_idx of the searched matches.
+    void selectPeekedMatch(int p_idx);
 
     void highlightSearchedWord(const QString &p_text, uint p_options);
     bool wordInSearchedSelection(const QString &p_text);
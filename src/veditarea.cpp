@@ -7,13 +7,14 @@
 #include "vfile.h"
 #include "dialog/vfindreplacedialog.h"
 #include "utils/vutils.h"
+#include "vtransferengine.h"
 
 extern VConfigManager vconfig;
 extern VNote *g_vnote;
 
 VEditArea::VEditArea(VNote *vnote, QWidget *parent)
     : QWidget(parent), VNavigationMode(),
-      vnote(vnote), curWindowIndex(-1)
+      vnote(vnote), curWindowIndex(-1), m_checkingChanges(false)
 {
     setupUI();
 
@@ -128,6 +129,12 @@ void VEditArea::openFile(VFile *p_file, OpenFileMode p_mode)
     }
     qDebug() << "VEditArea open" << p_file->getName() << (int)p_mode;
 
+    if (g_vnote->getTransferEngine()->isMoving(p_file->retrivePath())) {
+        emit statusMessage(tr("Note %1 could not be opened until it is moved")
+                             .arg(p_file->getName()));
+        return;
+    }
+
     // Find if it has been opened already
     int winIdx, tabIdx;
     bool setFocus = false;
@@ -450,6 +457,182 @@ void VEditArea::handleFileUpdated(const VFile *p_file)
     }
 }
 
+void VEditArea::checkFilesChangedOutside(const QStringList &p_files)
+{
+    if (m_checkingChanges) {
+        m_pendingChangedFiles.append(p_files);
+        return;
+    }
+
+    m_checkingChanges = true;
+
+    QStringList changedFiles = p_files;
+    while (!changedFiles.isEmpty()) {
+        QSet<QString> paths;
+        for (auto const &path : changedFiles) {
+            paths.insert(QDir::cleanPath(path));
+        }
+
+        // Tabs may be closed while prompting.
+        QVector<QPointer<VFile> > files;
+        int nrWin = splitter->count();
+        for (int i = 0; i < nrWin; ++i) {
+            VEditWindow *win = getWindow(i);
+            for (int j = 0; j < win->count(); ++j) {
+                VFile *file = win->getTab(j)->getFile();
+                if (file
+                    && !files.contains(file)
+                    && paths.contains(QDir::cleanPath(file->retrivePath()))) {
+                    files.append(file);
+                }
+            }
+        }
+
+        for (auto const &file : files) {
+            if (file && file->isOpened()) {
+                checkFileChangedOutside(file);
+            }
+        }
+
+        changedFiles = m_pendingChangedFiles;
+        m_pendingChangedFiles.clear();
+    }
+
+    m_checkingChanges = false;
+}
+
+void VEditArea::checkFileChangedOutside(VFile *p_file)
+{
+    QString path = p_file->retrivePath();
+    if (!QFileInfo::exists(path)) {
+        // Removed notes are handled by the reloading of their folders.
+        return;
+    }
+
+    if (p_file->isWrittenByLastSave()) {
+        // Saved by VNote itself. No need to read it.
+        return;
+    }
+
+    QString content = VUtils::readFileFromDisk(path);
+    if (content == p_file->getContent()) {
+        // Saved by VNote itself.
+        return;
+    }
+
+    auto tabs = findTabsByFile(p_file);
+    if (tabs.isEmpty()) {
+        return;
+    }
+
+    bool modified = false;
+    for (auto const &tab : tabs) {
+        if (getWindow(tab.first)->getTab(tab.second)->isModified()) {
+            modified = true;
+            break;
+        }
+    }
+
+    QPointer<VFile> file(p_file);
+    int ret = VUtils::showMessage(QMessageBox::Information, tr("Information"),
+                                  tr("Note <span style=\"%1\">%2</span> has been modified "
+                                     "outside VNote.")
+                                    .arg(vconfig.c_dataTextStyle).arg(path),
+                                  modified ? tr("Reload it and discard the unsaved changes? "
+                                                "Otherwise, current content will be kept.")
+                                           : tr("Reload it? Otherwise, current content will be kept."),
+                                  QMessageBox::Yes | QMessageBox::No,
+                                  modified ? QMessageBox::No : QMessageBox::Yes,
+                                  this);
+    if (ret != QMessageBox::Yes || !file || !file->isOpened()) {
+        return;
+    }
+
+    // The file may be changed again while prompting.
+    file->setContent(VUtils::readFileFromDisk(path));
+    file->setModified(false);
+
+    tabs = findTabsByFile(file);
+    for (auto const &tab : tabs) {
+        getWindow(tab.first)->getTab(tab.second)->reloadContent();
+    }
+
+    emit statusMessage(tr("Note %1 reloaded").arg(file->getName()));
+}
+
+void VEditArea::closeFileRemovedOutside(VFile *p_file)
+{
+    VEditTab *modifiedTab = NULL;
+    auto tabs = findTabsByFile(p_file);
+    for (auto const &tab : tabs) {
+        VEditTab *editTab = getWindow(tab.first)->getTab(tab.second);
+        if (editTab->isModified()) {
+            modifiedTab = editTab;
+            break;
+        }
+    }
+
+    if (!modifiedTab) {
+        closeFile(p_file, true);
+        return;
+    }
+
+    QString path = p_file->retrivePath();
+    QString content = modifiedTab->getContent();
+    int ret = VUtils::showMessage(QMessageBox::Warning, tr("Warning"),
+                                  tr("Note <span style=\"%1\">%2</span> has been removed "
+                                     "outside VNote.")
+                                    .arg(vconfig.c_dataTextStyle).arg(path),
+                                  tr("Save the unsaved changes as another file? Otherwise, "
+                                     "they will be discarded."),
+                                  QMessageBox::Save | QMessageBox::Discard,
+                                  QMessageBox::Save, this);
+    QString newPath;
+    while (ret == QMessageBox::Save) {
+        newPath = QFileDialog::getSaveFileName(this, tr("Save Note As"), path);
+        if (newPath.isEmpty() || VUtils::writeFileToDisk(newPath, content)) {
+            break;
+        }
+
+        ret = VUtils::showMessage(QMessageBox::Warning, tr("Warning"),
+                                  tr("Fail to save note to <span style=\"%1\">%2</span>.")
+                                    .arg(vconfig.c_dataTextStyle).arg(newPath),
+                                  tr("Please choose another file, or the unsaved changes "
+                                     "will be discarded."),
+                                  QMessageBox::Save | QMessageBox::Discard,
+                                  QMessageBox::Save, this);
+        newPath.clear();
+    }
+
+    closeFile(p_file, true);
+
+    // Continue editing the saved content as an external file.
+    if (!newPath.isEmpty()) {
+        openFile(vnote->getOrphanFile(QDir::cleanPath(newPath)), OpenFileMode::Edit);
+    }
+}
+
+void VEditArea::closeFileRemovedOutside(const VDirectory *p_dir)
+{
+    QVector<QPointer<VFile> > files;
+    int nrWin = splitter->count();
+    for (int i = 0; i < nrWin; ++i) {
+        VEditWindow *win = getWindow(i);
+        for (int j = 0; j < win->count(); ++j) {
+            VFile *file = win->getTab(j)->getFile();
+            if (p_dir->containsFile(file) && !files.contains(file)) {
+                files.append(file);
+            }
+        }
+    }
+
+    for (auto const &file : files) {
+        if (file) {
+            closeFileRemovedOutside(file);
+        }
+    }
+}
+
 void VEditArea::handleDirectoryUpdated(const VDirectory *p_dir)
 {
     int nrWin = splitter->count();
@@ -576,6 +759,38 @@ QString VEditArea::getSelectedText()
     }
 }
 
+QVector<VEditTab *> VEditArea::getAllTabs() const
+{
+    QVector<VEditTab *> tabs;
+    int nrWin = splitter->count();
+    for (int winIdx = 0; winIdx < nrWin; ++winIdx) {
+        VEditWindow *win = getWindow(winIdx);
+        int nrTab = win->count();
+        for (int tabIdx = 0; tabIdx < nrTab; ++tabIdx) {
+            tabs.append(win->getTab(tabIdx));
+        }
+    }
+
+    return tabs;
+}
+
+bool VEditArea::locateTab(const VEditTab *p_tab)
+{
+    int nrWin = splitter->count();
+    for (int winIdx = 0; winIdx < nrWin; ++winIdx) {
+        VEditWindow *win = getWindow(winIdx);
+        int nrTab = win->count();
+        for (int tabIdx = 0; tabIdx < nrTab; ++tabIdx) {
+            if (win->getTab(tabIdx) == p_tab) {
+                setCurrentTab(winIdx, tabIdx, true);
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
 int VEditArea::focusNextWindow(int p_biaIdx)
 {
     if (p_biaIdx == 0) {
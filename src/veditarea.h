@@ -45,6 +45,12 @@ public:
     inline VFindReplaceDialog *getFindReplaceDialog() const;
     // Return selected text of current edit tab.
     QString getSelectedText();
+
+    // Return all the tabs in all the windows.
+    QVector<VEditTab *> getAllTabs() const;
+
+    // Make @p_tab current and focus it. Returns false if it is not found.
+    bool locateTab(const VEditTab *p_tab);
     void splitCurrentWindow();
     void removeCurrentWindow();
     // Focus next window (curWindowIndex + p_biaIdx).
@@ -86,6 +92,18 @@ public slots:
     void handleDirectoryUpdated(const VDirectory *p_dir);
     void handleNotebookUpdated(const VNotebook *p_notebook);
 
+    // Files @p_files may be modified outside VNote. Prompt to reload the
+    // opened ones whose content differs from the disk.
+    void checkFilesChangedOutside(const QStringList &p_files);
+
+    // Close the tabs of @p_file, which has been removed outside VNote.
+    // Prompt to save the unsaved changes as another file.
+    void closeFileRemovedOutside(VFile *p_file);
+
+    // Close the tabs of the notes within @p_dir, which has been removed
+    // outside VNote.
+    void closeFileRemovedOutside(const VDirectory *p_dir);
+
 private slots:
     // Split @curWindow via inserting a new window around it.
     // @p_right: insert the new window on the right side.
@@ -126,6 +144,9 @@ private:
     // Update status of current window.
     void updateWindowStatus();
 
+    // Prompt to reload @p_file if it differs from the disk.
+    void checkFileChangedOutside(VFile *p_file);
+
     VNote *vnote;
     int curWindowIndex;
 
@@ -137,6 +158,12 @@ private:
     // Map second key to VEditWindow.
     QMap<QChar, VEditWindow *> m_keyMap;
     QVector<QLabel *> m_naviLabels;
+
+    // Whether it is prompting to reload files changed outside.
+    bool m_checkingChanges;
+
+    // Files changed outside while prompting.
+    QStringList m_pendingChangedFiles;
 };
 
 inline VEditWindow* VEditArea::getWindow(int windowIndex) const
@@ -44,6 +44,9 @@ public:
     // Scroll to anchor @p_anchor.
     virtual void scrollToAnchor(const VAnchor& p_anchor) = 0;
 
+    // Scroll to line @p_lineNumber (based on 0) of the file.
+    virtual void scrollToLine(int p_lineNumber) = 0;
+
     VFile *getFile() const;
 
     // User requests to insert image.
@@ -63,11 +66,18 @@ public:
     // Return selected text.
     virtual QString getSelectedText() const = 0;
 
+    // Return current content of the note, including the unsaved changes.
+    virtual QString getContent() const = 0;
+
     virtual void clearSearchedWordHighlight() = 0;
 
     // Request current tab to propogate its status about Vim.
     virtual void requestUpdateVimStatus() = 0;
 
+    // Reload the content of the file, which has been changed outside.
+    // The unsaved changes will be discarded.
+    virtual void reloadContent() = 0;
+
 public slots:
     // Enter edit mode
     virtual void editFile() = 0;
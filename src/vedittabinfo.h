@@ -1,13 +1,16 @@
 #ifndef VEDITTABINFO_H
 #define VEDITTABINFO_H
 
+#include <QtGlobal>
+
 class VEditTab;
 
 struct VEditTabInfo
 {
     VEditTabInfo()
         : m_editTab(NULL), m_cursorBlockNumber(-1), m_cursorPositionInBlock(-1),
-          m_blockCount(-1) {}
+          m_blockCount(-1), m_largeFile(false), m_searchMatchIndex(0),
+          m_searchMatchCount(-1), m_undoSteps(-1), m_undoBytes(0) {}
 
     VEditTab *m_editTab;
 
@@ -15,6 +18,21 @@ struct VEditTabInfo
     int m_cursorBlockNumber;
     int m_cursorPositionInBlock;
     int m_blockCount;
+
+    // Whether it is editing in large file mode.
+    bool m_largeFile;
+
+    // 1-based index of the searched match under cursor, 0 for none.
+    int m_searchMatchIndex;
+
+    // Count of the searched matches. -1 for not searched.
+    int m_searchMatchCount;
+
+    // Number of undo steps. -1 if the undo history is not bounded.
+    int m_undoSteps;
+
+    // Memory used by the undo history in bytes.
+    qint64 m_undoBytes;
 };
 
 #endif // VEDITTABINFO_H
@@ -4,13 +4,20 @@
 #include <QDebug>
 #include <QTextEdit>
 #include <QFileInfo>
+#include <QSet>
 #include "utils/vutils.h"
+#include "vdirectory.h"
+#include "vchangebus.h"
+#include "vfilewatcher.h"
+#include "vconfigmanager.h"
+
+extern VConfigManager vconfig;
 
 VFile::VFile(const QString &p_name, QObject *p_parent,
              FileType p_type, bool p_modifiable)
     : QObject(p_parent), m_name(p_name), m_opened(false), m_modified(false),
       m_docType(VUtils::docTypeFromName(p_name)),
-      m_type(p_type), m_modifiable(p_modifiable)
+      m_type(p_type), m_modifiable(p_modifiable), m_savedModified(0), m_savedSize(-1)
 {
 }
 
@@ -30,6 +37,7 @@ bool VFile::open()
     m_content = VUtils::readFileFromDisk(path);
     m_modified = false;
     m_opened = true;
+    VFileWatcher::watch(path);
     qDebug() << "file" << m_name << "opened";
     return true;
 }
@@ -39,7 +47,9 @@ void VFile::close()
     if (!m_opened) {
         return;
     }
+    VFileWatcher::unwatch(retrivePath());
     m_content.clear();
+    m_savedSize = -1;
     m_opened = false;
 }
 
@@ -65,10 +75,34 @@ void VFile::deleteDiskFile()
 bool VFile::save()
 {
     Q_ASSERT(m_opened);
-    bool ret = VUtils::writeFileToDisk(retrivePath(), m_content);
+    QString path = retrivePath();
+    bool ret = VUtils::writeFileToDisk(path, m_content);
+    if (ret) {
+        // To tell our own writes from the changes outside.
+        QFileInfo info(path);
+        m_savedModified = info.lastModified().toMSecsSinceEpoch();
+        m_savedSize = info.size();
+
+        if (m_type == FileType::Normal) {
+            VChangeBus::post(VChange::Updated, getNotebook()->getPath(), path);
+        }
+    }
+
     return ret;
 }
 
+bool VFile::isWrittenByLastSave() const
+{
+    if (m_savedSize < 0) {
+        return false;
+    }
+
+    QFileInfo info(retrivePath());
+    return info.exists()
+           && info.size() == m_savedSize
+           && info.lastModified().toMSecsSinceEpoch() == m_savedModified;
+}
+
 void VFile::convert(DocType p_curType, DocType p_targetType)
 {
     Q_ASSERT(!m_opened);
@@ -101,9 +135,21 @@ void VFile::deleteLocalImages()
 
     QVector<ImageLink> images = VUtils::fetchImagesFromMarkdownFile(this,
                                                                     ImageLink::LocalRelativeInternal);
+    // The same image may be linked several times.
+    QSet<QString> imagePaths;
+    for (auto const &link : images) {
+        imagePaths.insert(link.m_path);
+    }
+
+    // Content-addressed images may be shared with other notes.
+    VDirectory *dir = getDirectory();
+    if (vconfig.getEnableContentAddressedImages() && !imagePaths.isEmpty() && dir) {
+        imagePaths.subtract(dir->fetchImagesOfNotes(this));
+    }
+
     int deleted = 0;
-    for (int i = 0; i < images.size(); ++i) {
-        QFile file(images[i].m_path);
+    for (auto const &path : imagePaths) {
+        QFile file(path);
         if (file.remove()) {
             ++deleted;
         }
@@ -263,6 +309,11 @@ bool VFile::rename(const QString &p_name)
         return false;
     }
 
+    if (m_opened) {
+        VFileWatcher::unwatch(diskDir.filePath(oldName));
+        VFileWatcher::watch(retrivePath());
+    }
+
     // Handle DocType change.
     DocType newType = VUtils::docTypeFromName(m_name);
     if (m_docType != newType) {
@@ -270,6 +321,10 @@ bool VFile::rename(const QString &p_name)
         m_docType = newType;
     }
 
+    QString notebookPath = getNotebook()->getPath();
+    VChangeBus::post(VChange::Removed, notebookPath, diskDir.filePath(oldName));
+    VChangeBus::post(VChange::Updated, notebookPath, retrivePath());
+
     qDebug() << "note renamed from" << oldName << "to" << m_name;
 
     return true;
@@ -52,6 +52,9 @@ public:
     // Rename the file.
     virtual bool rename(const QString &p_name);
 
+    // Whether the file on disk is still the one written by last save().
+    bool isWrittenByLastSave() const;
+
 public slots:
     void setModified(bool p_modified);
 
@@ -71,6 +74,11 @@ protected:
     FileType m_type;
     bool m_modifiable;
 
+    // Modified time in msecs and size of the file written by last save().
+    // Size is -1 if not saved since opened.
+    qint64 m_savedModified;
+    qint64 m_savedSize;
+
     friend class VDirectory;
 };
 
@@ -10,6 +10,7 @@
 #include "utils/vutils.h"
 #include "vfile.h"
 #include "vconfigmanager.h"
+#include "vtransferengine.h"
 
 extern VConfigManager vconfig;
 extern VNote *g_vnote;
@@ -115,6 +116,26 @@ void VFileList::updateFileList()
     }
 }
 
+void VFileList::updateDirectory(const VDirectory *p_dir)
+{
+    if (!m_directory || m_directory != p_dir) {
+        return;
+    }
+
+    QListWidgetItem *curItem = fileList->currentItem();
+    QPointer<VFile> curFile;
+    if (curItem) {
+        curFile = getVFile(curItem);
+    }
+
+    updateFileList();
+
+    QListWidgetItem *item = findItem(curFile);
+    if (item) {
+        fileList->setCurrentItem(item, QItemSelectionModel::ClearAndSelect);
+    }
+}
+
 void VFileList::fileInfo()
 {
     QListWidgetItem *curItem = fileList->currentItem();
@@ -278,9 +299,12 @@ void VFileList::deleteFile()
 {
     QList<QListWidgetItem *> items = fileList->selectedItems();
     Q_ASSERT(!items.isEmpty());
+    VConfigManager::beginDirectoryConfigBatch();
     for (int i = 0; i < items.size(); ++i) {
         deleteFile(getVFile(items.at(i)));
     }
+
+    VConfigManager::endDirectoryConfigBatch();
 }
 
 // @p_file may or may not be listed in VFileList
@@ -291,6 +315,15 @@ void VFileList::deleteFile(VFile *p_file)
     }
     VDirectory *dir = p_file->getDirectory();
     QString fileName = p_file->getName();
+    if (g_vnote->getTransferEngine()->isInvolved(p_file->retrivePath())) {
+        VUtils::showMessage(QMessageBox::Information, tr("Information"),
+                            tr("Note <span style=\"%1\">%2</span> is being copied or moved.")
+                              .arg(vconfig.c_dataTextStyle).arg(fileName),
+                            tr("Please try again after it finishes."),
+                            QMessageBox::Ok, QMessageBox::Ok, this);
+        return;
+    }
+
     int ret = VUtils::showMessage(QMessageBox::Warning, tr("Warning"),
                                   tr("Are you sure to delete note <span style=\"%1\">%2</span>?")
                                     .arg(vconfig.c_dataTextStyle).arg(fileName),
@@ -452,7 +485,7 @@ void VFileList::pasteFiles(VDirectory *p_destDir)
     Q_ASSERT(!clip.isEmpty() && clip["operation"] == (int)ClipboardOpType::CopyFile);
     bool isCut = clip["is_cut"].toBool();
 
-    int nrPasted = 0;
+    int nrQueued = 0;
     for (int i = 0; i < m_copiedFiles.size(); ++i) {
         QPointer<VFile> srcFile = m_copiedFiles[i];
         if (!srcFile) {
@@ -462,21 +495,17 @@ void VFileList::pasteFiles(VDirectory *p_destDir)
         VDirectory *srcDir = srcFile->getDirectory();
         if (srcDir == p_destDir && !isCut) {
             // Copy and paste in the same directory.
-            // Rename it to xx_copy.md
-            fileName = VUtils::generateCopiedFileName(srcDir->retrivePath(), fileName);
+            // Rename it to xx_copy.md, skipping the names of queued copies.
+            QString dirPath = srcDir->retrivePath();
+            fileName = VUtils::generateCopiedFileName(dirPath, fileName,
+                                                      g_vnote->getTransferEngine()->reservedNames(dirPath));
         }
         if (copyFile(p_destDir, fileName, srcFile, isCut)) {
-            nrPasted++;
-        } else {
-            VUtils::showMessage(QMessageBox::Warning, tr("Warning"),
-                                tr("Fail to copy note <span style=\"%1\">%2</span>.")
-                                  .arg(vconfig.c_dataTextStyle).arg(srcFile->getName()),
-                                tr("Please check if there already exists a file with the same name in the target folder."),
-                                QMessageBox::Ok, QMessageBox::Ok, this);
+            nrQueued++;
         }
     }
 
-    qDebug() << "pasted" << nrPasted << "files sucessfully";
+    qDebug() << "queued" << nrQueued << "files to paste";
     clipboard->clear();
     m_copiedFiles.clear();
 }
@@ -494,12 +523,94 @@ bool VFileList::copyFile(VDirectory *p_destDir, const QString &p_destName, VFile
         return false;
     }
 
-    VFile *destFile = VDirectory::copyFile(p_destDir, p_destName, p_file, p_cut);
+    // The note could not be opened until it is moved.
+    if (p_cut && editArea->isFileOpened(p_file) && !editArea->closeFile(p_file, false)) {
+        return false;
+    }
+
+    QStringList skippedImages, obsoleteImages;
+    QVector<VTransferItem> items = VDirectory::transferItemsOfFile(p_destDir, p_destName,
+                                                                  p_file, p_cut, skippedImages,
+                                                                  obsoleteImages);
+    VTransferJob *job = g_vnote->getTransferEngine()->addJob(
+        (p_cut ? tr("Moving note %1") : tr("Copying note %1")).arg(p_file->getName()),
+        items);
+
+    // The data is moved before the configs are updated.
+    QPointer<VDirectory> destDir(p_destDir);
+    QPointer<VFile> file(p_file);
+    connect(job, &VTransferJob::finished,
+            this, [=](bool p_succeed) {
+                handleFileCopied(job, p_succeed, destDir, p_destName, file, p_cut,
+                                 skippedImages, obsoleteImages);
+            });
+    return true;
+}
+
+void VFileList::handleFileCopied(const VTransferJob *p_job, bool p_succeed,
+                                 VDirectory *p_destDir, const QString &p_destName,
+                                 VFile *p_file, bool p_cut, const QStringList &p_skippedImages,
+                                 const QStringList &p_obsoleteImages)
+{
+    // A job cancelled too late still succeeds. The cancellation is shown in
+    // the status bar by VMainWindow.
+    if (!p_succeed && p_job->isCancelled()) {
+        return;
+    }
+
+    VFile *destFile = NULL;
+    bool configsUpdated = false;
+    if (p_succeed && p_destDir && p_file) {
+        destFile = VDirectory::copyFile(p_destDir, p_destName, p_file, p_cut);
+        configsUpdated = destFile != NULL;
+    } else if (p_succeed) {
+        // The folder or the note is gone during the transfer while the data
+        // has been transferred. Update the configs by the recorded paths or
+        // move the data back.
+        const VTransferItem &item = p_job->getItems().first();
+        configsUpdated = VDirectory::updateConfigsOfTransfer(item.m_srcPath, item.m_destPath,
+                                                             false, p_cut);
+        if (!configsUpdated && !VTransferEngine::revert(p_job)) {
+            qWarning() << "fail to revert the transfer of note" << item.m_srcPath;
+        }
+    }
+
+    if (configsUpdated) {
+        int nrRemoved = 0;
+        for (auto const &image : p_obsoleteImages) {
+            if (QFile::remove(image)) {
+                ++nrRemoved;
+            }
+        }
+
+        qDebug() << "removed" << nrRemoved << "images of the moved note" << p_destName;
+    }
+
     updateFileList();
     if (destFile) {
         emit fileUpdated(destFile);
     }
-    return destFile != NULL;
+
+    QString srcName = VUtils::fileNameFromPath(p_job->getItems().first().m_srcPath);
+    if (!configsUpdated) {
+        QString info = p_job->getErrorString();
+        if (info.isEmpty()) {
+            info = tr("Please check if there already exists a file with the same name in the target folder.");
+        }
+
+        VUtils::showMessage(QMessageBox::Warning, tr("Warning"),
+                            tr("Fail to copy note <span style=\"%1\">%2</span>.")
+                              .arg(vconfig.c_dataTextStyle).arg(srcName),
+                            info, QMessageBox::Ok, QMessageBox::Ok, this);
+    } else if (!p_skippedImages.isEmpty()) {
+        VUtils::showMessage(QMessageBox::Warning, tr("Warning"),
+                            tr("Fail to copy images of note <span style=\"%1\">%2</span>.")
+                              .arg(vconfig.c_dataTextStyle).arg(srcName),
+                            tr("Please check if there already exists a file with the same name "
+                               "and then manually copy them and modify the note accordingly:\n%1")
+                              .arg(p_skippedImages.join("\n")),
+                            QMessageBox::Ok, QMessageBox::Ok, this);
+    }
 }
 
 bool VFileList::promptForDocTypeChange(const VFile *p_file, const QString &p_newFilePath)
@@ -32,6 +32,9 @@ public:
     void fileInfo(VFile *p_file);
     void deleteFile(VFile *p_file);
     bool locateFile(const VFile *p_file);
+
+    // Files of @p_dir have been reloaded. Update the list if it is showing it.
+    void updateDirectory(const VDirectory *p_dir);
     inline const VDirectory *currentDirectory() const;
 
     // Implementations for VNavigationMode.
@@ -77,7 +80,16 @@ private:
 
     void copyFileInfoToClipboard(const QJsonArray &p_files, bool p_isCut);
     void pasteFiles(VDirectory *p_destDir);
+    // Copy @p_file to @p_destDir with name @p_destName in background.
+    // Returns false if it is not started.
     bool copyFile(VDirectory *p_destDir, const QString &p_destName, VFile *p_file, bool p_cut);
+
+    // Update the configs and the list after the copy job @p_job finished.
+    // @p_obsoleteImages: source images to remove if succeeded.
+    void handleFileCopied(const VTransferJob *p_job, bool p_succeed,
+                          VDirectory *p_destDir, const QString &p_destName,
+                          VFile *p_file, bool p_cut, const QStringList &p_skippedImages,
+                          const QStringList &p_obsoleteImages);
     // New items have been added to direcotry. Update file list accordingly.
     QVector<QListWidgetItem *> updateFileListAdded();
     inline QPointer<VFile> getVFile(QListWidgetItem *p_item) const;
@@ -0,0 +1,211 @@
+#include "vfilewatcher.h"
+
+#include <QFileSystemWatcher>
+#include <QTimer>
+#include <QDir>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QDebug>
+#include "vnote.h"
+
+extern VNote *g_vnote;
+
+const int VFileWatcher::c_flushInterval = 500;
+
+const int VFileWatcher::c_pollInterval = 3000;
+
+VFileWatcher::VFileWatcher(QObject *p_parent)
+    : QObject(p_parent)
+{
+    m_watcher = new QFileSystemWatcher(this);
+    connect(m_watcher, &QFileSystemWatcher::directoryChanged,
+            this, &VFileWatcher::handleDirectoryChanged);
+    connect(m_watcher, &QFileSystemWatcher::fileChanged,
+            this, &VFileWatcher::handleFileChanged);
+
+    m_flushTimer = new QTimer(this);
+    m_flushTimer->setSingleShot(true);
+    m_flushTimer->setInterval(c_flushInterval);
+    connect(m_flushTimer, &QTimer::timeout,
+            this, &VFileWatcher::flushChanges);
+
+    m_pollTimer = new QTimer(this);
+    m_pollTimer->setInterval(c_pollInterval);
+    connect(m_pollTimer, &QTimer::timeout,
+            this, &VFileWatcher::poll);
+}
+
+void VFileWatcher::watch(const QString &p_path)
+{
+    if (g_vnote) {
+        g_vnote->getFileWatcher()->addPath(p_path);
+    }
+}
+
+void VFileWatcher::unwatch(const QString &p_path)
+{
+    if (g_vnote) {
+        g_vnote->getFileWatcher()->removePath(p_path);
+    }
+}
+
+void VFileWatcher::addPath(const QString &p_path)
+{
+    QString path = QDir::cleanPath(p_path);
+    int &ref = m_refs[path];
+    if (ref++ > 0) {
+        return;
+    }
+
+    if (QFileInfo(path).isDir()) {
+        m_dirScanTime.insert(path, QDateTime::currentMSecsSinceEpoch());
+    }
+
+    if (!m_watcher->addPath(path)) {
+        qWarning() << "fail to watch" << path << "and poll it instead";
+        m_polledPaths.insert(path, signatureOfPath(path));
+        if (!m_pollTimer->isActive()) {
+            m_pollTimer->start();
+        }
+    }
+}
+
+void VFileWatcher::removePath(const QString &p_path)
+{
+    QString path = QDir::cleanPath(p_path);
+    auto it = m_refs.find(path);
+    if (it == m_refs.end()) {
+        return;
+    }
+
+    if (--it.value() > 0) {
+        return;
+    }
+
+    m_refs.erase(it);
+    m_dirScanTime.remove(path);
+
+    if (m_polledPaths.remove(path) == 0) {
+        m_watcher->removePath(path);
+    } else if (m_polledPaths.isEmpty()) {
+        m_pollTimer->stop();
+    }
+}
+
+void VFileWatcher::handleDirectoryChanged(const QString &p_path)
+{
+    m_changedDirs.insert(p_path);
+
+    // The watch is dropped once the directory is removed.
+    if (!QFileInfo::exists(p_path)) {
+        m_polledPaths.insert(p_path, -1);
+        m_pollTimer->start();
+    }
+
+    if (!m_flushTimer->isActive()) {
+        m_flushTimer->start();
+    }
+}
+
+void VFileWatcher::handleFileChanged(const QString &p_path)
+{
+    m_changedFiles.insert(p_path);
+
+    // The watch is dropped if the file is removed or replaced, which is
+    // how many tools save a file.
+    if (!m_watcher->files().contains(p_path)) {
+        if (!QFileInfo::exists(p_path) || !m_watcher->addPath(p_path)) {
+            m_polledPaths.insert(p_path, signatureOfPath(p_path));
+            m_pollTimer->start();
+        }
+    }
+
+    if (!m_flushTimer->isActive()) {
+        m_flushTimer->start();
+    }
+}
+
+void VFileWatcher::poll()
+{
+    for (auto it = m_polledPaths.begin(); it != m_polledPaths.end();) {
+        const QString &path = it.key();
+        qint64 sig = signatureOfPath(path);
+        if (sig == it.value()) {
+            ++it;
+            continue;
+        }
+
+        if (m_dirScanTime.contains(path)) {
+            m_changedDirs.insert(path);
+        } else {
+            m_changedFiles.insert(path);
+        }
+
+        // Try to watch it again.
+        if (sig != -1 && m_watcher->addPath(path)) {
+            it = m_polledPaths.erase(it);
+        } else {
+            it.value() = sig;
+            ++it;
+        }
+    }
+
+    if (m_polledPaths.isEmpty()) {
+        m_pollTimer->stop();
+    }
+
+    if ((!m_changedDirs.isEmpty() || !m_changedFiles.isEmpty())
+        && !m_flushTimer->isActive()) {
+        m_flushTimer->start();
+    }
+}
+
+void VFileWatcher::flushChanges()
+{
+    QStringList dirs = m_changedDirs.toList();
+    m_changedDirs.clear();
+
+    QSet<QString> files = m_changedFiles;
+    m_changedFiles.clear();
+
+    for (auto const &dir : dirs) {
+        collectModifiedFiles(dir, files);
+    }
+
+    if (!dirs.isEmpty()) {
+        qDebug() << "folders changed outside VNote" << dirs;
+        emit directoriesChanged(dirs);
+    }
+
+    if (!files.isEmpty()) {
+        emit filesChanged(files.toList());
+    }
+}
+
+void VFileWatcher::collectModifiedFiles(const QString &p_dir, QSet<QString> &p_files)
+{
+    auto it = m_dirScanTime.find(p_dir);
+    if (it == m_dirScanTime.end()) {
+        return;
+    }
+
+    qint64 since = it.value();
+    it.value() = QDateTime::currentMSecsSinceEpoch();
+
+    QFileInfoList infos = QDir(p_dir).entryInfoList(QDir::Files | QDir::NoDotAndDotDot);
+    for (auto const &info : infos) {
+        if (info.lastModified().toMSecsSinceEpoch() >= since) {
+            p_files.insert(QDir::cleanPath(info.absoluteFilePath()));
+        }
+    }
+}
+
+qint64 VFileWatcher::signatureOfPath(const QString &p_path)
+{
+    QFileInfo info(p_path);
+    if (!info.exists()) {
+        return -1;
+    }
+
+    return info.lastModified().toMSecsSinceEpoch() * 31 + info.size();
+}
@@ -0,0 +1,89 @@
+#ifndef VFILEWATCHER_H
+#define VFILEWATCHER_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QSet>
+
+class QFileSystemWatcher;
+class QTimer;
+
+// Watch the opened directories and notes for changes made outside VNote,
+// such as git pulls and sync tools.
+// Paths are watched via QFileSystemWatcher, or polled if it fails to watch
+// them (for example, the inotify limit is reached).
+// Events are batched and reported after a short delay.
+// Changes made by VNote itself are reported too, so the handlers should skip
+// them, such as via VFile::isWrittenByLastSave().
+// Should be used in the GUI thread.
+class VFileWatcher : public QObject
+{
+    Q_OBJECT
+public:
+    explicit VFileWatcher(QObject *p_parent = 0);
+
+    // Watch directory or file @p_path. Calls are reference counted.
+    void addPath(const QString &p_path);
+
+    void removePath(const QString &p_path);
+
+    // Watch and unwatch via the watcher of VNote.
+    static void watch(const QString &p_path);
+
+    static void unwatch(const QString &p_path);
+
+signals:
+    // Entries of directories @p_dirs have been added, removed or renamed.
+    void directoriesChanged(const QStringList &p_dirs);
+
+    // Files @p_files have been modified. It includes the watched files and
+    // the files modified within the changed directories.
+    void filesChanged(const QStringList &p_files);
+
+private slots:
+    void handleDirectoryChanged(const QString &p_path);
+
+    void handleFileChanged(const QString &p_path);
+
+    // Report the batched changes.
+    void flushChanges();
+
+    // Check the polled paths.
+    void poll();
+
+private:
+    // Stat of a path. Directory entries change the modified time of it.
+    static qint64 signatureOfPath(const QString &p_path);
+
+    // Collect the files in @p_dir modified after last scan.
+    void collectModifiedFiles(const QString &p_dir, QSet<QString> &p_files);
+
+    QFileSystemWatcher *m_watcher;
+
+    // Path -> reference count.
+    QHash<QString, int> m_refs;
+
+    // Paths failed to be watched -> signature of last poll.
+    QHash<QString, qint64> m_polledPaths;
+
+    // Watched directory -> time in msecs of last scan of its files.
+    QHash<QString, qint64> m_dirScanTime;
+
+    QSet<QString> m_changedDirs;
+
+    QSet<QString> m_changedFiles;
+
+    QTimer *m_flushTimer;
+
+    QTimer *m_pollTimer;
+
+    // Interval in msecs to batch the changes.
+    static const int c_flushInterval;
+
+    // Interval in msecs to poll the paths failed to be watched.
+    static const int c_pollInterval;
+};
+
+#endif // VFILEWATCHER_H
@@ -198,6 +198,15 @@ void VHtmlTab::scrollToAnchor(const VAnchor & /* p_anchor */)
 {
 }
 
+void VHtmlTab::scrollToLine(int p_lineNumber)
+{
+    if (p_lineNumber < 0) {
+        return;
+    }
+
+    m_editor->scrollToLine(p_lineNumber);
+}
+
 void VHtmlTab::insertImage()
 {
 }
@@ -234,6 +243,11 @@ QString VHtmlTab::getSelectedText() const
     return cursor.selectedText();
 }
 
+QString VHtmlTab::getContent() const
+{
+    return m_editor->toPlainText();
+}
+
 void VHtmlTab::clearSearchedWordHighlight()
 {
     m_editor->clearSearchedWordHighlight();
@@ -252,3 +266,13 @@ void VHtmlTab::requestUpdateVimStatus()
 {
     m_editor->requestUpdateVimStatus();
 }
+
+void VHtmlTab::reloadContent()
+{
+    m_editor->reloadFile();
+    if (m_isEditMode) {
+        m_editor->beginEdit();
+    }
+
+    updateStatus();
+}
@@ -29,6 +29,9 @@ public:
     // Scroll to anchor @p_anchor.
     void scrollToAnchor(const VAnchor& p_anchor) Q_DECL_OVERRIDE;
 
+    // Scroll to line @p_lineNumber of the file.
+    void scrollToLine(int p_lineNumber) Q_DECL_OVERRIDE;
+
     void insertImage() Q_DECL_OVERRIDE;
 
     // Search @p_text in current note.
@@ -44,10 +47,14 @@ public:
 
     QString getSelectedText() const Q_DECL_OVERRIDE;
 
+    QString getContent() const Q_DECL_OVERRIDE;
+
     void clearSearchedWordHighlight() Q_DECL_OVERRIDE;
 
     void requestUpdateVimStatus() Q_DECL_OVERRIDE;
 
+    void reloadContent() Q_DECL_OVERRIDE;
+
 public slots:
     // Enter edit mode.
     void editFile() Q_DECL_OVERRIDE;
@@ -5,17 +5,29 @@
 #include <QDebug>
 #include <QDir>
 #include <QUrl>
+#include <QScrollBar>
+#include <QAbstractTextDocumentLayout>
 #include "vmdedit.h"
 #include "vconfigmanager.h"
 #include "utils/vutils.h"
-#include "utils/veditutils.h"
 #include "vfile.h"
 #include "vdownloader.h"
 #include "hgmarkdownhighlighter.h"
 
 extern VConfigManager vconfig;
 
-enum ImageProperty { ImagePath = 1 };
+// Properties of the block format to record the preview.
+enum ImageProperty
+{
+    // Full path of the previewed image.
+    ImagePath = QTextFormat::UserProperty + 1,
+
+    // Size of the preview.
+    ImageSize,
+
+    // URL of the image link in the block text.
+    ImageUrl
+};
 
 const int VImagePreviewer::c_minImageWidth = 100;
 
@@ -89,33 +101,80 @@ void VImagePreviewer::previewImages()
     m_imageWidth = qMax(m_edit->size().width() - 50, c_minImageWidth);
 
     m_isPreviewing = true;
-    QTextBlock block = m_document->begin();
-    while (block.isValid() && m_enablePreview) {
-        if (isImagePreviewBlock(block)) {
-            // Image preview block. Check if it is parentless.
-            if (!isValidImagePreviewBlock(block) || !isNormalBlock(block)) {
-                QTextBlock nblock = block.next();
-                removeBlock(block);
-                block = nblock;
-            } else {
-                block = block.next();
+
+    QTextCursor startCursor, endCursor;
+    bool partial = fetchPreviewRange(startCursor, endCursor);
+
+    // Changing the previews above the viewport will make the content jump.
+    // Record the first visible block to restore the scroll position.
+    QScrollBar *vbar = m_edit->verticalScrollBar();
+    QAbstractTextDocumentLayout *layout = m_document->documentLayout();
+    QTextCursor anchorCursor;
+    int anchorOffset = 0;
+    if (partial) {
+        int pos = layout->hitTest(QPointF(0, vbar->value()), Qt::FuzzyHit);
+        QTextBlock anchorBlock = m_document->findBlock(qMax(pos, 0));
+        anchorCursor = QTextCursor(anchorBlock);
+        anchorOffset = vbar->value() - (int)layout->blockBoundingRect(anchorBlock).y();
+    }
+
+    m_previewedImages.clear();
+
+    bool changed = false;
+    for (QTextBlock block = m_document->begin(); block.isValid(); block = block.next()) {
+        if (partial && !isBlockInRange(block, startCursor, endCursor)) {
+            // Scrolling only decides which previews to create. Existing ones
+            // out of range are kept unless the link is gone, so the layout
+            // does not change by scrolling.
+            QString curPath = block.blockFormat().property(ImagePath).toString();
+            if (!curPath.isEmpty()
+                && (!isNormalBlock(block) || fetchImagePathToPreview(block.text()) != curPath)) {
+                setBlockPreview(block, QString(), QSize());
+                changed = true;
             }
-        } else {
-            clearCorruptedImagePreviewBlock(block);
 
-            if (isNormalBlock(block)) {
-                block = previewImageOfOneBlock(block);
-            } else {
-                block = block.next();
+            continue;
+        }
+
+        QString imagePath;
+        QSize size;
+        if (isNormalBlock(block)) {
+            imagePath = fetchImagePathToPreview(block.text());
+            if (!imagePath.isEmpty()) {
+                m_previewedImages.insert(imagePath);
+
+                size = previewSize(cachedImage(imagePath));
+                if (!size.isValid()) {
+                    // Not loaded yet.
+                    imagePath.clear();
+                }
             }
         }
+
+        if (setBlockPreview(block, imagePath, size)) {
+            changed = true;
+        }
+    }
+
+    if (partial) {
+        QTextBlock anchorBlock = anchorCursor.block();
+        if (changed && anchorBlock.isValid()) {
+            vbar->setValue((int)layout->blockBoundingRect(anchorBlock).y() + anchorOffset);
+        }
+
+        evictUnusedImages();
+    }
+
+    if (changed) {
+        // The cursor line may be moved by the previews above it.
+        m_edit->highlightCurrentLine();
     }
 
     m_isPreviewing = false;
 
     if (m_requestCearBlocks) {
         m_requestCearBlocks = false;
-        clearAllImagePreviewBlocks();
+        clearAllPreviews();
     }
 
     if (m_requestRefreshBlocks) {
@@ -132,56 +191,73 @@ void VImagePreviewer::previewImages()
     emit m_edit->statusChanged();
 }
 
-bool VImagePreviewer::isImagePreviewBlock(const QTextBlock &p_block)
+bool VImagePreviewer::fetchPreviewRange(QTextCursor &p_start, QTextCursor &p_end)
 {
-    if (!p_block.isValid()) {
+    int screens = vconfig.getImagePreviewScreens();
+    if (screens <= 0) {
         return false;
     }
 
-    QString text = p_block.text().trimmed();
-    return text == QString(QChar::ObjectReplacementCharacter);
+    int height = m_edit->viewport()->height();
+    int value = m_edit->verticalScrollBar()->value();
+    QAbstractTextDocumentLayout *layout = m_document->documentLayout();
+
+    int top = qMax(value - screens * height, 0);
+    int bottom = value + (screens + 1) * height;
+
+    int startPos = layout->hitTest(QPointF(0, top), Qt::FuzzyHit);
+    int endPos = layout->hitTest(QPointF(0, bottom), Qt::FuzzyHit);
+
+    QTextBlock startBlock = startPos < 0 ? m_document->begin()
+                                         : m_document->findBlock(startPos);
+    QTextBlock endBlock = endPos < 0 ? m_document->lastBlock()
+                                     : m_document->findBlock(endPos);
+
+    p_start = QTextCursor(startBlock);
+    p_end = QTextCursor(endBlock);
+    return true;
 }
 
-bool VImagePreviewer::isValidImagePreviewBlock(QTextBlock &p_block)
+bool VImagePreviewer::isBlockInRange(const QTextBlock &p_block,
+                                     const QTextCursor &p_start,
+                                     const QTextCursor &p_end) const
 {
-    if (!isImagePreviewBlock(p_block)) {
+    if (!p_block.isValid()) {
         return false;
     }
 
-    // It is a valid image preview block only if the previous block is a block
-    // need to preview (containing exactly one image) and the image paths are
-    // identical.
-    QTextBlock prevBlock = p_block.previous();
-    if (prevBlock.isValid()) {
-        QString imagePath = fetchImagePathToPreview(prevBlock.text());
-        if (imagePath.isEmpty()) {
-            return false;
-        }
-
-        // Get image preview block's image path.
-        QString curPath = fetchImagePathFromPreviewBlock(p_block);
+    int pos = p_block.position();
+    return pos >= p_start.position() && pos <= p_end.position();
+}
 
-        return curPath == imagePath;
-    } else {
-        return false;
+void VImagePreviewer::evictUnusedImages()
+{
+    for (auto it = m_imageCache.begin(); it != m_imageCache.end();) {
+        if (it.value().m_inMemory || m_previewedImages.contains(it.key())) {
+            ++it;
+        } else {
+            it = m_imageCache.erase(it);
+        }
     }
 }
 
-QString VImagePreviewer::fetchImageUrlToPreview(const QString &p_text)
+void VImagePreviewer::viewportScrolled()
 {
-    QRegExp regExp(VUtils::c_imageLinkRegExp);
-
-    int index = regExp.indexIn(p_text);
-    if (index == -1) {
-        return QString();
+    if (vconfig.getImagePreviewScreens() <= 0 || m_isPreviewing) {
+        return;
     }
 
-    int lastIndex = regExp.lastIndexIn(p_text);
-    if (lastIndex != index) {
+    update();
+}
+
+QString VImagePreviewer::fetchImageUrlToPreview(const QString &p_text)
+{
+    QStringList urls = VUtils::fetchImageUrlsFromMarkdownText(p_text);
+    if (urls.size() != 1) {
         return QString();
     }
 
-    return regExp.capturedTexts()[2].trimmed();
+    return urls[0];
 }
 
 QString VImagePreviewer::fetchImagePathToPreview(const QString &p_text)
@@ -201,149 +277,59 @@ QString VImagePreviewer::fetchImagePathToPreview(const QString &p_text)
             imagePath = imageUrl;
         }
     } else {
-        QUrl url(imageUrl);
-        imagePath = url.toString();
+        QString localPath = QDir::cleanPath(info.absoluteFilePath());
+        if (m_imageCache.contains(localPath)) {
+            // Local image being saved.
+            imagePath = localPath;
+        } else {
+            QUrl url(imageUrl);
+            imagePath = url.toString();
+        }
     }
 
     return imagePath;
 }
 
-QTextBlock VImagePreviewer::previewImageOfOneBlock(QTextBlock &p_block)
+bool VImagePreviewer::setBlockPreview(QTextBlock &p_block, const QString &p_imagePath,
+                                      const QSize &p_size)
 {
-    if (!p_block.isValid()) {
-        return p_block;
+    QString imageUrl;
+    if (!p_imagePath.isEmpty()) {
+        imageUrl = fetchImageUrlToPreview(p_block.text());
     }
 
-    QTextBlock nblock = p_block.next();
-
-    QString imagePath = fetchImagePathToPreview(p_block.text());
-    if (imagePath.isEmpty()) {
-        return nblock;
+    QTextBlockFormat format = p_block.blockFormat();
+    if (format.property(ImagePath).toString() == p_imagePath
+        && format.property(ImageSize).toSize() == p_size
+        && format.property(ImageUrl).toString() == imageUrl) {
+        return false;
     }
 
-    qDebug() << "block" << p_block.blockNumber() << imagePath;
-
-    if (isImagePreviewBlock(nblock)) {
-        QTextBlock nextBlock = nblock.next();
-        updateImagePreviewBlock(nblock, imagePath);
-
-        return nextBlock;
+    if (p_imagePath.isEmpty()) {
+        format.clearProperty(ImagePath);
+        format.clearProperty(ImageSize);
+        format.clearProperty(ImageUrl);
+        format.clearProperty(QTextFormat::BlockBottomMargin);
     } else {
-        QTextBlock imgBlock = insertImagePreviewBlock(p_block, imagePath);
-
-        return imgBlock.next();
+        format.setProperty(ImagePath, p_imagePath);
+        format.setProperty(ImageSize, p_size);
+        format.setProperty(ImageUrl, imageUrl);
+        format.setBottomMargin(p_size.height());
     }
-}
 
-QTextBlock VImagePreviewer::insertImagePreviewBlock(QTextBlock &p_block,
-                                                    const QString &p_imagePath)
-{
-    QString imageName = imageCacheResourceName(p_imagePath);
-    if (imageName.isEmpty()) {
-        return p_block;
-    }
-
-    bool modified = m_edit->isModified();
+    // It only changes the layout. Block the signals of the document so the
+    // highlighter, the undo history and the modified state will not take it
+    // as an edit. The layout is notified directly by the document.
+    bool modified = m_document->isModified();
+    m_document->blockSignals(true);
 
     QTextCursor cursor(p_block);
-    cursor.beginEditBlock();
-    cursor.movePosition(QTextCursor::EndOfBlock);
-    cursor.insertBlock();
-
-    QTextImageFormat imgFormat;
-    imgFormat.setName(imageName);
-    imgFormat.setProperty(ImagePath, p_imagePath);
-
-    updateImageWidth(imgFormat);
-
-    cursor.insertImage(imgFormat);
-    cursor.endEditBlock();
-
-    V_ASSERT(cursor.block().text().at(0) == QChar::ObjectReplacementCharacter);
-
-    m_edit->setModified(modified);
-
-    return cursor.block();
-}
-
-void VImagePreviewer::updateImagePreviewBlock(QTextBlock &p_block,
-                                              const QString &p_imagePath)
-{
-    QTextImageFormat format = fetchFormatFromPreviewBlock(p_block);
-    V_ASSERT(format.isValid());
-    QString curPath = format.property(ImagePath).toString();
-    QString imageName;
-
-    if (curPath == p_imagePath) {
-        if (updateImageWidth(format)) {
-            goto update;
-        }
-
-        return;
-    }
+    cursor.setBlockFormat(format);
+    m_document->setModified(modified);
 
-    // Update it with the new image.
-    imageName = imageCacheResourceName(p_imagePath);
-    if (imageName.isEmpty()) {
-        // Delete current preview block.
-        removeBlock(p_block);
-        return;
-    }
-
-    format.setName(imageName);
-    format.setProperty(ImagePath, p_imagePath);
-
-    updateImageWidth(format);
-
-update:
-    updateFormatInPreviewBlock(p_block, format);
-}
-
-void VImagePreviewer::removeBlock(QTextBlock &p_block)
-{
-    bool modified = m_edit->isModified();
+    m_document->blockSignals(false);
 
-    VEditUtils::removeBlock(p_block);
-
-    m_edit->setModified(modified);
-}
-
-void VImagePreviewer::clearCorruptedImagePreviewBlock(QTextBlock &p_block)
-{
-    if (!p_block.isValid()) {
-        return;
-    }
-
-    QString text = p_block.text();
-    QVector<int> replacementChars;
-    bool onlySpaces = true;
-    for (int i = 0; i < text.size(); ++i) {
-        if (text[i] == QChar::ObjectReplacementCharacter) {
-            replacementChars.append(i);
-        } else if (!text[i].isSpace()) {
-            onlySpaces = false;
-        }
-    }
-
-    if (!onlySpaces && !replacementChars.isEmpty()) {
-        // ObjectReplacementCharacter mixed with other non-space texts.
-        // Users corrupt the image preview block. Just remove the char.
-        bool modified = m_edit->isModified();
-
-        QTextCursor cursor(p_block);
-        cursor.beginEditBlock();
-        int blockPos = p_block.position();
-        for (int i = replacementChars.size() - 1; i >= 0; --i) {
-            int pos = replacementChars[i];
-            cursor.setPosition(blockPos + pos);
-            cursor.deleteChar();
-        }
-        cursor.endEditBlock();
-
-        m_edit->setModified(modified);
-
-        V_ASSERT(text.remove(QChar::ObjectReplacementCharacter) == p_block.text());
-    }
+    return true;
 }
 
 bool VImagePreviewer::isPreviewEnabled()
@@ -366,7 +352,7 @@ void VImagePreviewer::disableImagePreview()
     m_enablePreview = false;
 
     if (m_isPreviewing) {
-        // It is previewing, append the request and clear preview blocks after
+        // It is previewing, append the request and clear previews after
         // finished previewing.
         // It is weird that when selection changed, it will interrupt the process
         // of previewing.
@@ -374,92 +360,87 @@ void VImagePreviewer::disableImagePreview()
         return;
     }
 
-    clearAllImagePreviewBlocks();
+    clearAllPreviews();
 }
 
-void VImagePreviewer::clearAllImagePreviewBlocks()
+void VImagePreviewer::clearAllPreviews()
 {
     V_ASSERT(!m_isPreviewing);
 
-    QTextBlock block = m_document->begin();
-    QTextCursor cursor = m_edit->textCursor();
-    bool modified = m_edit->isModified();
-
-    cursor.beginEditBlock();
-    while (block.isValid()) {
-        if (isImagePreviewBlock(block)) {
-            QTextBlock nextBlock = block.next();
-            removeBlock(block);
-            block = nextBlock;
-        } else {
-            clearCorruptedImagePreviewBlock(block);
-
-            block = block.next();
+    bool changed = false;
+    for (QTextBlock block = m_document->begin(); block.isValid(); block = block.next()) {
+        if (setBlockPreview(block, QString(), QSize())) {
+            changed = true;
         }
     }
-    cursor.endEditBlock();
 
-    m_edit->setModified(modified);
+    if (changed) {
+        m_edit->highlightCurrentLine();
+    }
 
     emit m_edit->statusChanged();
 }
 
-QString VImagePreviewer::fetchImagePathFromPreviewBlock(QTextBlock &p_block)
+QRectF VImagePreviewer::previewRect(const QTextBlock &p_block) const
 {
-    QTextImageFormat format = fetchFormatFromPreviewBlock(p_block);
-    if (!format.isValid()) {
-        return QString();
+    QTextBlockFormat format = p_block.blockFormat();
+    QSize size = format.property(ImageSize).toSize();
+    if (!size.isValid() || !p_block.isVisible()) {
+        return QRectF();
     }
 
-    return format.property(ImagePath).toString();
-}
-
-QTextImageFormat VImagePreviewer::fetchFormatFromPreviewBlock(QTextBlock &p_block)
-{
-    QTextCursor cursor(p_block);
-    int shift = p_block.text().indexOf(QChar::ObjectReplacementCharacter);
-    if (shift >= 0) {
-        cursor.movePosition(QTextCursor::Right, QTextCursor::MoveAnchor, shift + 1);
-    } else {
-        return QTextImageFormat();
+    // A block split from the previewed one inherits its format until next
+    // round of preview. Only the one still containing the link shows it.
+    if (!p_block.text().contains(format.property(ImageUrl).toString())) {
+        return QRectF();
     }
 
-    return cursor.charFormat().toImageFormat();
+    // The bounding rect of the block does not include its margins.
+    QRectF rect = m_document->documentLayout()->blockBoundingRect(p_block);
+    return QRectF(rect.left(), rect.bottom(), size.width(), size.height());
 }
 
-void VImagePreviewer::updateFormatInPreviewBlock(QTextBlock &p_block,
-                                                 const QTextImageFormat &p_format)
+QPixmap VImagePreviewer::previewPixmap(const QTextBlock &p_block)
 {
-    bool modified = m_edit->isModified();
+    QTextBlockFormat format = p_block.blockFormat();
+    QString path = format.property(ImagePath).toString();
+    auto it = m_imageCache.find(path);
+    if (it == m_imageCache.end()) {
+        // Evicted while out of range. Load it again.
+        if (path.isEmpty() || cachedImage(path).isNull()) {
+            return QPixmap();
+        }
 
-    QTextCursor cursor(p_block);
-    cursor.beginEditBlock();
-    int shift = p_block.text().indexOf(QChar::ObjectReplacementCharacter);
-    if (shift > 0) {
-        cursor.movePosition(QTextCursor::Right, QTextCursor::MoveAnchor, shift);
+        it = m_imageCache.find(path);
     }
 
-    V_ASSERT(shift >= 0);
-
-    cursor.movePosition(QTextCursor::Right, QTextCursor::KeepAnchor, 1);
-    V_ASSERT(cursor.charFormat().toImageFormat().isValid());
+    // Scale it once instead of on each painting.
+    QSize size = format.property(ImageSize).toSize();
+    ImageInfo &info = it.value();
+    if (info.m_pixmap.size() != size) {
+        info.m_pixmap = QPixmap::fromImage(info.m_image.scaled(size,
+                                                               Qt::IgnoreAspectRatio,
+                                                               Qt::SmoothTransformation));
+    }
 
-    cursor.setCharFormat(p_format);
-    cursor.endEditBlock();
+    return info.m_pixmap;
+}
 
-    m_edit->setModified(modified);
+QImage VImagePreviewer::previewImage(const QTextBlock &p_block) const
+{
+    QString path = p_block.blockFormat().property(ImagePath).toString();
+    return m_imageCache.value(path).m_image;
 }
 
-QString VImagePreviewer::imageCacheResourceName(const QString &p_imagePath)
+QImage VImagePreviewer::cachedImage(const QString &p_imagePath)
 {
     V_ASSERT(!p_imagePath.isEmpty());
 
     auto it = m_imageCache.find(p_imagePath);
     if (it != m_imageCache.end()) {
-        return it.value().m_name;
+        return it.value().m_image;
     }
 
-    // Add it to the resource cache even if it may exist there.
     QFileInfo info(p_imagePath);
     QImage image;
     if (info.exists()) {
@@ -470,20 +451,26 @@ QString VImagePreviewer::imageCacheResourceName(const QString &p_imagePath)
         m_downloader->download(p_imagePath);
     }
 
-    if (image.isNull()) {
-        return QString();
+    if (!image.isNull()) {
+        m_imageCache.insert(p_imagePath, ImageInfo(image));
     }
 
-    QString name(imagePathToCacheResourceName(p_imagePath));
-    m_document->addResource(QTextDocument::ImageResource, name, image);
-    m_imageCache.insert(p_imagePath, ImageInfo(name, image.width()));
-
-    return name;
+    return image;
 }
 
-QString VImagePreviewer::imagePathToCacheResourceName(const QString &p_imagePath)
+QSize VImagePreviewer::previewSize(const QImage &p_image) const
 {
-    return p_imagePath;
+    if (p_image.isNull()) {
+        return QSize();
+    }
+
+    QSize size = p_image.size();
+    if (vconfig.getEnablePreviewImageConstraint() && size.width() > m_imageWidth) {
+        size.setHeight(qMax(size.height() * m_imageWidth / size.width(), 1));
+        size.setWidth(m_imageWidth);
+    }
+
+    return size;
 }
 
 void VImagePreviewer::imageDownloaded(const QByteArray &p_data, const QString &p_url)
@@ -497,11 +484,9 @@ void VImagePreviewer::imageDownloaded(const QByteArray &p_data, const QString &p
         }
 
         m_timer->stop();
-        QString name(imagePathToCacheResourceName(p_url));
-        m_document->addResource(QTextDocument::ImageResource, name, image);
-        m_imageCache.insert(p_url, ImageInfo(name, image.width()));
+        m_imageCache.insert(p_url, ImageInfo(image, true));
 
-        qDebug() << "downloaded image cache insert" << p_url << name;
+        qDebug() << "downloaded image cache insert" << p_url;
 
         m_timer->start();
     }
@@ -516,43 +501,32 @@ void VImagePreviewer::refresh()
 
     m_timer->stop();
     m_imageCache.clear();
-    clearAllImagePreviewBlocks();
+    clearAllPreviews();
     m_timer->start();
 }
 
-QImage VImagePreviewer::fetchCachedImageFromPreviewBlock(QTextBlock &p_block)
+void VImagePreviewer::cacheImage(const QString &p_imagePath, const QImage &p_image)
 {
-    QString path = fetchImagePathFromPreviewBlock(p_block);
-    if (path.isEmpty()) {
-        return QImage();
-    }
-
-    auto it = m_imageCache.find(path);
-    if (it == m_imageCache.end()) {
-        return QImage();
+    if (p_image.isNull()) {
+        return;
     }
 
-    return m_document->resource(QTextDocument::ImageResource, it.value().m_name).value<QImage>();
+    m_imageCache.insert(p_imagePath, ImageInfo(p_image, true));
 }
 
-bool VImagePreviewer::updateImageWidth(QTextImageFormat &p_format)
+void VImagePreviewer::imageSaveFinished(const QString &p_imagePath, const QImage &p_image)
 {
-    QString path = p_format.property(ImagePath).toString();
-    auto it = m_imageCache.find(path);
-
+    auto it = m_imageCache.find(p_imagePath);
     if (it != m_imageCache.end()) {
-        int newWidth = it.value().m_width;
-        if (vconfig.getEnablePreviewImageConstraint()) {
-            newWidth = qMin(m_imageWidth, it.value().m_width);
-        }
-
-        if (newWidth != p_format.width()) {
-            p_format.setWidth(newWidth);
-            return true;
-        }
+        // Backed by the file now.
+        it.value().m_inMemory = false;
+        return;
     }
 
-    return false;
+    if (!p_image.isNull()) {
+        m_imageCache.insert(p_imagePath, ImageInfo(p_image));
+        update();
+    }
 }
 
 void VImagePreviewer::update()
@@ -5,6 +5,11 @@
 #include <QString>
 #include <QTextBlock>
 #include <QHash>
+#include <QSet>
+#include <QTextCursor>
+#include <QImage>
+#include <QPixmap>
+#include <QRectF>
 
 class VMdEdit;
 class QTimer;
@@ -12,6 +17,9 @@ class QTextDocument;
 class VFile;
 class VDownloader;
 
+// Preview the image of a block containing exactly one image link.
+// The text is not touched. Space is reserved under the block via the bottom
+// margin of its format and VMdEdit paints the image there.
 class VImagePreviewer : public QObject
 {
     Q_OBJECT
@@ -22,16 +30,35 @@ public:
     void enableImagePreview();
     bool isPreviewEnabled();
 
-    bool isImagePreviewBlock(const QTextBlock &p_block);
+    // Get the rect of the image previewed under @p_block in document
+    // coordinates. Empty if there is none or the block does not contain the
+    // image link any more.
+    QRectF previewRect(const QTextBlock &p_block) const;
 
-    QImage fetchCachedImageFromPreviewBlock(QTextBlock &p_block);
+    // Get the scaled image previewed under @p_block to paint.
+    QPixmap previewPixmap(const QTextBlock &p_block);
 
-    // Clear the m_imageCache and all the preview blocks.
+    // Get the original image previewed under @p_block.
+    QImage previewImage(const QTextBlock &p_block) const;
+
+    // Clear the m_imageCache and all the previews.
     // Then re-preview all the blocks.
     void refresh();
 
     void update();
 
+    // Add @p_image of local path @p_imagePath to the cache, so it could be
+    // previewed before it is saved to disk.
+    void cacheImage(const QString &p_imagePath, const QImage &p_image);
+
+    // Saving image @p_imagePath is finished, so its cache could be evicted.
+    // @p_image is the decoded image to preview if it is not cached yet.
+    void imageSaveFinished(const QString &p_imagePath, const QImage &p_image);
+
+    // The viewport of m_edit has been scrolled.
+    // Re-preview if only images around the viewport are previewed.
+    void viewportScrolled();
+
 private slots:
     void timerTimeout();
     void handleContentChange(int p_position, int p_charsRemoved, int p_charsAdded);
@@ -40,17 +67,22 @@ private slots:
 private:
     struct ImageInfo
     {
-        ImageInfo(const QString &p_name, int p_width)
-            : m_name(p_name), m_width(p_width)
+        ImageInfo(const QImage &p_image = QImage(), bool p_inMemory = false)
+            : m_image(p_image), m_inMemory(p_inMemory)
         {
         }
 
-        QString m_name;
-        int m_width;
+        QImage m_image;
+
+        // Image scaled to the preview size, cached on painting.
+        QPixmap m_pixmap;
+
+        // Image not backed by a local file, such as downloaded images or images
+        // being saved. It will not be evicted from the cache.
+        bool m_inMemory;
     };
 
     void previewImages();
-    bool isValidImagePreviewBlock(QTextBlock &p_block);
 
     // Fetch the image link's URL if there is only one link.
     QString fetchImageUrlToPreview(const QString &p_text);
@@ -58,43 +90,38 @@ private:
     // Fetch teh image's full path if there is only one image link.
     QString fetchImagePathToPreview(const QString &p_text);
 
-    // Try to preview the image of @p_block.
-    // Return the next block to process.
-    QTextBlock previewImageOfOneBlock(QTextBlock &p_block);
-
-    // Insert a new block to preview image.
-    QTextBlock insertImagePreviewBlock(QTextBlock &p_block, const QString &p_imagePath);
-
-    // @p_block is the image block. Update it to preview @p_imagePath.
-    void updateImagePreviewBlock(QTextBlock &p_block, const QString &p_imagePath);
+    // Reserve space under @p_block to preview @p_imagePath in @p_size.
+    // Clear the preview if @p_imagePath is empty.
+    // Return true if there is update.
+    bool setBlockPreview(QTextBlock &p_block, const QString &p_imagePath,
+                         const QSize &p_size);
 
-    void removeBlock(QTextBlock &p_block);
+    void clearAllPreviews();
 
-    // Corrupted image preview block: ObjectReplacementCharacter mixed with other
-    // non-space characters.
-    // Remove the ObjectReplacementCharacter chars.
-    void clearCorruptedImagePreviewBlock(QTextBlock &p_block);
+    // Look up m_imageCache to get the image of @p_imagePath.
+    // If there is none, load it.
+    QImage cachedImage(const QString &p_imagePath);
 
-    void clearAllImagePreviewBlocks();
+    // Get the size to preview @p_image.
+    QSize previewSize(const QImage &p_image) const;
 
-    QTextImageFormat fetchFormatFromPreviewBlock(QTextBlock &p_block);
-
-    QString fetchImagePathFromPreviewBlock(QTextBlock &p_block);
-
-    void updateFormatInPreviewBlock(QTextBlock &p_block,
-                                    const QTextImageFormat &p_format);
-
-    // Look up m_imageCache to get the resource name in QTextDocument's cache.
-    // If there is none, insert it.
-    QString imageCacheResourceName(const QString &p_imagePath);
+    // Whether it is a normal block or not.
+    bool isNormalBlock(const QTextBlock &p_block);
 
-    QString imagePathToCacheResourceName(const QString &p_imagePath);
+    // Get the range of blocks to preview images according to the viewport.
+    // @p_start is at the start of the first block and @p_end is at the start
+    // of the last block.
+    // Return false if all the blocks should be previewed.
+    bool fetchPreviewRange(QTextCursor &p_start, QTextCursor &p_end);
 
-    // Return true if and only if there is update.
-    bool updateImageWidth(QTextImageFormat &p_format);
+    // Whether @p_block is within the range [@p_start, @p_end].
+    bool isBlockInRange(const QTextBlock &p_block,
+                        const QTextCursor &p_start,
+                        const QTextCursor &p_end) const;
 
-    // Whether it is a normal block or not.
-    bool isNormalBlock(const QTextBlock &p_block);
+    // Remove images not previewed in last round from the cache. Previews
+    // kept out of range will load their images again on painting.
+    void evictUnusedImages();
 
     VMdEdit *m_edit;
     QTextDocument *m_document;
@@ -106,8 +133,11 @@ private:
     bool m_requestRefreshBlocks;
     bool m_updatePending;
 
-    // Map from image full path to QUrl identifier in the QTextDocument's cache.
-    QHash<QString, ImageInfo> m_imageCache;;
+    // Map from image full path to the image.
+    QHash<QString, ImageInfo> m_imageCache;
+
+    // Image paths previewed in current round.
+    QSet<QString> m_previewedImages;
 
     VDownloader *m_downloader;
 
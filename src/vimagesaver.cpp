@@ -0,0 +1,179 @@
+#include "vimagesaver.h"
+
+#include <QtConcurrent>
+#include <QFutureWatcher>
+#include <QCryptographicHash>
+#include <QBuffer>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QDebug>
+#include "vconfigmanager.h"
+#include "utils/vutils.h"
+
+extern VConfigManager vconfig;
+
+VImageSaver::VImageSaver(QObject *p_parent)
+    : QObject(p_parent), m_nextId(0)
+{
+}
+
+int VImageSaver::saveImage(const QImage &p_image,
+                           const QString &p_folder,
+                           const QString &p_fileName,
+                           const QString &p_format,
+                           int p_quality)
+{
+    int id = m_nextId++;
+    watch(QtConcurrent::run([=]() {
+        return doSaveImage(id, p_image, p_folder, p_fileName, p_format, p_quality);
+    }));
+    return id;
+}
+
+int VImageSaver::copyImage(const QString &p_srcPath,
+                           const QString &p_folder,
+                           const QString &p_fileName)
+{
+    int id = m_nextId++;
+    watch(QtConcurrent::run([=]() {
+        return doCopyImage(id, p_srcPath, p_folder, p_fileName);
+    }));
+    return id;
+}
+
+void VImageSaver::watch(const QFuture<SaveResult> &p_future)
+{
+    QFutureWatcher<SaveResult> *watcher = new QFutureWatcher<SaveResult>(this);
+    connect(watcher, &QFutureWatcher<SaveResult>::finished,
+            this, [this, watcher]() {
+                SaveResult result = watcher->result();
+                watcher->deleteLater();
+
+                emit imageSaved(result.m_id, result.m_filePath, result.m_errStr, result.m_image);
+            });
+
+    watcher->setFuture(p_future);
+}
+
+VImageSaver::SaveResult VImageSaver::doSaveImage(int p_id,
+                                                 const QImage &p_image,
+                                                 const QString &p_folder,
+                                                 const QString &p_fileName,
+                                                 const QString &p_format,
+                                                 int p_quality)
+{
+    QByteArray data;
+    QBuffer buffer(&data);
+    buffer.open(QIODevice::WriteOnly);
+    if (!p_image.save(&buffer, p_format.toLatin1().constData(), p_quality)) {
+        SaveResult result;
+        result.m_id = p_id;
+        result.m_filePath = QDir(p_folder).filePath(p_fileName);
+        result.m_errStr = tr("Fail to encode image in format %1.").arg(p_format);
+        return result;
+    }
+
+    buffer.close();
+
+    SaveResult result = writeImageData(p_id, data, p_folder, p_fileName, p_format);
+    if (result.m_errStr.isEmpty()) {
+        result.m_image = p_image;
+    }
+
+    return result;
+}
+
+VImageSaver::SaveResult VImageSaver::doCopyImage(int p_id,
+                                                 const QString &p_srcPath,
+                                                 const QString &p_folder,
+                                                 const QString &p_fileName)
+{
+    QFile file(p_srcPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        SaveResult result;
+        result.m_id = p_id;
+        result.m_filePath = QDir(p_folder).filePath(p_fileName);
+        result.m_errStr = tr("Fail to read image <span style=\"%1\">%2</span>.")
+                            .arg(vconfig.c_dataTextStyle).arg(p_srcPath);
+        return result;
+    }
+
+    QByteArray data = file.readAll();
+    file.close();
+
+    SaveResult result = writeImageData(p_id, data, p_folder, p_fileName,
+                                       QFileInfo(p_srcPath).suffix());
+    if (result.m_errStr.isEmpty()) {
+        // Decode it here to keep the GUI thread from it.
+        result.m_image = QImage::fromData(data);
+    }
+
+    return result;
+}
+
+VImageSaver::SaveResult VImageSaver::writeImageData(int p_id,
+                                                    const QByteArray &p_data,
+                                                    const QString &p_folder,
+                                                    const QString &p_fileName,
+                                                    const QString &p_suffix)
+{
+    SaveResult result;
+    result.m_id = p_id;
+
+    bool contentAddressed = p_fileName.isEmpty();
+    QString fileName = p_fileName;
+    if (contentAddressed) {
+        fileName = QString::fromLatin1(QCryptographicHash::hash(p_data, QCryptographicHash::Md5).toHex());
+        if (!p_suffix.isEmpty()) {
+            fileName += "." + p_suffix.toLower();
+        }
+    }
+
+    result.m_filePath = QDir(p_folder).filePath(fileName);
+
+    if (!VUtils::makePath(p_folder)) {
+        result.m_errStr = tr("Fail to create image folder <span style=\"%1\">%2</span>.")
+                            .arg(vconfig.c_dataTextStyle).arg(p_folder);
+        return result;
+    }
+
+    if (contentAddressed) {
+        QFileInfo info(result.m_filePath);
+        if (info.exists() && info.size() == p_data.size()) {
+            // Identical image exists already.
+            qDebug() << "reuse existing image" << result.m_filePath;
+            return result;
+        }
+    }
+
+    QFile file(result.m_filePath);
+    if (!file.open(QIODevice::WriteOnly)
+        || file.write(p_data) != p_data.size()) {
+        result.m_errStr = tr("Fail to save image <span style=\"%1\">%2</span>.")
+                            .arg(vconfig.c_dataTextStyle).arg(result.m_filePath);
+        file.close();
+        file.remove();
+        return result;
+    }
+
+    file.close();
+
+    return result;
+}
+
+bool VImageSaver::isContentAddressedName(const QString &p_fileName)
+{
+    QString baseName = QFileInfo(p_fileName).completeBaseName();
+    if (baseName.size() != 32) {
+        return false;
+    }
+
+    for (auto const &ch : baseName) {
+        if (!((ch >= '0' && ch <= '9') || (ch >= 'a' && ch <= 'f'))) {
+            return false;
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,83 @@
+#ifndef VIMAGESAVER_H
+#define VIMAGESAVER_H
+
+#include <QObject>
+#include <QString>
+#include <QImage>
+#include <QFuture>
+
+// Encode and save images to disk in background.
+class VImageSaver : public QObject
+{
+    Q_OBJECT
+public:
+    explicit VImageSaver(QObject *p_parent = 0);
+
+    // Encode @p_image in @p_format with @p_quality and save it into folder @p_folder.
+    // If @p_fileName is empty, the file will be named by the hash of the
+    // encoded data and an existing identical file will be reused.
+    // Returns the id of this request.
+    int saveImage(const QImage &p_image,
+                  const QString &p_folder,
+                  const QString &p_fileName,
+                  const QString &p_format,
+                  int p_quality = -1);
+
+    // Copy image file @p_srcPath into folder @p_folder and decode it.
+    // If @p_fileName is empty, the file will be named by the hash of the
+    // data and an existing identical file will be reused.
+    // Returns the id of this request.
+    int copyImage(const QString &p_srcPath,
+                  const QString &p_folder,
+                  const QString &p_fileName);
+
+    // Whether @p_fileName looks like a content-addressed image name.
+    static bool isContentAddressedName(const QString &p_fileName);
+
+signals:
+    // Request @p_id is finished.
+    // @p_filePath is the path of the image saved.
+    // @p_errStr is empty if succeeded.
+    // @p_image is the image decoded in background, null if failed.
+    void imageSaved(int p_id, const QString &p_filePath, const QString &p_errStr,
+                    const QImage &p_image);
+
+private:
+    struct SaveResult
+    {
+        SaveResult() : m_id(-1)
+        {
+        }
+
+        int m_id;
+        QString m_filePath;
+        QString m_errStr;
+        QImage m_image;
+    };
+
+    // Write @p_data into folder @p_folder.
+    static SaveResult writeImageData(int p_id,
+                                     const QByteArray &p_data,
+                                     const QString &p_folder,
+                                     const QString &p_fileName,
+                                     const QString &p_suffix);
+
+    static SaveResult doSaveImage(int p_id,
+                                  const QImage &p_image,
+                                  const QString &p_folder,
+                                  const QString &p_fileName,
+                                  const QString &p_format,
+                                  int p_quality);
+
+    static SaveResult doCopyImage(int p_id,
+                                  const QString &p_srcPath,
+                                  const QString &p_folder,
+                                  const QString &p_fileName);
+
+    // Watch the future of a request and signal when it is finished.
+    void watch(const QFuture<SaveResult> &p_future);
+
+    int m_nextId;
+};
+
+#endif // VIMAGESAVER_H
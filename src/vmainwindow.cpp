@@ -23,6 +23,13 @@
 #include "vvimindicator.h"
 #include "vtabindicator.h"
 #include "dialog/vupdater.h"
+#include "dialog/vsearchdialog.h"
+#include "dialog/vtabsearchdialog.h"
+#include "vsearchengine.h"
+#include "vtransferengine.h"
+#include "vnotebook.h"
+#include "vfilewatcher.h"
+#include "vchangebus.h"
 
 extern VConfigManager vconfig;
 
@@ -33,11 +40,19 @@ extern QFile g_logFile;
 #endif
 
 VMainWindow::VMainWindow(QWidget *parent)
-    : QMainWindow(parent), m_onePanel(false)
+    : QMainWindow(parent), m_searchDialog(NULL),
+      m_tabSearchDialog(NULL), m_onePanel(false)
 {
     setWindowIcon(QIcon(":/resources/icons/vnote.ico"));
     vnote = new VNote(this);
     g_vnote = vnote;
+    m_searchEngine = new VSearchEngine(this);
+    connect(vnote->getTransferEngine(), &VTransferEngine::jobAdded,
+            this, &VMainWindow::handleTransferJobAdded);
+    connect(vnote->getFileWatcher(), &VFileWatcher::directoriesChanged,
+            this, &VMainWindow::handleDirectoriesChangedOutside);
+    connect(vnote->getFileWatcher(), &VFileWatcher::filesChanged,
+            this, &VMainWindow::handleFilesChangedOutside);
     vnote->initPalette(palette());
     initPredefinedColorPixmaps();
 
@@ -446,6 +461,17 @@ void VMainWindow::initMarkdownMenu()
     markdownMenu->addAction(imageCaptionAct);
     imageCaptionAct->setChecked(vconfig.getEnableImageCaption());
 
+    QAction *contentAddressedImageAct = new QAction(tr("Content-Addressed Images"), this);
+    contentAddressedImageAct->setToolTip(tr("Name inserted images by the hash of their content "
+                                            "to store identical images only once"));
+    contentAddressedImageAct->setCheckable(true);
+    connect(contentAddressedImageAct, &QAction::triggered,
+            this, [this](bool p_enabled){
+                vconfig.setEnableContentAddressedImages(p_enabled);
+            });
+    markdownMenu->addAction(contentAddressedImageAct);
+    contentAddressedImageAct->setChecked(vconfig.getEnableContentAddressedImages());
+
     markdownMenu->addSeparator();
 
     QAction *mermaidAct = new QAction(tr("&Mermaid Diagram"), this);
@@ -615,6 +641,20 @@ void VMainWindow::initEditMenu()
     connect(m_replaceAllAct, SIGNAL(triggered(bool)),
             m_findReplaceDialog, SLOT(replaceAll()));
 
+    // Search all the notebooks.
+    m_searchNotebooksAct = new QAction(tr("Search Notebooks"), this);
+    m_searchNotebooksAct->setToolTip(tr("Search the content of all the notes in all the notebooks"));
+    m_searchNotebooksAct->setShortcut(QKeySequence("Ctrl+Shift+F"));
+    connect(m_searchNotebooksAct, &QAction::triggered,
+            this, &VMainWindow::openSearchDialog);
+
+    // Search all the opened notes.
+    m_searchOpenedNotesAct = new QAction(tr("Search Opened Notes"), this);
+    m_searchOpenedNotesAct->setToolTip(tr("Search the content of all the notes opened in all the split windows"));
+    m_searchOpenedNotesAct->setShortcut(QKeySequence("Ctrl+Alt+F"));
+    connect(m_searchOpenedNotesAct, &QAction::triggered,
+            this, &VMainWindow::openTabSearchDialog);
+
     QAction *searchedWordAct = new QAction(tr("Highlight Searched Pattern"), this);
     searchedWordAct->setToolTip(tr("Highlight all occurences of searched pattern"));
     searchedWordAct->setCheckable(true);
@@ -710,6 +750,9 @@ void VMainWindow::initEditMenu()
     m_replaceFindAct->setEnabled(false);
     m_replaceAllAct->setEnabled(false);
 
+    editMenu->addAction(m_searchNotebooksAct);
+    editMenu->addAction(m_searchOpenedNotesAct);
+
     editMenu->addSeparator();
     editMenu->addAction(expandTabAct);
     if (vconfig.getIsExpandTab()) {
@@ -1169,6 +1212,8 @@ void VMainWindow::handleAreaTabStatusUpdated(const VEditTabInfo &p_info)
     updateActionStateFromTabStatusChange(m_curFile, editMode);
 
     QString title;
+    m_findReplaceDialog->updateMatchCount(p_info.m_searchMatchIndex, p_info.m_searchMatchCount);
+
     if (m_curFile) {
         m_findReplaceDialog->updateState(m_curFile->getDocType(), editMode);
 
@@ -1416,6 +1461,81 @@ void VMainWindow::openFindDialog()
     m_findReplaceDialog->openDialog(editArea->getSelectedText());
 }
 
+void VMainWindow::openSearchDialog()
+{
+    if (!m_searchDialog) {
+        m_searchDialog = new VSearchDialog(m_searchEngine, this);
+        connect(m_searchDialog, &VSearchDialog::resultActivated,
+                this, &VMainWindow::openSearchResult);
+    }
+
+    m_searchDialog->openDialog();
+}
+
+void VMainWindow::openTabSearchDialog()
+{
+    if (!m_tabSearchDialog) {
+        m_tabSearchDialog = new VTabSearchDialog(editArea, this);
+    }
+
+    m_tabSearchDialog->openDialog(editArea->getSelectedText());
+}
+
+void VMainWindow::openSearchResult(const QString &p_filePath, int p_lineNumber)
+{
+    VFile *file = NULL;
+    const QVector<VNotebook *> &notebooks = vnote->getNotebooks();
+    for (auto nb : notebooks) {
+        file = nb->tryLoadFile(p_filePath);
+        if (file) {
+            break;
+        }
+    }
+
+    if (!file) {
+        file = vnote->getOrphanFile(p_filePath);
+    }
+
+    // Locating a line needs edit mode.
+    editArea->openFile(file, p_lineNumber >= 0 ? OpenFileMode::Edit : OpenFileMode::Read);
+
+    VEditTab *tab = editArea->currentEditTab();
+    if (tab && tab->getFile() == file) {
+        tab->scrollToLine(p_lineNumber);
+    }
+}
+
+void VMainWindow::handleTransferJobAdded(VTransferJob *p_job)
+{
+    // Shown only if it takes a while.
+    QProgressDialog *dialog = new QProgressDialog(p_job->getTitle(), tr("Cancel"), 0, 0, this);
+    dialog->setWindowModality(Qt::NonModal);
+    dialog->setWindowTitle(tr("Paste"));
+    dialog->setAutoClose(false);
+    dialog->setAutoReset(false);
+    dialog->setMinimumDuration(500);
+    dialog->setValue(0);
+
+    connect(dialog, &QProgressDialog::canceled,
+            p_job, &VTransferJob::cancel);
+    connect(p_job, &VTransferJob::progress,
+            dialog, [dialog](qint64 p_done, qint64 p_total) {
+                if (p_total > 0) {
+                    dialog->setMaximum(100);
+                    dialog->setValue((int)(p_done * 100 / p_total));
+                }
+            });
+    connect(p_job, &VTransferJob::finished,
+            this, [this, dialog, p_job](bool p_succeed) {
+                dialog->deleteLater();
+                if (p_succeed) {
+                    showStatusMessage(tr("%1 finished").arg(p_job->getTitle()));
+                } else if (p_job->isCancelled()) {
+                    showStatusMessage(tr("%1 cancelled").arg(p_job->getTitle()));
+                }
+            });
+}
+
 void VMainWindow::viewSettings()
 {
     VSettingsDialog settingsDialog(this);
@@ -1583,3 +1703,68 @@ void VMainWindow::handleVimStatusUpdated(const VVim *p_vim)
         m_vimIndicator->show();
     }
 }
+
+void VMainWindow::handleDirectoriesChangedOutside(const QStringList &p_dirs)
+{
+    const QVector<VNotebook *> &notebooks = vnote->getNotebooks();
+    int nrRemoved = 0;
+    for (auto const &path : p_dirs) {
+        VDirectory *dir = NULL;
+        for (auto nb : notebooks) {
+            dir = nb->findOpenedDirectory(path);
+            if (dir) {
+                break;
+            }
+        }
+
+        if (!dir) {
+            continue;
+        }
+
+        QVector<VDirectory *> removedDirs;
+        QVector<VFile *> removedFiles;
+        if (!dir->reloadItems(removedDirs, removedFiles)) {
+            continue;
+        }
+
+        // The removed items are deleted later, so close their tabs now.
+        // Modified tabs prompt to keep their changes.
+        for (auto subDir : removedDirs) {
+            editArea->closeFileRemovedOutside(subDir);
+        }
+
+        for (auto file : removedFiles) {
+            editArea->closeFileRemovedOutside(file);
+        }
+
+        nrRemoved += removedDirs.size() + removedFiles.size();
+
+        directoryTree->updateDirectoryChildren(dir);
+        fileList->updateDirectory(dir);
+    }
+
+    if (nrRemoved > 0) {
+        showStatusMessage(tr("%1 folders and notes removed outside VNote").arg(nrRemoved));
+    }
+}
+
+void VMainWindow::handleFilesChangedOutside(const QStringList &p_files)
+{
+    // Update the search index. Only notes are indexed, which excludes the
+    // configs and images. Notes saved by VNote itself are posted on saving.
+    const QVector<VNotebook *> &notebooks = vnote->getNotebooks();
+    for (auto const &path : p_files) {
+        for (auto nb : notebooks) {
+            if (path.startsWith(QDir::cleanPath(nb->getPath()) + '/')) {
+                VFile *file = nb->tryLoadFile(path);
+                if (file && !file->isWrittenByLastSave()) {
+                    VChangeBus::post(VChange::Updated, nb->getPath(), path);
+                }
+
+                break;
+            }
+        }
+    }
+
+    editArea->checkFilesChangedOutside(p_files);
+}
@@ -31,6 +31,10 @@ class VFindReplaceDialog;
 class VCaptain;
 class VVimIndicator;
 class VTabIndicator;
+class VSearchEngine;
+class VSearchDialog;
+class VTabSearchDialog;
+class VTransferJob;
 
 class VMainWindow : public QMainWindow
 {
@@ -72,6 +76,13 @@ private slots:
     void insertImage();
     void handleFindDialogTextChanged(const QString &p_text, uint p_options);
     void openFindDialog();
+    void openSearchDialog();
+
+    // Search all the opened notes.
+    void openTabSearchDialog();
+
+    // Open @p_filePath at line @p_lineNumber from search result.
+    void openSearchResult(const QString &p_filePath, int p_lineNumber);
     void enableMermaid(bool p_checked);
     void enableMathjax(bool p_checked);
     void handleCaptainModeChanged(bool p_enabled);
@@ -95,6 +106,15 @@ private slots:
     // Handle the status update of the current tab of VEditArea.
     void handleAreaTabStatusUpdated(const VEditTabInfo &p_info);
 
+    // Show the progress of a copy or move job.
+    void handleTransferJobAdded(VTransferJob *p_job);
+
+    // Folders @p_dirs have been changed outside VNote. Reload their items.
+    void handleDirectoriesChangedOutside(const QStringList &p_dirs);
+
+    // Files @p_files have been modified outside VNote.
+    void handleFilesChangedOutside(const QStringList &p_files);
+
 protected:
     void closeEvent(QCloseEvent *event) Q_DECL_OVERRIDE;
     void resizeEvent(QResizeEvent *event) Q_DECL_OVERRIDE;
@@ -162,6 +182,12 @@ private:
     VFindReplaceDialog *m_findReplaceDialog;
     VVimIndicator *m_vimIndicator;
     VTabIndicator *m_tabIndicator;
+    VSearchEngine *m_searchEngine;
+
+    // Created on demand.
+    VSearchDialog *m_searchDialog;
+
+    VTabSearchDialog *m_tabSearchDialog;
 
     // Whether it is one panel or two panles.
     bool m_onePanel;
@@ -187,6 +213,8 @@ private:
     QAction *m_replaceAct;
     QAction *m_replaceFindAct;
     QAction *m_replaceAllAct;
+    QAction *m_searchNotebooksAct;
+    QAction *m_searchOpenedNotesAct;
 
     QAction *m_autoIndentAct;
 
@@ -1,4 +1,5 @@
 #include <QtWidgets>
+#include <algorithm>
 #include "vmdedit.h"
 #include "hgmarkdownhighlighter.h"
 #include "vcodeblockhighlighthelper.h"
@@ -7,24 +8,57 @@
 #include "vconfigmanager.h"
 #include "vtoc.h"
 #include "utils/vutils.h"
+#include "utils/veditutils.h"
 #include "dialog/vselectdialog.h"
 #include "vimagepreviewer.h"
+#include "vdirectory.h"
+#include "vundohistory.h"
 
 extern VConfigManager vconfig;
 extern VNote *g_vnote;
 
 VMdEdit::VMdEdit(VFile *p_file, VDocument *p_vdoc, MarkdownConverterType p_type,
                  QWidget *p_parent)
-    : VEdit(p_file, p_parent), m_mdHighlighter(NULL)
+    : VEdit(p_file, p_parent), m_mdHighlighter(NULL), m_blockCount(1),
+      m_dirtyFirstBlock(-1), m_dirtyLastBlock(-1)
 {
     V_ASSERT(p_file->getDocType() == DocType::Markdown);
 
     setAcceptRichText(false);
+
+    // Use a bounded undo history instead of the unbounded one of QTextDocument.
+    document()->setUndoRedoEnabled(false);
+    m_undoHistory = new VUndoHistory(document(), this);
+    m_undoHistory->setLimits(vconfig.getUndoHistorySteps(),
+                             vconfig.getUndoHistorySize());
+    connect(document(), &QTextDocument::modificationChanged,
+            this, [this](bool p_modified) {
+        if (!p_modified) {
+            m_undoHistory->markClean();
+        }
+    });
+
+    // Without its own undo stack, the document is marked modified after every
+    // edit, including the format-only passes of the highlighter. The history
+    // tells whether the text differs from the saved one.
+    connect(document(), &QTextDocument::contentsChanged,
+            this, [this]() {
+        bool modified = !m_undoHistory->isClean();
+        if (document()->isModified() != modified) {
+            setModified(modified);
+        }
+    });
+
     m_mdHighlighter = new HGMarkdownHighlighter(vconfig.getMdHighlightingStyles(),
                                                 vconfig.getCodeBlockStyles(),
                                                 700, document());
     connect(m_mdHighlighter, &HGMarkdownHighlighter::highlightCompleted,
-            this, &VMdEdit::generateEditOutline);
+            this, [this]() {
+        // Outline is generated on beginning edit and saving in large file mode.
+        if (!m_largeFileMode) {
+            generateEditOutline();
+        }
+    });
 
     // After highlight, the cursor may trun into non-visible. We should make it visible
     // in this case.
@@ -49,6 +83,11 @@ VMdEdit::VMdEdit(VFile *p_file, VDocument *p_vdoc, MarkdownConverterType p_type,
 
     m_imagePreviewer = new VImagePreviewer(this, 500);
 
+    connect(verticalScrollBar(), &QScrollBar::valueChanged,
+            m_imagePreviewer, &VImagePreviewer::viewportScrolled);
+    connect(verticalScrollBar(), &QScrollBar::valueChanged,
+            this, &VMdEdit::updateVisibleBlockRange);
+
     m_editOps = new VMdEditOperations(this, m_file);
 
     connect(m_editOps, &VEditOperations::statusMessage,
@@ -59,10 +98,8 @@ VMdEdit::VMdEdit(VFile *p_file, VDocument *p_vdoc, MarkdownConverterType p_type,
     connect(this, &VMdEdit::cursorPositionChanged,
             this, &VMdEdit::updateCurHeader);
 
-    connect(this, &VMdEdit::selectionChanged,
-            this, &VMdEdit::handleSelectionChanged);
-    connect(QApplication::clipboard(), &QClipboard::changed,
-            this, &VMdEdit::handleClipboardChanged);
+    connect(document(), &QTextDocument::contentsChange,
+            this, &VMdEdit::invalidateHeaders);
 
     updateFontAndPalette();
 
@@ -81,17 +118,19 @@ void VMdEdit::beginEdit()
 
     updateConfig();
 
-    Q_ASSERT(m_file->getContent() == toPlainTextWithoutImg());
+    Q_ASSERT(m_file->getContent() == toRawText());
 
     initInitImages();
 
-    m_imagePreviewer->refresh();
+    if (!m_largeFileMode) {
+        m_imagePreviewer->refresh();
+    }
 
     setReadOnly(false);
     setModified(false);
 
     // Request update outline.
-    generateEditOutline();
+    generateEditOutline(true);
 }
 
 void VMdEdit::endEdit()
@@ -105,16 +144,75 @@ void VMdEdit::saveFile()
     if (!document()->isModified()) {
         return;
     }
-    m_file->setContent(toPlainTextWithoutImg());
+    m_file->setContent(toRawText());
     document()->setModified(false);
+
+    if (m_largeFileMode) {
+        generateEditOutline();
+    }
+}
+
+// Whether @p_content is large enough to be edited in large file mode.
+static bool isLargeContent(const QString &p_content)
+{
+    // Use the number of characters as an approximation of the size.
+    qint64 maxSize = vconfig.getLargeFileSize();
+    if (maxSize > 0 && p_content.size() > maxSize) {
+        return true;
+    }
+
+    int maxLines = vconfig.getLargeFileLines();
+    if (maxLines > 0 && p_content.count('\n') >= maxLines) {
+        return true;
+    }
+
+    return false;
 }
 
 void VMdEdit::reloadFile()
 {
     const QString &content = m_file->getContent();
-    V_ASSERT(content.indexOf(QChar::ObjectReplacementCharacter) == -1);
+
+    // Decide the mode before highlighting the new content.
+    setLargeFileMode(isLargeContent(content));
+
     setPlainText(content);
+    m_undoHistory->reset();
     setModified(false);
+
+    updateVisibleBlockRange();
+}
+
+void VMdEdit::setLargeFileMode(bool p_enabled)
+{
+    if (m_largeFileMode == p_enabled) {
+        return;
+    }
+
+    VEdit::setLargeFileMode(p_enabled);
+
+    m_mdHighlighter->setLargeFileMode(p_enabled);
+
+    if (p_enabled) {
+        m_imagePreviewer->disableImagePreview();
+    } else {
+        m_imagePreviewer->enableImagePreview();
+    }
+
+    qDebug() << "large file mode" << p_enabled << m_file->getName();
+
+    emit statusChanged();
+}
+
+void VMdEdit::updateVisibleBlockRange()
+{
+    if (!m_largeFileMode) {
+        return;
+    }
+
+    int first, last;
+    visibleBlockRange(first, last);
+    m_mdHighlighter->setVisibleBlockRange(first, last);
 }
 
 void VMdEdit::keyPressEvent(QKeyEvent *event)
@@ -193,13 +291,40 @@ void VMdEdit::insertFromMimeData(const QMimeData *source)
     VEdit::insertFromMimeData(source);
 }
 
-void VMdEdit::imageInserted(const QString &p_path)
+void VMdEdit::imageInserted(const QString &p_path, const QImage &p_image)
 {
     ImageLink link;
     link.m_path = p_path;
     link.m_type = ImageLink::LocalRelativeInternal;
 
     m_insertedImages.append(link);
+
+    if (!p_image.isNull()) {
+        m_imagePreviewer->cacheImage(p_path, p_image);
+    }
+}
+
+void VMdEdit::imageSaved(const QString &p_path, const QImage &p_image)
+{
+    m_imagePreviewer->imageSaveFinished(p_path, p_image);
+}
+
+void VMdEdit::imageSaveFailed(const QString &p_path, const QString &p_errStr)
+{
+    for (int i = 0; i < m_insertedImages.size(); ++i) {
+        if (m_insertedImages[i].m_path == p_path) {
+            m_insertedImages.remove(i);
+            break;
+        }
+    }
+
+    m_imagePreviewer->imageSaveFinished(p_path, QImage());
+
+    VUtils::showMessage(QMessageBox::Warning, tr("Warning"),
+                        tr("Fail to save inserted image <span style=\"%1\">%2</span>. "
+                           "Please remove its link and insert it again.")
+                          .arg(vconfig.c_dataTextStyle).arg(p_path),
+                        p_errStr, QMessageBox::Ok, QMessageBox::Ok, this);
 }
 
 void VMdEdit::initInitImages()
@@ -213,79 +338,70 @@ void VMdEdit::clearUnusedImages()
     QVector<ImageLink> images = VUtils::fetchImagesFromMarkdownFile(m_file,
                                                                     ImageLink::LocalRelativeInternal);
 
-    if (!m_insertedImages.isEmpty()) {
-        for (int i = 0; i < m_insertedImages.size(); ++i) {
-            const ImageLink &link = m_insertedImages[i];
-
-            V_ASSERT(link.m_type == ImageLink::LocalRelativeInternal);
+    QSet<QString> usedImages;
+    usedImages.reserve(images.size());
+    for (auto const &link : images) {
+        usedImages.insert(link.m_path);
+    }
 
-            int j;
-            for (j = 0; j < images.size(); ++j) {
-                if (link.m_path == images[j].m_path) {
-                    break;
-                }
-            }
+    // An image may be both in m_initImages and m_insertedImages.
+    QSet<QString> unusedImages;
+    for (auto const &link : m_insertedImages) {
+        V_ASSERT(link.m_type == ImageLink::LocalRelativeInternal);
 
-            // This inserted image is no longer in the file.
-            if (j == images.size()) {
-                if (!QFile(link.m_path).remove()) {
-                    qWarning() << "fail to delete unused inserted image" << link.m_path;
-                } else {
-                    qDebug() << "delete unused inserted image" << link.m_path;
-                }
-            }
+        // This inserted image is no longer in the file.
+        if (!usedImages.contains(link.m_path)) {
+            unusedImages.insert(link.m_path);
         }
-
-        m_insertedImages.clear();
     }
 
-    for (int i = 0; i < m_initImages.size(); ++i) {
-        const ImageLink &link = m_initImages[i];
+    m_insertedImages.clear();
 
+    for (auto const &link : m_initImages) {
         V_ASSERT(link.m_type == ImageLink::LocalRelativeInternal);
 
-        int j;
-        for (j = 0; j < images.size(); ++j) {
-            if (link.m_path == images[j].m_path) {
-                break;
-            }
-        }
-
         // Original local relative image is no longer in the file.
-        if (j == images.size()) {
-            if (!QFile(link.m_path).remove()) {
-                qWarning() << "fail to delete unused original image" << link.m_path;
-            } else {
-                qDebug() << "delete unused original image" << link.m_path;
-            }
+        if (!usedImages.contains(link.m_path)) {
+            unusedImages.insert(link.m_path);
         }
     }
 
     m_initImages.clear();
+
+    // Content-addressed images may be shared with other notes.
+    VDirectory *dir = m_file->getDirectory();
+    if (vconfig.getEnableContentAddressedImages() && !unusedImages.isEmpty() && dir) {
+        unusedImages.subtract(dir->fetchImagesOfNotes(m_file));
+    }
+
+    for (auto const &path : unusedImages) {
+        if (!QFile(path).remove()) {
+            qWarning() << "fail to delete unused image" << path;
+        } else {
+            qDebug() << "delete unused image" << path;
+        }
+    }
 }
 
 int VMdEdit::currentCursorHeader() const
 {
-    if (m_headers.isEmpty()) {
+    if (m_headerIndexes.isEmpty()) {
         return -1;
     }
 
+    // Binary search the last header at or before current line.
     int curLine = textCursor().block().firstLineNumber();
-    int i = 0;
-    for (i = m_headers.size() - 1; i >= 0; --i) {
-        if (!m_headers[i].isEmpty()) {
-            if (m_headers[i].lineNumber <= curLine) {
-                break;
-            }
-        }
-    }
-
-    if (i == -1) {
+    auto it = std::upper_bound(m_headerIndexes.constBegin(), m_headerIndexes.constEnd(), curLine,
+                               [this](int p_line, int p_idx) {
+                                   return p_line < m_headers[p_idx].lineNumber;
+                               });
+    if (it == m_headerIndexes.constBegin()) {
         return -1;
-    } else {
-        Q_ASSERT(m_headers[i].index == i);
-        return i;
     }
+
+    int i = *(it - 1);
+    Q_ASSERT(m_headers[i].index == i);
+    return i;
 }
 
 void VMdEdit::updateCurHeader()
@@ -303,50 +419,150 @@ void VMdEdit::updateCurHeader()
     emit curHeaderChanged(VAnchor(m_file, "", m_headers[idx].lineNumber, m_headers[idx].index));
 }
 
-void VMdEdit::generateEditOutline()
+// Whether the two headers are the same except the line number and index.
+static bool isSameHeader(const VHeader &p_a, const VHeader &p_b)
 {
+    return p_a.level == p_b.level
+           && p_a.name == p_b.name
+           && p_a.isEmpty() == p_b.isEmpty();
+}
+
+void VMdEdit::invalidateHeaders(int p_position, int p_charsRemoved, int p_charsAdded)
+{
+    Q_UNUSED(p_charsRemoved);
     QTextDocument *doc = document();
+    int nrBlocks = doc->blockCount();
+    int first = doc->findBlock(p_position).blockNumber();
+    if (first < 0) {
+        first = nrBlocks - 1;
+    }
 
-    m_headers.clear();
+    int last = doc->findBlock(p_position + p_charsAdded).blockNumber();
+    if (last < 0) {
+        last = nrBlocks - 1;
+    }
 
-    QVector<VHeader> headers;
+    // Blocks [first, last - delta] are replaced by blocks [first, last].
+    int delta = nrBlocks - m_blockCount;
+    m_blockCount = nrBlocks;
+
+    // Drop the headers of the changed blocks and shift the ones after them.
+    QVector<VHeader> shifted;
+    auto it = m_blockHeaders.lowerBound(first);
+    while (it != m_blockHeaders.end()) {
+        if (it.key() > last - delta) {
+            shifted.append(it.value());
+            shifted.last().lineNumber += delta;
+        }
+
+        it = m_blockHeaders.erase(it);
+    }
 
-    // Assume that each block contains only one line
+    for (auto const &header : shifted) {
+        m_blockHeaders.insert(header.lineNumber, header);
+    }
+
+    if (m_dirtyFirstBlock == -1) {
+        m_dirtyFirstBlock = first;
+        m_dirtyLastBlock = last;
+    } else {
+        if (m_dirtyLastBlock > last - delta) {
+            m_dirtyLastBlock += delta;
+        }
+
+        m_dirtyFirstBlock = qMin(m_dirtyFirstBlock, first);
+        m_dirtyLastBlock = qMin(qMax(m_dirtyLastBlock, last), nrBlocks - 1);
+    }
+}
+
+void VMdEdit::generateEditOutline(bool p_force)
+{
+    QTextDocument *doc = document();
+    if (p_force) {
+        m_blockHeaders.clear();
+        m_blockCount = doc->blockCount();
+        m_dirtyFirstBlock = 0;
+        m_dirtyLastBlock = m_blockCount - 1;
+    } else if (m_dirtyFirstBlock == -1) {
+        // Nothing changed since last time.
+        return;
+    }
+
+    // Match the changed blocks only. The highlighter changes the formats of
+    // the blocks whose code block state changes, so they are included too.
+    // Assume that each block contains only one line, so the line number is
+    // the block number.
     // Only support # syntax for now
     QRegExp headerReg("(#{1,6})\\s*(\\S.*)");  // Need to trim the spaces
-    int baseLevel = -1;
-    for (QTextBlock block = doc->begin(); block != doc->end(); block = block.next()) {
+    QTextBlock block = doc->findBlockByNumber(m_dirtyFirstBlock);
+    for (int blockNum = m_dirtyFirstBlock;
+         blockNum <= m_dirtyLastBlock && block.isValid();
+         block = block.next(), ++blockNum) {
         V_ASSERT(block.lineCount() == 1);
-        if ((block.userState() == HighlightBlockState::Normal) &&
-            headerReg.exactMatch(block.text())) {
-            int level = headerReg.cap(1).length();
-            VHeader header(level, headerReg.cap(2).trimmed(),
-                           "", block.firstLineNumber(), headers.size());
-            headers.append(header);
-
-            if (baseLevel == -1) {
-                baseLevel = level;
-            } else if (baseLevel > level) {
-                baseLevel = level;
-            }
+        if (block.userState() == HighlightBlockState::Normal
+            && headerReg.exactMatch(block.text())) {
+            m_blockHeaders.insert(blockNum, VHeader(headerReg.cap(1).length(),
+                                                    headerReg.cap(2).trimmed(),
+                                                    "", blockNum, -1));
+        }
+    }
+
+    m_dirtyFirstBlock = m_dirtyLastBlock = -1;
+
+    int baseLevel = -1;
+    for (auto const &header : m_blockHeaders) {
+        if (baseLevel == -1 || baseLevel > header.level) {
+            baseLevel = header.level;
         }
     }
 
+    QVector<VHeader> outline;
+    outline.reserve(m_blockHeaders.size());
     int curLevel = baseLevel - 1;
-    for (auto & item : headers) {
-        while (item.level > curLevel + 1) {
+    for (auto const &header : m_blockHeaders) {
+        while (header.level > curLevel + 1) {
             curLevel += 1;
 
             // Insert empty level which is an invalid header.
-            m_headers.append(VHeader(curLevel, c_emptyHeaderName, "", -1, m_headers.size()));
+            outline.append(VHeader(curLevel, c_emptyHeaderName, "", -1, outline.size()));
         }
 
-        item.index = m_headers.size();
-        m_headers.append(item);
-        curLevel = item.level;
+        outline.append(header);
+        outline.last().index = outline.size() - 1;
+        curLevel = header.level;
+    }
+
+    // Headers same as the current ones at both ends, except the line numbers.
+    int nrOld = m_headers.size();
+    int nrNew = outline.size();
+    int prefix = 0;
+    while (prefix < nrOld && prefix < nrNew && isSameHeader(m_headers[prefix], outline[prefix])) {
+        ++prefix;
+    }
+
+    int suffix = 0;
+    while (suffix < nrOld - prefix && suffix < nrNew - prefix
+           && isSameHeader(m_headers[nrOld - suffix - 1], outline[nrNew - suffix - 1])) {
+        ++suffix;
     }
 
-    emit headersChanged(m_headers);
+    bool changed = p_force || prefix < nrOld || nrOld != nrNew;
+    for (int i = 0; !changed && i < nrNew; ++i) {
+        changed = m_headers[i].lineNumber != outline[i].lineNumber;
+    }
+
+    if (changed) {
+        m_headers = outline;
+
+        m_headerIndexes.clear();
+        for (auto const &header : m_headers) {
+            if (!header.isEmpty()) {
+                m_headerIndexes.append(header.index);
+            }
+        }
+
+        emit headersChanged(m_headers, p_force ? 0 : prefix, p_force ? 0 : suffix);
+    }
 
     updateCurHeader();
 }
@@ -362,98 +578,88 @@ void VMdEdit::scrollToHeader(const VAnchor &p_anchor)
     scrollToLine(p_anchor.lineNumber);
 }
 
-QString VMdEdit::toPlainTextWithoutImg() const
+void VMdEdit::scrollToFileLine(int p_lineNumber)
 {
-    QString text = toPlainText();
-    int start = 0;
-    do {
-        int index = text.indexOf(QChar::ObjectReplacementCharacter, start);
-        if (index == -1) {
-            break;
-        }
-        start = removeObjectReplacementLine(text, index);
-    } while (start > -1 && start < text.size());
-    return text;
+    QTextBlock block = document()->findBlockByNumber(p_lineNumber);
+    if (!block.isValid()) {
+        return;
+    }
+
+    scrollToLine(block.firstLineNumber());
 }
 
-int VMdEdit::removeObjectReplacementLine(QString &p_text, int p_index) const
+QString VMdEdit::toRawText() const
 {
-    Q_ASSERT(p_text.size() > p_index && p_text.at(p_index) == QChar::ObjectReplacementCharacter);
-    int prevLineIdx = p_text.lastIndexOf('\n', p_index);
-    if (prevLineIdx == -1) {
-        prevLineIdx = 0;
-    }
-    // Remove [\n....?]
-    p_text.remove(prevLineIdx, p_index - prevLineIdx + 1);
-    return prevLineIdx - 1;
+    QTextCursor cursor(document());
+    cursor.movePosition(QTextCursor::End, QTextCursor::KeepAnchor);
+    return VEditUtils::selectedText(cursor);
 }
 
-void VMdEdit::handleSelectionChanged()
+QImage VMdEdit::imageAt(const QPoint &p_pos) const
 {
-    if (!vconfig.getEnablePreviewImages()) {
-        return;
+    QPointF pos(p_pos.x() + horizontalScrollBar()->value(),
+                p_pos.y() + verticalScrollBar()->value());
+    int cursorPos = document()->documentLayout()->hitTest(pos, Qt::FuzzyHit);
+    if (cursorPos < 0) {
+        return QImage();
     }
 
-    QString text = textCursor().selectedText();
-    if (text.isEmpty() && !m_imagePreviewer->isPreviewEnabled()) {
-        m_imagePreviewer->enableImagePreview();
-    } else if (m_imagePreviewer->isPreviewEnabled()) {
-        if (text.trimmed() == QString(QChar::ObjectReplacementCharacter)) {
-            // Select the image and some whitespaces.
-            // We can let the user copy the image.
-            return;
-        } else if (text.contains(QChar::ObjectReplacementCharacter)) {
-            m_imagePreviewer->disableImagePreview();
+    // The preview lies under its block, so check the blocks around.
+    QTextBlock block = document()->findBlock(cursorPos);
+    QTextBlock blocks[] = { block.previous(), block, block.next() };
+    for (auto const &blk : blocks) {
+        if (blk.isValid() && m_imagePreviewer->previewRect(blk).contains(pos)) {
+            return m_imagePreviewer->previewImage(blk);
         }
     }
+
+    return QImage();
 }
 
-void VMdEdit::handleClipboardChanged(QClipboard::Mode p_mode)
+void VMdEdit::paintEvent(QPaintEvent *p_event)
 {
-    if (!hasFocus()) {
-        return;
-    }
-    if (p_mode == QClipboard::Clipboard) {
-        QClipboard *clipboard = QApplication::clipboard();
-        const QMimeData *mimeData = clipboard->mimeData();
-        if (mimeData->hasText()) {
-            QString text = mimeData->text();
-            if (clipboard->ownsClipboard() &&
-                (text.trimmed() == QString(QChar::ObjectReplacementCharacter))) {
-                QImage image = selectedImage();
-                clipboard->clear(QClipboard::Clipboard);
-                if (!image.isNull()) {
-                    clipboard->setImage(image, QClipboard::Clipboard);
-                }
-            }
+    VEdit::paintEvent(p_event);
+
+    // Paint the image previews in the space reserved under their blocks.
+    QPainter painter(viewport());
+    QRect rect = p_event->rect();
+    QPointF offset(-horizontalScrollBar()->value(), -verticalScrollBar()->value());
+
+    int first, last;
+    visibleBlockRange(first, last);
+
+    // The preview of the block above may reach into the viewport.
+    QTextBlock block = document()->findBlockByNumber(qMax(first - 1, 0));
+    for (; block.isValid() && block.blockNumber() <= last; block = block.next()) {
+        QRectF imgRect = m_imagePreviewer->previewRect(block).translated(offset);
+        if (!imgRect.isEmpty() && imgRect.intersects(rect)) {
+            painter.drawPixmap(imgRect.topLeft(), m_imagePreviewer->previewPixmap(block));
         }
     }
 }
 
-QImage VMdEdit::selectedImage()
+void VMdEdit::contextMenuEvent(QContextMenuEvent *p_event)
 {
-    QImage image;
-    QTextCursor cursor = textCursor();
-    if (!cursor.hasSelection()) {
-        return image;
+    QImage image = imageAt(p_event->pos());
+    if (image.isNull()) {
+        VEdit::contextMenuEvent(p_event);
+        return;
     }
-    int start = cursor.selectionStart();
-    int end = cursor.selectionEnd();
-    QTextDocument *doc = document();
-    QTextBlock startBlock = doc->findBlock(start);
-    QTextBlock endBlock = doc->findBlock(end);
-    QTextBlock block = startBlock;
-    while (block.isValid()) {
-        if (m_imagePreviewer->isImagePreviewBlock(block)) {
-            image = m_imagePreviewer->fetchCachedImageFromPreviewBlock(block);
-            break;
-        }
-        if (block == endBlock) {
-            break;
-        }
-        block = block.next();
+
+    // Let the user copy the previewed image.
+    QMenu menu(this);
+    QAction *copyAct = menu.addAction(tr("&Copy Image"));
+    if (menu.exec(p_event->globalPos()) == copyAct) {
+        QApplication::clipboard()->setImage(image, QClipboard::Clipboard);
     }
-    return image;
+}
+
+QMimeData *VMdEdit::createMimeDataFromSelection() const
+{
+    // Copy plain text only, without the margins reserved for the previews.
+    QMimeData *data = new QMimeData();
+    data->setText(VEditUtils::selectedText(textCursor()));
+    return data;
 }
 
 void VMdEdit::resizeEvent(QResizeEvent *p_event)
@@ -461,6 +667,8 @@ void VMdEdit::resizeEvent(QResizeEvent *p_event)
     m_imagePreviewer->update();
 
     VEdit::resizeEvent(p_event);
+
+    updateVisibleBlockRange();
 }
 
 const QVector<VHeader> &VMdEdit::getHeaders() const
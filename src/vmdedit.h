@@ -3,9 +3,9 @@
 
 #include "vedit.h"
 #include <QVector>
+#include <QMap>
 #include <QString>
 #include <QColor>
-#include <QClipboard>
 #include <QImage>
 #include "vtoc.h"
 #include "veditoperations.h"
@@ -30,20 +30,37 @@ public:
 
     // An image has been inserted. The image is relative.
     // @p_path is the absolute path of the inserted image.
-    void imageInserted(const QString &p_path);
+    // @p_image is the image to preview if it is not saved yet.
+    void imageInserted(const QString &p_path, const QImage &p_image = QImage());
+
+    // Inserted image @p_path has been saved in background.
+    // @p_image is the decoded image to preview.
+    void imageSaved(const QString &p_path, const QImage &p_image);
+
+    // Fail to save inserted image @p_path in background.
+    void imageSaveFailed(const QString &p_path, const QString &p_errStr);
 
     void scrollToHeader(const VAnchor &p_anchor);
 
-    // Like toPlainText(), but remove special blocks containing images.
-    QString toPlainTextWithoutImg() const;
+    // Scroll to line @p_lineNumber of the file, which is a block number.
+    void scrollToFileLine(int p_lineNumber);
+
+    // Like toPlainText(), but keep non-breaking spaces, so it is identical
+    // to the file content.
+    QString toRawText() const;
 
     const QVector<VHeader> &getHeaders() const;
 
+    // Disable image preview and highlight only the text around the viewport.
+    void setLargeFileMode(bool p_enabled) Q_DECL_OVERRIDE;
+
 public slots:
     bool jumpTitle(bool p_forward, int p_relativeLevel, int p_repeat) Q_DECL_OVERRIDE;
 
 signals:
-    void headersChanged(const QVector<VHeader> &headers);
+    // The first @p_samePrefix and the last @p_sameSuffix headers of
+    // @p_headers are the same as the previous ones except the line numbers.
+    void headersChanged(const QVector<VHeader> &p_headers, int p_samePrefix, int p_sameSuffix);
 
     // Signal when current header change.
     void curHeaderChanged(VAnchor p_anchor);
@@ -53,13 +70,18 @@ signals:
     void statusChanged();
 
 private slots:
-    void generateEditOutline();
+    // Generate the outline and signal headersChanged() if it changes.
+    // @p_force: signal headersChanged() anyway.
+    void generateEditOutline(bool p_force = false);
+
+    // Drop the cached headers of the changed blocks and mark them dirty.
+    void invalidateHeaders(int p_position, int p_charsRemoved, int p_charsAdded);
 
     // When there is no header in current cursor, will signal an invalid header.
     void updateCurHeader();
 
-    void handleSelectionChanged();
-    void handleClipboardChanged(QClipboard::Mode p_mode);
+    // Tell the highlighter the visible blocks in large file mode.
+    void updateVisibleBlockRange();
 
 protected:
     void keyPressEvent(QKeyEvent *event) Q_DECL_OVERRIDE;
@@ -68,17 +90,20 @@ protected:
     void updateFontAndPalette() Q_DECL_OVERRIDE;
     void resizeEvent(QResizeEvent *p_event) Q_DECL_OVERRIDE;
 
+    // Paint the image previews above the text.
+    void paintEvent(QPaintEvent *p_event) Q_DECL_OVERRIDE;
+
+    // Offer to copy the image if right clicking on a preview.
+    void contextMenuEvent(QContextMenuEvent *p_event) Q_DECL_OVERRIDE;
+
+    QMimeData *createMimeDataFromSelection() const Q_DECL_OVERRIDE;
+
 private:
     void initInitImages();
     void clearUnusedImages();
 
-    // p_text[p_index] is QChar::ObjectReplacementCharacter. Remove the line containing it.
-    // Returns the index of previous line's '\n'.
-    int removeObjectReplacementLine(QString &p_text, int p_index) const;
-
-    // There is a QChar::ObjectReplacementCharacter in the selection.
-    // Get the QImage.
-    QImage selectedImage();
+    // Get the previewed image at @p_pos of the viewport.
+    QImage imageAt(const QPoint &p_pos) const;
 
     // Return the header index in m_headers where current cursor locates.
     int currentCursorHeader() const;
@@ -94,6 +119,20 @@ private:
     QVector<ImageLink> m_initImages;
 
     QVector<VHeader> m_headers;
+
+    // Indexes in m_headers of the non-empty headers, sorted by line number.
+    QVector<int> m_headerIndexes;
+
+    // Block number -> header of the block, for the blocks which are headers.
+    // Only the dirty blocks are matched again when generating outline.
+    QMap<int, VHeader> m_blockHeaders;
+
+    // Block count of the document when m_blockHeaders is updated.
+    int m_blockCount;
+
+    // Range of the blocks changed since last outline generation. -1 if none.
+    int m_dirtyFirstBlock;
+    int m_dirtyLastBlock;
 };
 
 #endif // VMDEDIT_H
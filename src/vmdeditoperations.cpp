@@ -23,6 +23,7 @@
 #include "vconfigmanager.h"
 #include "utils/vvim.h"
 #include "utils/veditutils.h"
+#include "vimagesaver.h"
 
 extern VConfigManager vconfig;
 
@@ -31,6 +32,9 @@ const QString VMdEditOperations::c_defaultImageTitle = "image";
 VMdEditOperations::VMdEditOperations(VEdit *p_editor, VFile *p_file)
     : VEditOperations(p_editor, p_file), m_autoIndentPos(-1)
 {
+    m_imageSaver = new VImageSaver(this);
+    connect(m_imageSaver, &VImageSaver::imageSaved,
+            this, &VMdEditOperations::handleImageSaved);
 }
 
 bool VMdEditOperations::insertImageFromMimeData(const QMimeData *source)
@@ -52,81 +56,149 @@ bool VMdEditOperations::insertImageFromMimeData(const QMimeData *source)
 void VMdEditOperations::insertImageFromQImage(const QString &title, const QString &path,
                                               const QImage &image)
 {
-    QString fileName = VUtils::generateImageFileName(path, title);
-    QString filePath = QDir(path).filePath(fileName);
-    V_ASSERT(!QFile(filePath).exists());
-
-    QString errStr;
-    bool ret = VUtils::makePath(path);
-    if (!ret) {
-        errStr = tr("Fail to create image folder <span style=\"%1\">%2</span>.")
-                   .arg(vconfig.c_dataTextStyle).arg(path);
-    } else {
-        ret = image.save(filePath);
-        if (!ret) {
-            errStr = tr("Fail to save image <span style=\"%1\">%2</span>.")
-                       .arg(vconfig.c_dataTextStyle).arg(filePath);
-        }
-    }
-
-    if (!ret) {
-        VUtils::showMessage(QMessageBox::Warning, tr("Warning"),
-                            tr("Fail to insert image <span style=\"%1\">%2</span>.").arg(vconfig.c_dataTextStyle).arg(title),
-                            errStr,
-                            QMessageBox::Ok,
-                            QMessageBox::Ok,
-                            (QWidget *)m_editor);
+    if (vconfig.getEnableContentAddressedImages()) {
+        // The name depends on the encoded data.
+        insertContentAddressedImage(title, path, image, QString());
         return;
     }
 
-    QString md = QString("![%1](%2/%3)").arg(title).arg(VUtils::directoryNameFromPath(path)).arg(fileName);
-    insertTextAtCurPos(md);
+    // Insert the link and preview at once and encode the image in background.
+    const QString &format = vconfig.getImageFormat();
+    QString fileName = VUtils::generateImageFileName(path, title, format);
+    QString filePath = QDir(path).filePath(fileName);
+    V_ASSERT(!QFile(filePath).exists());
 
-    qDebug() << "insert image" << title << filePath;
+    PendingImage pending;
+    pending.m_title = title;
+    pending.m_linkInserted = true;
 
-    VMdEdit *mdEditor = dynamic_cast<VMdEdit *>(m_editor);
-    Q_ASSERT(mdEditor);
-    mdEditor->imageInserted(filePath);
+    int id = m_imageSaver->saveImage(image, path, fileName, format, vconfig.getImageQuality());
+    m_pendingImages.insert(id, pending);
+
+    insertImageLink(title, filePath, NULL, image);
 }
 
 void VMdEditOperations::insertImageFromPath(const QString &title,
                                             const QString &path, const QString &oriImagePath)
 {
+    if (vconfig.getEnableContentAddressedImages()) {
+        insertContentAddressedImage(title, path, QImage(), oriImagePath);
+        return;
+    }
+
     QString fileName = VUtils::generateImageFileName(path, title, QFileInfo(oriImagePath).suffix());
     QString filePath = QDir(path).filePath(fileName);
     V_ASSERT(!QFile(filePath).exists());
 
-    QString errStr;
-    bool ret = VUtils::makePath(path);
-    if (!ret) {
-        errStr = tr("Fail to create image folder <span style=\"%1\">%2</span>.")
-                   .arg(vconfig.c_dataTextStyle).arg(path);
+    PendingImage pending;
+    pending.m_title = title;
+    pending.m_linkInserted = true;
+
+    int id = m_imageSaver->copyImage(oriImagePath, path, fileName);
+    m_pendingImages.insert(id, pending);
+
+    // The image is decoded in background and previewed once it is saved.
+    insertImageLink(title, filePath);
+}
+
+void VMdEditOperations::insertContentAddressedImage(const QString &p_title, const QString &p_path,
+                                                    const QImage &p_image, const QString &p_srcPath)
+{
+    PendingImage pending;
+    pending.m_title = p_title;
+    pending.m_cursor = m_editor->textCursor();
+
+    // Name the file by the hash of its content.
+    int id;
+    if (p_srcPath.isEmpty()) {
+        id = m_imageSaver->saveImage(p_image, p_path, QString(),
+                                     vconfig.getImageFormat(), vconfig.getImageQuality());
     } else {
-        ret = QFile::copy(oriImagePath, filePath);
-        if (!ret) {
-            errStr = tr("Fail to copy image <span style=\"%1\">%2</span>.")
-                       .arg(vconfig.c_dataTextStyle).arg(filePath);
+        id = m_imageSaver->copyImage(p_srcPath, p_path, QString());
+    }
+
+    m_pendingImages.insert(id, pending);
+
+    emit statusMessage(tr("Saving image %1...").arg(p_title));
+}
+
+void VMdEditOperations::handleImageSaved(int p_id, const QString &p_filePath,
+                                         const QString &p_errStr, const QImage &p_image)
+{
+    auto it = m_pendingImages.find(p_id);
+    if (it == m_pendingImages.end()) {
+        return;
+    }
+
+    PendingImage pending = it.value();
+    m_pendingImages.erase(it);
+
+    VMdEdit *mdEditor = dynamic_cast<VMdEdit *>(m_editor);
+    Q_ASSERT(mdEditor);
+    if (pending.m_linkInserted) {
+        if (!p_errStr.isEmpty()) {
+            mdEditor->imageSaveFailed(p_filePath, p_errStr);
+        } else {
+            qDebug() << "image saved" << p_filePath;
+            mdEditor->imageSaved(p_filePath, p_image);
         }
+
+        return;
     }
 
-    if (!ret) {
-        VUtils::showMessage(QMessageBox::Warning, tr("Warning"),
-                            tr("Fail to insert image <span style=\"%1\">%2</span>.").arg(vconfig.c_dataTextStyle).arg(title),
-                            errStr,
-                            QMessageBox::Ok,
-                            QMessageBox::Ok,
-                            (QWidget *)m_editor);
+    if (!p_errStr.isEmpty()) {
+        showInsertImageError(pending.m_title, p_errStr);
         return;
     }
 
-    QString md = QString("![%1](%2/%3)").arg(title).arg(VUtils::directoryNameFromPath(path)).arg(fileName);
-    insertTextAtCurPos(md);
+    if (m_editor->isReadOnly()) {
+        qWarning() << "editor is read-only after saving image" << p_filePath;
+        emit statusMessage(tr("Image %1 is not inserted since the note is not in edit mode")
+                             .arg(p_filePath));
+        return;
+    }
 
-    qDebug() << "insert image" << title << filePath;
+    // If cursor does not move, insert it at current cursor.
+    if (pending.m_cursor.position() == m_editor->textCursor().position()) {
+        insertImageLink(pending.m_title, p_filePath);
+    } else {
+        insertImageLink(pending.m_title, p_filePath, &pending.m_cursor);
+    }
+
+    mdEditor->imageSaved(p_filePath, p_image);
+
+    emit statusMessage(tr("Image %1 inserted").arg(pending.m_title));
+}
+
+void VMdEditOperations::insertImageLink(const QString &p_title, const QString &p_filePath,
+                                        QTextCursor *p_cursor, const QImage &p_image)
+{
+    QString md = QString("![%1](%2/%3)").arg(p_title)
+                                        .arg(VUtils::directoryNameFromPath(VUtils::basePathFromPath(p_filePath)))
+                                        .arg(VUtils::fileNameFromPath(p_filePath));
 
     VMdEdit *mdEditor = dynamic_cast<VMdEdit *>(m_editor);
     Q_ASSERT(mdEditor);
-    mdEditor->imageInserted(filePath);
+    mdEditor->imageInserted(p_filePath, p_image);
+
+    if (p_cursor) {
+        p_cursor->insertText(md);
+    } else {
+        insertTextAtCurPos(md);
+    }
+
+    qDebug() << "insert image" << p_title << p_filePath;
+}
+
+void VMdEditOperations::showInsertImageError(const QString &p_title, const QString &p_errStr)
+{
+    VUtils::showMessage(QMessageBox::Warning, tr("Warning"),
+                        tr("Fail to insert image <span style=\"%1\">%2</span>.")
+                          .arg(vconfig.c_dataTextStyle).arg(p_title),
+                        p_errStr,
+                        QMessageBox::Ok,
+                        QMessageBox::Ok,
+                        (QWidget *)m_editor);
 }
 
 bool VMdEditOperations::insertImageFromURL(const QUrl &imageUrl)
@@ -6,9 +6,12 @@
 #include <QUrl>
 #include <QImage>
 #include <QTextBlock>
+#include <QTextCursor>
+#include <QHash>
 #include "veditoperations.h"
 
 class QTimer;
+class VImageSaver;
 
 // Editor operations for Markdown
 class VMdEditOperations : public VEditOperations
@@ -21,7 +24,29 @@ public:
     bool handleKeyPressEvent(QKeyEvent *p_event) Q_DECL_OVERRIDE;
     bool insertImageFromURL(const QUrl &p_imageUrl) Q_DECL_OVERRIDE;
 
+private slots:
+    // Image of request @p_id has been saved in background.
+    void handleImageSaved(int p_id, const QString &p_filePath, const QString &p_errStr,
+                          const QImage &p_image);
+
 private:
+    // Image being saved in background.
+    struct PendingImage
+    {
+        PendingImage() : m_linkInserted(false)
+        {
+        }
+
+        QString m_title;
+
+        // Whether the link has been inserted before saving.
+        bool m_linkInserted;
+
+        // Insert the link at this cursor once the image is saved if the link
+        // has not been inserted.
+        QTextCursor m_cursor;
+    };
+
     void insertImageFromPath(const QString &title, const QString &path, const QString &oriImagePath);
 
     // @title: title of the inserted image;
@@ -29,6 +54,21 @@ private:
     // @image: the image to be inserted;
     void insertImageFromQImage(const QString &title, const QString &path, const QImage &image);
 
+    // Save a content-addressed image in background and insert the link
+    // after it is saved.
+    // @p_srcPath: the image file to copy. If empty, @p_image will be encoded.
+    void insertContentAddressedImage(const QString &p_title, const QString &p_path,
+                                     const QImage &p_image, const QString &p_srcPath);
+
+    // Insert the link of image @p_filePath at @p_cursor, or current cursor
+    // if @p_cursor is NULL.
+    // @p_image: the image to preview if it is not saved yet.
+    void insertImageLink(const QString &p_title, const QString &p_filePath,
+                         QTextCursor *p_cursor = NULL,
+                         const QImage &p_image = QImage());
+
+    void showInsertImageError(const QString &p_title, const QString &p_errStr);
+
     // Key press handlers.
     bool handleKeyTab(QKeyEvent *p_event);
     bool handleKeyBackTab(QKeyEvent *p_event);
@@ -50,6 +90,11 @@ private:
     // It will be -1 if last key press do not trigger the auto indent or auto list.
     int m_autoIndentPos;
 
+    VImageSaver *m_imageSaver;
+
+    // Requests of saving images in background.
+    QHash<int, PendingImage> m_pendingImages;
+
     static const QString c_defaultImageTitle;
 };
 
@@ -56,6 +56,8 @@ void VMdTab::setupUI()
                 this, &VMdTab::handleTextChanged);
         connect(m_editor, &VEdit::cursorPositionChanged,
                 this, &VMdTab::updateStatus);
+        connect(m_editor, &VEdit::searchMatchesChanged,
+                this, &VMdTab::updateStatus);
         connect(m_editor, &VEdit::saveAndRead,
                 this, &VMdTab::saveAndRead);
         connect(m_editor, &VEdit::discardAndRead,
@@ -415,7 +417,8 @@ void VMdTab::updateTocFromHtml(const QString &p_tocHtml)
     emit outlineChanged(m_toc);
 }
 
-void VMdTab::updateTocFromHeaders(const QVector<VHeader> &p_headers)
+void VMdTab::updateTocFromHeaders(const QVector<VHeader> &p_headers, int p_samePrefix,
+                                  int p_sameSuffix)
 {
     if (!m_isEditMode) {
         return;
@@ -425,12 +428,17 @@ void VMdTab::updateTocFromHeaders(const QVector<VHeader> &p_headers)
     m_toc.headers = p_headers;
     m_toc.m_file = m_file;
     m_toc.valid = true;
+    m_toc.m_samePrefix = p_samePrefix;
+    m_toc.m_sameSuffix = p_sameSuffix;
 
     // Clear current header.
     m_curHeader = VAnchor(m_file, "", -1, -1);
     emit curHeaderChanged(m_curHeader);
 
     emit outlineChanged(m_toc);
+
+    // Only valid against the outline right before.
+    m_toc.m_samePrefix = m_toc.m_sameSuffix = 0;
 }
 
 void VMdTab::scrollToAnchor(const VAnchor &p_anchor)
@@ -450,6 +458,23 @@ void VMdTab::scrollToAnchor(const VAnchor &p_anchor)
     }
 }
 
+void VMdTab::scrollToLine(int p_lineNumber)
+{
+    if (p_lineNumber < 0) {
+        return;
+    }
+
+    // Read mode could not locate a line.
+    if (!m_isEditMode) {
+        editFile();
+        if (!m_isEditMode) {
+            return;
+        }
+    }
+
+    dynamic_cast<VMdEdit *>(m_editor)->scrollToFileLine(p_lineNumber);
+}
+
 void VMdTab::updateCurHeader(const QString &p_anchor)
 {
     if (m_isEditMode || m_curHeader.anchor.mid(1) == p_anchor) {
@@ -554,6 +579,15 @@ QString VMdTab::getSelectedText() const
     }
 }
 
+QString VMdTab::getContent() const
+{
+    if (m_isEditMode && m_editor) {
+        return dynamic_cast<VMdEdit *>(m_editor)->toRawText();
+    }
+
+    return m_file->getContent();
+}
+
 void VMdTab::clearSearchedWordHighlight()
 {
     if (m_webViewer) {
@@ -652,6 +686,22 @@ void VMdTab::requestUpdateVimStatus()
     }
 }
 
+void VMdTab::reloadContent()
+{
+    if (m_editor) {
+        m_editor->reloadFile();
+        if (m_isEditMode) {
+            m_editor->beginEdit();
+        }
+    }
+
+    if (!m_isEditMode) {
+        showFileReadMode();
+    }
+
+    updateStatus();
+}
+
 VEditTabInfo VMdTab::createEditTabInfo()
 {
     VEditTabInfo info = VEditTab::createEditTabInfo();
@@ -661,6 +711,9 @@ VEditTabInfo VMdTab::createEditTabInfo()
         info.m_cursorBlockNumber = cursor.block().blockNumber();
         info.m_cursorPositionInBlock = cursor.positionInBlock();
         info.m_blockCount = m_editor->document()->blockCount();
+        info.m_largeFile = m_editor->isLargeFileMode();
+        m_editor->getSearchMatchInfo(info.m_searchMatchIndex, info.m_searchMatchCount);
+        m_editor->getUndoInfo(info.m_undoSteps, info.m_undoBytes);
     }
 
     return info;
@@ -34,6 +34,9 @@ public:
     // Scroll to anchor @p_anchor.
     void scrollToAnchor(const VAnchor& p_anchor) Q_DECL_OVERRIDE;
 
+    // Scroll to line @p_lineNumber of the file.
+    void scrollToLine(int p_lineNumber) Q_DECL_OVERRIDE;
+
     void insertImage() Q_DECL_OVERRIDE;
 
     // Search @p_text in current note.
@@ -49,6 +52,8 @@ public:
 
     QString getSelectedText() const Q_DECL_OVERRIDE;
 
+    QString getContent() const Q_DECL_OVERRIDE;
+
     void clearSearchedWordHighlight() Q_DECL_OVERRIDE;
 
     VWebView *getWebViewer() const;
@@ -57,6 +62,8 @@ public:
 
     void requestUpdateVimStatus() Q_DECL_OVERRIDE;
 
+    void reloadContent() Q_DECL_OVERRIDE;
+
 public slots:
     // Enter edit mode.
     void editFile() Q_DECL_OVERRIDE;
@@ -69,7 +76,10 @@ private slots:
     void updateTocFromHtml(const QString &p_tocHtml);
 
     // Update m_toc accroding to @p_headers for edit mode.
-    void updateTocFromHeaders(const QVector<VHeader> &p_headers);
+    // @p_samePrefix, @p_sameSuffix: number of headers at both ends which are
+    // the same as the previous ones.
+    void updateTocFromHeaders(const QVector<VHeader> &p_headers, int p_samePrefix,
+                              int p_sameSuffix);
 
     // Web viewer requests to update current header.
     void updateCurHeader(const QString &p_anchor);
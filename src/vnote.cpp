@@ -12,6 +12,9 @@
 #include "vconfigmanager.h"
 #include "vmainwindow.h"
 #include "vorphanfile.h"
+#include "vchangebus.h"
+#include "vtransferengine.h"
+#include "vfilewatcher.h"
 
 extern VConfigManager vconfig;
 
@@ -51,6 +54,9 @@ const QString VNote::c_shortcutsDocFile_zh = ":/resources/docs/shortcuts_zh.md";
 VNote::VNote(QObject *parent)
     : QObject(parent), m_mainWindow(dynamic_cast<VMainWindow *>(parent))
 {
+    m_changeBus = new VChangeBus(this);
+    m_transferEngine = new VTransferEngine(this);
+    m_fileWatcher = new VFileWatcher(this);
     initTemplate();
     vconfig.getNotebooks(m_notebooks, this);
 }
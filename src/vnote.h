@@ -15,6 +15,9 @@
 
 class VMainWindow;
 class VFile;
+class VChangeBus;
+class VTransferEngine;
+class VFileWatcher;
 
 class VNote : public QObject
 {
@@ -77,6 +80,15 @@ public:
     // Given the path of an external file, create a VFile struct.
     VFile *getOrphanFile(const QString &p_path);
 
+    // Bus to publish changes of notes.
+    inline VChangeBus *getChangeBus() const;
+
+    // Engine to copy or move notes and folders in background.
+    inline VTransferEngine *getTransferEngine() const;
+
+    // Watcher of the changes of opened folders and notes made outside VNote.
+    inline VFileWatcher *getFileWatcher() const;
+
 public slots:
     void updateTemplate();
 
@@ -91,6 +103,12 @@ private:
     // Hold all external file: Orphan File.
     // Need to clean up periodly.
     QList<VFile *> m_externalFiles;
+
+    VChangeBus *m_changeBus;
+
+    VTransferEngine *m_transferEngine;
+
+    VFileWatcher *m_fileWatcher;
 };
 
 inline const QVector<QPair<QString, QString> >& VNote::getPalette() const
@@ -103,4 +121,19 @@ inline VMainWindow *VNote::getMainWindow() const
     return m_mainWindow;
 }
 
+inline VChangeBus *VNote::getChangeBus() const
+{
+    return m_changeBus;
+}
+
+inline VTransferEngine *VNote::getTransferEngine() const
+{
+    return m_transferEngine;
+}
+
+inline VFileWatcher *VNote::getFileWatcher() const
+{
+    return m_fileWatcher;
+}
+
 #endif // VNOTE_H
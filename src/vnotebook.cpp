@@ -5,11 +5,12 @@
 #include "utils/vutils.h"
 #include "vconfigmanager.h"
 #include "vfile.h"
+#include "vnotebookcache.h"
 
 extern VConfigManager vconfig;
 
 VNotebook::VNotebook(const QString &name, const QString &path, QObject *parent)
-    : QObject(parent), m_name(name)
+    : QObject(parent), m_name(name), m_cache(NULL)
 {
     m_path = QDir::cleanPath(path);
     m_rootDir = new VDirectory(this, VUtils::directoryNameFromPath(path));
@@ -95,6 +96,19 @@ QString VNotebook::getPath() const
 void VNotebook::close()
 {
     m_rootDir->close();
+
+    if (m_cache) {
+        m_cache->save();
+    }
+}
+
+VNotebookCache *VNotebook::getCache()
+{
+    if (!m_cache) {
+        m_cache = new VNotebookCache(m_path, this);
+    }
+
+    return m_cache;
 }
 
 bool VNotebook::open()
@@ -158,6 +172,7 @@ bool VNotebook::deleteNotebook(VNotebook *p_notebook, bool p_deleteFiles)
         }
 
         // If it is now an empty directory, delete it.
+        VConfigManager::flushDirectoryConfigs();
         QDir dir(p_notebook->getPath());
         dir.cdUp();
         if (!dir.rmdir(rootDir->getName())) {
@@ -167,6 +182,8 @@ bool VNotebook::deleteNotebook(VNotebook *p_notebook, bool p_deleteFiles)
     }
 
 exit:
+    // The cache is useless once the notebook is removed.
+    p_notebook->getCache()->clear();
     p_notebook->close();
     delete p_notebook;
 
@@ -187,6 +204,82 @@ bool VNotebook::containsFile(const VFile *p_file) const
     return m_rootDir->containsFile(p_file);
 }
 
+VFile *VNotebook::tryLoadFile(const QString &p_path)
+{
+    QString relativePath = QDir(m_path).relativeFilePath(QDir::cleanPath(p_path));
+    if (relativePath.startsWith("..") || QDir::isAbsolutePath(relativePath)) {
+        return NULL;
+    }
+
+    QStringList names = relativePath.split('/', QString::SkipEmptyParts);
+    if (names.isEmpty()) {
+        return NULL;
+    }
+
+    VDirectory *dir = m_rootDir;
+    for (int i = 0; i < names.size() - 1 && dir; ++i) {
+        dir = dir->findSubDirectory(names[i]);
+    }
+
+    return dir ? dir->findFile(names.last()) : NULL;
+}
+
+VDirectory *VNotebook::tryLoadDirectory(const QString &p_path)
+{
+    QString relativePath = QDir(m_path).relativeFilePath(QDir::cleanPath(p_path));
+    if (relativePath.startsWith("..") || QDir::isAbsolutePath(relativePath)) {
+        return NULL;
+    }
+
+    QStringList names = relativePath.split('/', QString::SkipEmptyParts);
+    names.removeAll(".");
+
+    VDirectory *dir = m_rootDir;
+    if (!dir->open()) {
+        return NULL;
+    }
+
+    for (int i = 0; i < names.size() && dir; ++i) {
+        dir = dir->findSubDirectory(names[i]);
+    }
+
+    return dir;
+}
+
+VDirectory *VNotebook::findOpenedDirectory(const QString &p_path)
+{
+    QString relativePath = QDir(m_path).relativeFilePath(QDir::cleanPath(p_path));
+    if (relativePath.startsWith("..") || QDir::isAbsolutePath(relativePath)) {
+        return NULL;
+    }
+
+    QStringList names = relativePath.split('/', QString::SkipEmptyParts);
+    names.removeAll(".");
+
+    VDirectory *dir = m_rootDir;
+    for (auto const &name : names) {
+        if (!dir->isOpened()) {
+            return NULL;
+        }
+
+        VDirectory *subDir = NULL;
+        for (auto sub : dir->getSubDirs()) {
+            if (sub->getName() == name) {
+                subDir = sub;
+                break;
+            }
+        }
+
+        if (!subDir) {
+            return NULL;
+        }
+
+        dir = subDir;
+    }
+
+    return dir->isOpened() ? dir : NULL;
+}
+
 const QString &VNotebook::getImageFolder() const
 {
     if (m_imageFolder.isEmpty()) {
@@ -6,6 +6,7 @@
 
 class VDirectory;
 class VFile;
+class VNotebookCache;
 
 class VNotebook : public QObject
 {
@@ -23,9 +24,27 @@ public:
 
     bool containsFile(const VFile *p_file) const;
 
+    // Try to find the VFile of absolute path @p_path within this notebook,
+    // opening the directories on the path if needed.
+    // Returns NULL if it is not a note of this notebook.
+    VFile *tryLoadFile(const QString &p_path);
+
+    // Try to find the VDirectory of absolute path @p_path within this notebook,
+    // opening the directories on the path if needed.
+    // Returns NULL if it is not a folder of this notebook.
+    VDirectory *tryLoadDirectory(const QString &p_path);
+
+    // Find the opened VDirectory of absolute path @p_path within this
+    // notebook without opening any directory.
+    // Returns NULL if it is not found or not opened.
+    VDirectory *findOpenedDirectory(const QString &p_path);
+
     QString getName() const;
     QString getPath() const;
     inline VDirectory *getRootDir();
+
+    // Get the cache of the directory hierarchy. Created on first use.
+    VNotebookCache *getCache();
     void rename(const QString &p_name);
 
     static VNotebook *createNotebook(const QString &p_name, const QString &p_path,
@@ -74,6 +93,9 @@ private:
 
     // Parent is NULL for root directory
     VDirectory *m_rootDir;
+
+    // Cache of the directory hierarchy.
+    VNotebookCache *m_cache;
 };
 
 inline VDirectory *VNotebook::getRootDir()
@@ -0,0 +1,242 @@
+#include "vnotebookcache.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QDateTime>
+#include <QTimer>
+#include <QCryptographicHash>
+#include <QDebug>
+#include "vconfigmanager.h"
+#include "utils/vutils.h"
+
+extern VConfigManager vconfig;
+
+const quint32 VNotebookCache::c_magic = 0x564e4348;
+
+const quint32 VNotebookCache::c_version = 2;
+
+// Coarsest modified time granularity of the file systems, such as FAT.
+static const qint64 c_mtimeGranularity = 2000;
+
+VNotebookCache::VNotebookCache(const QString &p_notebookPath, QObject *p_parent)
+    : QObject(p_parent), m_notebookPath(QDir::cleanPath(p_notebookPath)),
+      m_loaded(false), m_dirty(false)
+{
+    QByteArray hash = QCryptographicHash::hash(m_notebookPath.toUtf8(),
+                                               QCryptographicHash::Md5).toHex();
+    m_cacheFile = QDir(vconfig.getConfigFolder()).filePath("notebook_cache/"
+                                                           + QString::fromLatin1(hash)
+                                                           + ".cache");
+
+    m_saveTimer = new QTimer(this);
+    m_saveTimer->setSingleShot(true);
+    m_saveTimer->setInterval(5000);
+    connect(m_saveTimer, &QTimer::timeout,
+            this, &VNotebookCache::save);
+}
+
+VNotebookCache::~VNotebookCache()
+{
+    save();
+}
+
+bool VNotebookCache::statConfig(const QString &p_dirPath, qint64 &p_modified, qint64 &p_size)
+{
+    QFileInfo info(VConfigManager::getDirectoryConfigFilePath(p_dirPath));
+    if (!info.exists()) {
+        return false;
+    }
+
+    p_modified = info.lastModified().toMSecsSinceEpoch();
+    p_size = info.size();
+    return true;
+}
+
+bool VNotebookCache::lookup(const QString &p_dirPath, qint64 p_modified, qint64 p_size,
+                            QStringList &p_subDirs, QStringList &p_files)
+{
+    load();
+
+    auto it = m_entries.find(relativePath(p_dirPath));
+    if (it == m_entries.end()
+        || it->m_configModified != p_modified
+        || it->m_configSize != p_size) {
+        return false;
+    }
+
+    p_subDirs = it->m_subDirs;
+    p_files = it->m_files;
+    return true;
+}
+
+void VNotebookCache::update(const QString &p_dirPath, qint64 p_modified, qint64 p_size,
+                            const QStringList &p_subDirs, const QStringList &p_files)
+{
+    load();
+
+    DirEntry &entry = m_entries[relativePath(p_dirPath)];
+    if (VConfigManager::isDirectoryConfigPending(p_dirPath)) {
+        // The stat is of the old config file. Invalidate the entry and it will
+        // be read again after the write lands.
+        entry.m_configSize = -1;
+        markDirty();
+        return;
+    }
+
+    if (qAbs(QDateTime::currentMSecsSinceEpoch() - p_modified) < c_mtimeGranularity) {
+        // Another write within the granularity may keep the same stat. Do not
+        // cache it until the config file is old enough.
+        entry.m_configSize = -1;
+        markDirty();
+        return;
+    }
+
+    entry.m_configModified = p_modified;
+    entry.m_configSize = p_size;
+    entry.m_subDirs = p_subDirs;
+    entry.m_files = p_files;
+    markDirty();
+}
+
+void VNotebookCache::remove(const QString &p_dirPath)
+{
+    load();
+
+    QString path = relativePath(p_dirPath);
+    QString prefix = path + "/";
+    for (auto it = m_entries.begin(); it != m_entries.end();) {
+        if (it.key() == path || it.key().startsWith(prefix)) {
+            it = m_entries.erase(it);
+            m_dirty = true;
+        } else {
+            ++it;
+        }
+    }
+
+    if (m_dirty) {
+        markDirty();
+    }
+}
+
+bool VNotebookCache::isExpanded(const QString &p_dirPath)
+{
+    load();
+
+    auto it = m_entries.find(relativePath(p_dirPath));
+    return it != m_entries.end() && it->m_expanded;
+}
+
+void VNotebookCache::setExpanded(const QString &p_dirPath, bool p_expanded)
+{
+    load();
+
+    auto it = m_entries.find(relativePath(p_dirPath));
+    if (it != m_entries.end() && it->m_expanded != p_expanded) {
+        it->m_expanded = p_expanded;
+        markDirty();
+    }
+}
+
+void VNotebookCache::markDirty()
+{
+    m_dirty = true;
+    if (!m_saveTimer->isActive()) {
+        m_saveTimer->start();
+    }
+}
+
+void VNotebookCache::load()
+{
+    if (m_loaded) {
+        return;
+    }
+
+    m_loaded = true;
+
+    QFile file(m_cacheFile);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return;
+    }
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_0);
+
+    quint32 magic, version;
+    QString notebookPath;
+    qint32 count;
+    in >> magic >> version >> notebookPath >> count;
+    if (magic != c_magic || version != c_version || notebookPath != m_notebookPath) {
+        qWarning() << "invalid notebook cache" << m_cacheFile;
+        return;
+    }
+
+    QHash<QString, DirEntry> entries;
+    entries.reserve(count);
+    for (int i = 0; i < count && in.status() == QDataStream::Ok; ++i) {
+        QString path;
+        DirEntry entry;
+        in >> path >> entry.m_configModified >> entry.m_configSize >> entry.m_expanded
+           >> entry.m_subDirs >> entry.m_files;
+        entries.insert(path, entry);
+    }
+
+    if (in.status() != QDataStream::Ok) {
+        qWarning() << "corrupted notebook cache" << m_cacheFile;
+        return;
+    }
+
+    m_entries = entries;
+    qDebug() << "notebook cache loaded" << m_notebookPath << m_entries.size() << "folders";
+}
+
+bool VNotebookCache::save()
+{
+    m_saveTimer->stop();
+    if (!m_dirty) {
+        return true;
+    }
+
+    if (!VUtils::makePath(QFileInfo(m_cacheFile).path())) {
+        return false;
+    }
+
+    QSaveFile file(m_cacheFile);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "fail to open notebook cache to write" << m_cacheFile;
+        return false;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_0);
+    out << c_magic << c_version << m_notebookPath << (qint32)m_entries.size();
+    for (auto it = m_entries.begin(); it != m_entries.end(); ++it) {
+        const DirEntry &entry = it.value();
+        out << it.key() << entry.m_configModified << entry.m_configSize << entry.m_expanded
+            << entry.m_subDirs << entry.m_files;
+    }
+
+    if (out.status() != QDataStream::Ok || !file.commit()) {
+        qWarning() << "fail to write notebook cache" << m_cacheFile;
+        return false;
+    }
+
+    m_dirty = false;
+    return true;
+}
+
+void VNotebookCache::clear()
+{
+    m_saveTimer->stop();
+    m_entries.clear();
+    m_loaded = true;
+    m_dirty = false;
+    QFile::remove(m_cacheFile);
+}
+
+QString VNotebookCache::relativePath(const QString &p_dirPath) const
+{
+    return QDir(m_notebookPath).relativeFilePath(p_dirPath);
+}
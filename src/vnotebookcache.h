@@ -0,0 +1,95 @@
+#ifndef VNOTEBOOKCACHE_H
+#define VNOTEBOOKCACHE_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QHash>
+
+class QTimer;
+
+// Binary snapshot of the directory hierarchy of a notebook, so opening a
+// directory needs only a stat of its config file instead of reading and
+// parsing it. An entry is valid only if the modified time and size of the
+// config file are not changed. Config files modified within the granularity
+// of the modified time are not cached. Entries are refreshed when the directory is
+// read from disk or written, and the snapshot is saved lazily.
+class VNotebookCache : public QObject
+{
+    Q_OBJECT
+public:
+    VNotebookCache(const QString &p_notebookPath, QObject *p_parent = 0);
+
+    // Save the snapshot if it is changed.
+    ~VNotebookCache();
+
+    // Get the stat of the config file of directory @p_dirPath.
+    // Returns false if it does not exist.
+    static bool statConfig(const QString &p_dirPath, qint64 &p_modified, qint64 &p_size);
+
+    // Fetch the sub-directories and files of directory @p_dirPath if the
+    // cached entry matches the config file stat @p_modified and @p_size.
+    bool lookup(const QString &p_dirPath, qint64 p_modified, qint64 p_size,
+                QStringList &p_subDirs, QStringList &p_files);
+
+    // Update the entry of directory @p_dirPath read or written with config
+    // file stat @p_modified and @p_size. The entry is invalidated instead if
+    // the write of its config is still pending, or if it is modified too
+    // recently to tell a later write by the modified time.
+    void update(const QString &p_dirPath, qint64 p_modified, qint64 p_size,
+                const QStringList &p_subDirs, const QStringList &p_files);
+
+    // Remove the entries of directory @p_dirPath and its descendants.
+    void remove(const QString &p_dirPath);
+
+    bool isExpanded(const QString &p_dirPath);
+
+    void setExpanded(const QString &p_dirPath, bool p_expanded);
+
+    // Save the snapshot to disk if it is changed.
+    bool save();
+
+    // Remove the snapshot from memory and disk.
+    void clear();
+
+private:
+    struct DirEntry
+    {
+        DirEntry() : m_configModified(0), m_configSize(-1), m_expanded(false)
+        {
+        }
+
+        qint64 m_configModified;
+        qint64 m_configSize;
+        bool m_expanded;
+        QStringList m_subDirs;
+        QStringList m_files;
+    };
+
+    // Load the snapshot from disk if not loaded yet.
+    void load();
+
+    void markDirty();
+
+    QString relativePath(const QString &p_dirPath) const;
+
+    QString m_notebookPath;
+
+    QString m_cacheFile;
+
+    bool m_loaded;
+
+    bool m_dirty;
+
+    // Relative path of directory -> entry.
+    QHash<QString, DirEntry> m_entries;
+
+    // Save the snapshot some time after changes.
+    QTimer *m_saveTimer;
+
+    static const quint32 c_magic;
+
+    static const quint32 c_version;
+};
+
+#endif // VNOTEBOOKCACHE_H
@@ -0,0 +1,207 @@
+#include "vnotebookscanner.h"
+
+#include <QThreadPool>
+#include <QRunnable>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QDateTime>
+#include <QAtomicInteger>
+#include <QStringList>
+#include <QDebug>
+#include "vconfigmanager.h"
+#include "vconstants.h"
+
+namespace
+{
+// Number of files read by one task.
+const int c_filesPerTask = 32;
+
+// State shared by all the tasks of a scan.
+struct ScanContext
+{
+    QThreadPool *m_pool;
+    const VNotebookScanner::Filter *m_filter;
+    const VNotebookScanner::Visitor *m_visitor;
+    const QAtomicInt *m_cancel;
+
+    QAtomicInt m_dirs;
+    QAtomicInt m_files;
+    QAtomicInteger<qint64> m_bytes;
+
+    bool isCancelled() const
+    {
+        return m_cancel && m_cancel->load();
+    }
+};
+
+class FileTask : public QRunnable
+{
+public:
+    FileTask(ScanContext *p_context, const QStringList &p_files)
+        : m_context(p_context), m_files(p_files)
+    {
+    }
+
+    void run() Q_DECL_OVERRIDE
+    {
+        for (auto const &file : m_files) {
+            if (m_context->isCancelled()) {
+                return;
+            }
+
+            VScannedNote note;
+            if (!VNotebookScanner::readNote(file, note)) {
+                continue;
+            }
+
+            m_context->m_files.ref();
+            m_context->m_bytes.fetchAndAddRelaxed(note.m_size);
+            (*m_context->m_visitor)(note);
+        }
+    }
+
+private:
+    ScanContext *m_context;
+    QStringList m_files;
+};
+
+class DirTask : public QRunnable
+{
+public:
+    DirTask(ScanContext *p_context, const QString &p_path)
+        : m_context(p_context), m_path(p_path)
+    {
+    }
+
+    void run() Q_DECL_OVERRIDE
+    {
+        if (m_context->isCancelled()) {
+            return;
+        }
+
+        QJsonObject configJson = VConfigManager::readDirectoryConfig(m_path);
+        if (configJson.isEmpty()) {
+            qWarning() << "invalid directory configuration in path" << m_path;
+            return;
+        }
+
+        m_context->m_dirs.ref();
+
+        QDir dir(m_path);
+
+        // Sub-directories go to the queue first to keep the threads busy.
+        QJsonArray dirJson = configJson[DirConfig::c_subDirectories].toArray();
+        for (int i = 0; i < dirJson.size(); ++i) {
+            QString name = dirJson[i].toObject()[DirConfig::c_name].toString();
+            m_context->m_pool->start(new DirTask(m_context, dir.filePath(name)));
+        }
+
+        QStringList files;
+        QJsonArray fileJson = configJson[DirConfig::c_files].toArray();
+        for (int i = 0; i < fileJson.size(); ++i) {
+            QString filePath = dir.filePath(fileJson[i].toObject()[DirConfig::c_name].toString());
+            if (!(*m_context->m_filter)(filePath)) {
+                continue;
+            }
+
+            files.append(filePath);
+            if (files.size() == c_filesPerTask) {
+                m_context->m_pool->start(new FileTask(m_context, files));
+                files.clear();
+            }
+        }
+
+        // Read the last chunk directly.
+        if (!files.isEmpty()) {
+            FileTask task(m_context, files);
+            task.run();
+        }
+    }
+
+private:
+    ScanContext *m_context;
+    QString m_path;
+};
+}
+
+double VNotebookScanner::Stats::filesPerSecond() const
+{
+    return m_elapsed > 0 ? m_files * 1000.0 / m_elapsed : 0;
+}
+
+double VNotebookScanner::Stats::mbPerSecond() const
+{
+    return m_elapsed > 0 ? (m_bytes / (1024.0 * 1024.0)) * 1000.0 / m_elapsed : 0;
+}
+
+VNotebookScanner::Stats VNotebookScanner::scan(const QString &p_rootPath,
+                                               const Filter &p_filter,
+                                               const Visitor &p_visitor,
+                                               const QAtomicInt *p_cancel,
+                                               int p_maxThreads)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    QThreadPool pool;
+    if (p_maxThreads > 0) {
+        pool.setMaxThreadCount(p_maxThreads);
+    }
+
+    ScanContext context;
+    context.m_pool = &pool;
+    context.m_filter = &p_filter;
+    context.m_visitor = &p_visitor;
+    context.m_cancel = p_cancel;
+
+    pool.start(new DirTask(&context, QDir::cleanPath(p_rootPath)));
+
+    // Tasks started by other tasks are also waited for.
+    pool.waitForDone();
+
+    Stats stats;
+    stats.m_dirs = context.m_dirs.load();
+    stats.m_files = context.m_files.load();
+    stats.m_bytes = context.m_bytes.load();
+    stats.m_elapsed = timer.elapsed();
+
+    qDebug() << "scanned" << p_rootPath << stats.m_dirs << "folders" << stats.m_files
+             << "notes in" << stats.m_elapsed << "ms," << stats.filesPerSecond() << "files/s,"
+             << stats.mbPerSecond() << "MB/s";
+    return stats;
+}
+
+bool VNotebookScanner::readNote(const QString &p_filePath, VScannedNote &p_note)
+{
+    QFile file(p_filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "fail to read file" << p_filePath;
+        return false;
+    }
+
+    QFileInfo info(file);
+    p_note.m_path = p_filePath;
+    p_note.m_modified = info.lastModified().toMSecsSinceEpoch();
+    p_note.m_size = file.size();
+
+    if (p_note.m_size == 0) {
+        p_note.m_content.clear();
+        return true;
+    }
+
+    // Decode directly from the mapped file to avoid an extra copy.
+    uchar *data = file.map(0, p_note.m_size);
+    if (data) {
+        p_note.m_content = QString::fromUtf8(reinterpret_cast<const char *>(data),
+                                             (int)p_note.m_size);
+        file.unmap(data);
+    } else {
+        p_note.m_content = QString::fromUtf8(file.readAll());
+    }
+
+    return true;
+}
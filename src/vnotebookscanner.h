@@ -0,0 +1,76 @@
+#ifndef VNOTEBOOKSCANNER_H
+#define VNOTEBOOKSCANNER_H
+
+#include <QString>
+#include <QAtomicInt>
+#include <functional>
+
+// A note read by VNotebookScanner.
+struct VScannedNote
+{
+    // Absolute path of the note.
+    QString m_path;
+
+    // Last modified time in msecs since epoch.
+    qint64 m_modified;
+
+    qint64 m_size;
+
+    QString m_content;
+};
+
+// Walk a notebook and read its notes in parallel.
+// Directories are discovered from the directory config files instead of
+// listing the disk, so only notes managed by VNote are visited. Each
+// directory and each chunk of files is a task of a thread pool, so a large
+// directory is spread over all the threads.
+class VNotebookScanner
+{
+public:
+    // Statistics of a scan.
+    struct Stats
+    {
+        Stats() : m_dirs(0), m_files(0), m_bytes(0), m_elapsed(0)
+        {
+        }
+
+        // Files read per second.
+        double filesPerSecond() const;
+
+        // MB read per second.
+        double mbPerSecond() const;
+
+        int m_dirs;
+        int m_files;
+        qint64 m_bytes;
+
+        // Time used in msecs.
+        qint64 m_elapsed;
+    };
+
+    // Return false to skip a file.
+    typedef std::function<bool(const QString &p_filePath)> Filter;
+
+    // Called concurrently from the worker threads for each note read.
+    typedef std::function<void(const VScannedNote &p_note)> Visitor;
+
+    // Scan the notebook at @p_rootPath and call @p_visitor for each note
+    // passing @p_filter. Returns after all the visitors finish.
+    // @p_cancel: stop scanning if it becomes non-zero.
+    // @p_maxThreads: 0 to use the ideal thread count.
+    static Stats scan(const QString &p_rootPath,
+                      const Filter &p_filter,
+                      const Visitor &p_visitor,
+                      const QAtomicInt *p_cancel = NULL,
+                      int p_maxThreads = 0);
+
+    // Read the content of @p_filePath as UTF-8, mapping the file into memory
+    // if possible.
+    // Returns false if it fails.
+    static bool readNote(const QString &p_filePath, VScannedNote &p_note);
+
+private:
+    VNotebookScanner() {}
+};
+
+#endif // VNOTEBOOKSCANNER_H
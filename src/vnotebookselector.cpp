@@ -9,6 +9,7 @@
 #include <QLabel>
 #include <QDesktopServices>
 #include <QUrl>
+#include <QProgressDialog>
 #include "vnotebook.h"
 #include "vconfigmanager.h"
 #include "dialog/vnewnotebookdialog.h"
@@ -20,6 +21,9 @@
 #include "vnote.h"
 #include "veditarea.h"
 #include "vnofocusitemdelegate.h"
+#include "vunusedimagecollector.h"
+#include "vchangebus.h"
+#include "vtransferengine.h"
 
 extern VConfigManager vconfig;
 extern VNote *g_vnote;
@@ -29,7 +33,8 @@ const int VNotebookSelector::c_notebookStartIdx = 1;
 VNotebookSelector::VNotebookSelector(VNote *vnote, QWidget *p_parent)
     : QComboBox(p_parent), VNavigationMode(),
       m_vnote(vnote), m_notebooks(m_vnote->getNotebooks()),
-      m_editArea(NULL), m_lastValidIndex(-1), m_naviLabel(NULL)
+      m_editArea(NULL), m_lastValidIndex(-1), m_imageCollectorProgress(NULL),
+      m_naviLabel(NULL)
 {
     m_listWidget = new QListWidget(this);
     m_listWidget->setItemDelegate(new VNoFocusItemDelegate(this));
@@ -45,6 +50,24 @@ VNotebookSelector::VNotebookSelector(VNote *vnote, QWidget *p_parent)
 
     initActions();
 
+    m_imageCollector = new VUnusedImageCollector(this);
+    connect(m_imageCollector, &VUnusedImageCollector::progressChanged,
+            this, [this](int p_value, int p_total) {
+                if (m_imageCollectorProgress) {
+                    m_imageCollectorProgress->setMaximum(p_total);
+                    m_imageCollectorProgress->setValue(p_value);
+                }
+            });
+    connect(m_imageCollector, &VUnusedImageCollector::finished,
+            this, &VNotebookSelector::handleUnusedImagesCollected);
+    connect(m_imageCollector, &VUnusedImageCollector::cancelled,
+            this, [this]() {
+                if (m_imageCollectorProgress) {
+                    m_imageCollectorProgress->reset();
+                    m_imageCollectorProgress->hide();
+                }
+            });
+
     connect(this, SIGNAL(currentIndexChanged(int)),
             this, SLOT(handleCurIndexChanged(int)));
     connect(this, SIGNAL(activated(int)),
@@ -64,6 +87,13 @@ void VNotebookSelector::initActions()
     m_notebookInfoAct->setToolTip(tr("View and edit current notebook's information"));
     connect(m_notebookInfoAct, SIGNAL(triggered(bool)),
             this, SLOT(editNotebookInfo()));
+
+    m_cleanUnusedImagesAct = new QAction(tr("&Clean Unused Images"), this);
+    m_cleanUnusedImagesAct->setToolTip(tr("Delete images within the image folders "
+                                          "of current notebook which are not used "
+                                          "by any note"));
+    connect(m_cleanUnusedImagesAct, &QAction::triggered,
+            this, &VNotebookSelector::cleanUnusedImages);
 }
 
 void VNotebookSelector::updateComboBox()
@@ -205,6 +235,8 @@ void VNotebookSelector::createNotebook(const QString &p_name,
     m_notebooks.append(nb);
     vconfig.setNotebooks(m_notebooks);
 
+    VChangeBus::post(VChange::NotebookAdded, nb->getPath(), nb->getPath(), true);
+
     addNotebookItem(nb->getName());
     setCurrentIndexNotebook(m_notebooks.size() - 1);
 }
@@ -222,6 +254,15 @@ void VNotebookSelector::deleteNotebook()
     VNotebook *notebook = getNotebookFromComboIndex(index);
     Q_ASSERT(notebook);
 
+    if (m_vnote->getTransferEngine()->isInvolved(notebook->getPath())) {
+        VUtils::showMessage(QMessageBox::Information, tr("Information"),
+                            tr("Notes of notebook <span style=\"%1\">%2</span> are being copied or moved.")
+                              .arg(vconfig.c_dataTextStyle).arg(notebook->getName()),
+                            tr("Please try again after it finishes."),
+                            QMessageBox::Ok, QMessageBox::Ok, this);
+        return;
+    }
+
     VDeleteNotebookDialog dialog(tr("Delete Notebook"), notebook->getName(), notebook->getPath(), this);
     if (dialog.exec() == QDialog::Accepted) {
         bool deleteFiles = dialog.getDeleteFiles();
@@ -244,6 +285,8 @@ void VNotebookSelector::deleteNotebook(VNotebook *p_notebook, bool p_deleteFiles
     QString name(p_notebook->getName());
     QString path(p_notebook->getPath());
     bool ret = VNotebook::deleteNotebook(p_notebook, p_deleteFiles);
+
+    VChangeBus::post(VChange::NotebookRemoved, path, path, true);
     if (!ret) {
         // Notebook could not be deleted completely.
         int cho = VUtils::showMessage(QMessageBox::Information, tr("Delete Notebook Folder From Disk"),
@@ -310,6 +353,101 @@ void VNotebookSelector::editNotebookInfo()
     }
 }
 
+void VNotebookSelector::cleanUnusedImages()
+{
+    QList<QListWidgetItem *> items = m_listWidget->selectedItems();
+    if (items.isEmpty() || m_imageCollector->isRunning()) {
+        return;
+    }
+    Q_ASSERT(items.size() == 1);
+    int index = indexOfListItem(items[0]);
+
+    VNotebook *notebook = getNotebookFromComboIndex(index);
+    Q_ASSERT(notebook);
+
+    // Images inserted into notes being edited may not be saved yet.
+    if (!m_editArea->closeFile(notebook, false)) {
+        return;
+    }
+
+    m_imageCollectorNotebook = notebook->getName();
+
+    if (!m_imageCollectorProgress) {
+        m_imageCollectorProgress = new QProgressDialog(this);
+        m_imageCollectorProgress->setWindowTitle(tr("Clean Unused Images"));
+        m_imageCollectorProgress->setAutoClose(false);
+        m_imageCollectorProgress->setAutoReset(false);
+        connect(m_imageCollectorProgress, &QProgressDialog::canceled,
+                m_imageCollector, &VUnusedImageCollector::cancel);
+    }
+
+    m_imageCollectorProgress->setLabelText(tr("Collecting unused images of notebook %1...")
+                                             .arg(m_imageCollectorNotebook));
+    m_imageCollectorProgress->setRange(0, 0);
+    m_imageCollectorProgress->setValue(0);
+    m_imageCollectorProgress->show();
+
+    // Dry run first to let user confirm.
+    m_imageCollector->collect(notebook, true);
+}
+
+void VNotebookSelector::handleUnusedImagesCollected(const QStringList &p_images, bool p_deleted)
+{
+    if (m_imageCollectorProgress) {
+        m_imageCollectorProgress->reset();
+        m_imageCollectorProgress->hide();
+    }
+
+    if (p_deleted) {
+        VUtils::showMessage(QMessageBox::Information, tr("Information"),
+                            tr("%1 unused images of notebook "
+                               "<span style=\"%2\">%3</span> have been deleted.")
+                              .arg(p_images.size())
+                              .arg(vconfig.c_dataTextStyle)
+                              .arg(m_imageCollectorNotebook), "",
+                            QMessageBox::Ok, QMessageBox::Ok, this);
+        return;
+    }
+
+    if (p_images.isEmpty()) {
+        VUtils::showMessage(QMessageBox::Information, tr("Information"),
+                            tr("There is no unused image in notebook "
+                               "<span style=\"%1\">%2</span>.")
+                              .arg(vconfig.c_dataTextStyle)
+                              .arg(m_imageCollectorNotebook), "",
+                            QMessageBox::Ok, QMessageBox::Ok, this);
+        return;
+    }
+
+    const int maxShown = 10;
+    QString info = QStringList(p_images.mid(0, maxShown)).join("\n");
+    if (p_images.size() > maxShown) {
+        info += "\n...";
+    }
+
+    int ret = VUtils::showMessage(QMessageBox::Warning, tr("Warning"),
+                                  tr("Found %1 unused images in notebook "
+                                     "<span style=\"%2\">%3</span>. "
+                                     "Are you sure to delete them?")
+                                    .arg(p_images.size())
+                                    .arg(vconfig.c_dataTextStyle)
+                                    .arg(m_imageCollectorNotebook),
+                                  info,
+                                  QMessageBox::Ok | QMessageBox::Cancel,
+                                  QMessageBox::Ok, this, MessageBoxType::Danger);
+    if (ret != QMessageBox::Ok) {
+        return;
+    }
+
+    m_imageCollectorProgress->setLabelText(tr("Deleting unused images of notebook %1...")
+                                             .arg(m_imageCollectorNotebook));
+    m_imageCollectorProgress->setRange(0, p_images.size());
+    m_imageCollectorProgress->setValue(0);
+    m_imageCollectorProgress->show();
+
+    m_imageCollector->deleteImages(p_images);
+}
+
 void VNotebookSelector::addNotebookItem(const QString &p_name)
 {
     QListWidgetItem *item = new QListWidgetItem(m_listWidget);
@@ -348,6 +486,9 @@ void VNotebookSelector::requestPopupListContextMenu(QPoint p_pos)
     menu.setToolTipsVisible(true);
     menu.addAction(m_deleteNotebookAct);
     menu.addAction(m_notebookInfoAct);
+    menu.addSeparator();
+    menu.addAction(m_cleanUnusedImagesAct);
+    m_cleanUnusedImagesAct->setEnabled(!m_imageCollector->isRunning());
 
     menu.exec(m_listWidget->mapToGlobal(p_pos));
 }
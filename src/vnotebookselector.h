@@ -13,6 +13,8 @@ class QListWidget;
 class QAction;
 class QListWidgetItem;
 class QLabel;
+class QProgressDialog;
+class VUnusedImageCollector;
 
 class VNotebookSelector : public QComboBox, public VNavigationMode
 {
@@ -49,6 +51,11 @@ private slots:
     void deleteNotebook();
     void editNotebookInfo();
 
+    // Collect unused images of the selected notebook and ask to delete them.
+    void cleanUnusedImages();
+
+    void handleUnusedImagesCollected(const QStringList &p_images, bool p_deleted);
+
 private:
     void initActions();
     void updateComboBox();
@@ -85,6 +92,15 @@ private:
     // Actions
     QAction *m_deleteNotebookAct;
     QAction *m_notebookInfoAct;
+    QAction *m_cleanUnusedImagesAct;
+
+    // Collect unused images in background.
+    VUnusedImageCollector *m_imageCollector;
+
+    QProgressDialog *m_imageCollectorProgress;
+
+    // Name of the notebook whose unused images are being collected.
+    QString m_imageCollectorNotebook;
 
     // We will add several special action item in the combobox. This is the start index
     // of the real notebook items related to m_notebooks.
@@ -4,6 +4,7 @@
 #include <QFileInfo>
 #include <QDir>
 #include "utils/vutils.h"
+#include "vfilewatcher.h"
 
 VOrphanFile::VOrphanFile(const QString &p_path, QObject *p_parent)
     : VFile(VUtils::fileNameFromPath(p_path), p_parent, FileType::Orphan, false),
@@ -23,6 +24,7 @@ bool VOrphanFile::open()
     m_content = VUtils::readFileFromDisk(m_path);
     m_modified = false;
     m_opened = true;
+    VFileWatcher::watch(m_path);
     return true;
 }
 
@@ -33,15 +33,42 @@ void VOutline::checkOutline(const VToc &p_toc) const
     }
 }
 
-void VOutline::updateOutline(const VToc &toc)
+// Whether a header is more than one level lower than the header before it.
+// Such an outline does not build the tree in the order of headers.
+static bool hasLevelJump(const QVector<VHeader> &p_headers)
 {
-    // Clear current header
-    curHeader = VAnchor();
+    for (int i = 1; i < p_headers.size(); ++i) {
+        if (p_headers[i].level > p_headers[i - 1].level + 1) {
+            return true;
+        }
+    }
 
+    return false;
+}
+
+void VOutline::updateOutline(const VToc &toc)
+{
     checkOutline(toc);
 
+    // Outline of the same file is patched.
+    bool patch = outline.valid
+                 && toc.valid
+                 && outline.m_file == toc.m_file
+                 && outline.type == toc.type
+                 && !hasLevelJump(outline.headers)
+                 && !hasLevelJump(toc.headers);
+
+    QVector<VHeader> oldHeaders = outline.headers;
     outline = toc;
 
+    if (patch) {
+        patchTree(oldHeaders);
+        return;
+    }
+
+    // Clear current header
+    curHeader = VAnchor();
+
     updateTreeFromOutline();
 
     expandTree();
@@ -50,37 +77,152 @@ void VOutline::updateOutline(const VToc &toc)
 void VOutline::updateTreeFromOutline()
 {
     clear();
+    m_items.clear();
 
     if (!outline.valid) {
         return;
     }
 
     const QVector<VHeader> &headers = outline.headers;
+    m_items.resize(headers.size());
     int idx = 0;
-    updateTreeByLevel(headers, idx, NULL, NULL, 1);
+    int topIdx = 0;
+    updateTreeByLevel(headers, idx, headers.size(), topIdx, NULL, NULL, 1);
+}
+
+// Whether the items of the two headers are the same.
+static bool isSameItem(const VHeader &p_a, const VHeader &p_b)
+{
+    return p_a.level == p_b.level
+           && p_a.name == p_b.name
+           && p_a.anchor == p_b.anchor
+           && p_a.isEmpty() == p_b.isEmpty();
+}
+
+void VOutline::patchTree(const QVector<VHeader> &p_oldHeaders)
+{
+    const QVector<VHeader> &headers = outline.headers;
+    int nrOld = p_oldHeaders.size();
+    int nrNew = headers.size();
+    Q_ASSERT(m_items.size() == nrOld);
+
+    // Common prefix and suffix. Line numbers are not shown. Start from the
+    // ones known by the producer of the outline.
+    int prefix = qMin(outline.m_samePrefix, qMin(nrOld, nrNew));
+    while (prefix < nrOld && prefix < nrNew
+           && isSameItem(p_oldHeaders[prefix], headers[prefix])) {
+        ++prefix;
+    }
+
+    int suffix = qMin(outline.m_sameSuffix, qMin(nrOld, nrNew) - prefix);
+    while (suffix < nrOld - prefix && suffix < nrNew - prefix
+           && isSameItem(p_oldHeaders[nrOld - suffix - 1], headers[nrNew - suffix - 1])) {
+        ++suffix;
+    }
+
+    if (nrOld == nrNew) {
+        bool sameLevels = true;
+        for (int i = prefix; i < nrNew - suffix; ++i) {
+            if (p_oldHeaders[i].level != headers[i].level) {
+                sameLevels = false;
+                break;
+            }
+        }
+
+        if (sameLevels) {
+            // Only the names change, which is the case when typing.
+            for (int i = prefix; i < nrNew - suffix; ++i) {
+                fillItem(m_items[i], headers[i]);
+            }
+
+            return;
+        }
+    }
+
+    // Rebuild the top level subtrees covering the changed headers.
+    // Without level jumps, a header is a top level item if no header before
+    // it is of lower level.
+    QVector<bool> isTop(nrNew + 1, true);
+    for (int i = 1, minLevel = nrNew > 0 ? headers[0].level : 0; i < nrNew; ++i) {
+        isTop[i] = headers[i].level <= minLevel;
+        minLevel = qMin(minLevel, headers[i].level);
+    }
+
+    int first = prefix;
+    while (first > 0
+           && !((first == nrOld || !m_items[first]->parent()) && isTop[first])) {
+        --first;
+    }
+
+    int delta = nrNew - nrOld;
+    int last = qMax(prefix, nrNew - suffix);
+    while (last < nrNew
+           && !(isTop[last] && !m_items[last - delta]->parent())) {
+        ++last;
+    }
+
+    int oldLast = last - delta;
+    int topIdx = first < nrOld ? indexOfTopLevelItem(m_items[first]) : topLevelItemCount();
+    int nrTop = 0;
+    for (int i = first; i < oldLast; ++i) {
+        if (!m_items[i]->parent()) {
+            ++nrTop;
+        }
+    }
+
+    // Avoid activating another item when removing current item.
+    setCurrentItem(NULL);
+    curHeader = VAnchor();
+
+    for (int i = 0; i < nrTop; ++i) {
+        delete takeTopLevelItem(topIdx);
+    }
+
+    QVector<QTreeWidgetItem *> items(nrNew);
+    for (int i = 0; i < first; ++i) {
+        items[i] = m_items[i];
+    }
+
+    for (int i = last; i < nrNew; ++i) {
+        items[i] = m_items[i - delta];
+        if (delta != 0) {
+            items[i]->setData(0, Qt::UserRole, i);
+        }
+    }
+
+    m_items = items;
+
+    int idx = first;
+    updateTreeByLevel(headers, idx, last, topIdx, NULL, NULL, 1);
+    for (int i = first; i < last; ++i) {
+        m_items[i]->setExpanded(true);
+    }
 }
 
-void VOutline::updateTreeByLevel(const QVector<VHeader> &headers, int &index,
-                                 QTreeWidgetItem *parent, QTreeWidgetItem *last, int level)
+void VOutline::updateTreeByLevel(const QVector<VHeader> &headers, int &index, int p_end,
+                                 int &p_topIdx, QTreeWidgetItem *parent,
+                                 QTreeWidgetItem *last, int level)
 {
-    while (index < headers.size()) {
+    while (index < p_end) {
         const VHeader &header = headers[index];
         QTreeWidgetItem *item;
         if (header.level == level) {
             if (parent) {
                 item = new QTreeWidgetItem(parent);
             } else {
-                item = new QTreeWidgetItem(this);
+                item = new QTreeWidgetItem();
+                insertTopLevelItem(p_topIdx++, item);
             }
 
             fillItem(item, header);
+            m_items[index] = item;
 
             last = item;
             ++index;
         } else if (header.level < level) {
             return;
         } else {
-            updateTreeByLevel(headers, index, last, NULL, level + 1);
+            updateTreeByLevel(headers, index, p_end, p_topIdx, last, NULL, level + 1);
         }
     }
 }
@@ -93,6 +235,8 @@ void VOutline::fillItem(QTreeWidgetItem *p_item, const VHeader &p_header)
 
     if (p_header.isEmpty()) {
         p_item->setForeground(0, QColor("grey"));
+    } else {
+        p_item->setData(0, Qt::ForegroundRole, QVariant());
     }
 }
 
@@ -134,95 +278,41 @@ void VOutline::updateCurHeader(const VAnchor &anchor)
     }
 
     curHeader = anchor;
-    if (outline.type == VHeaderType::Anchor) {
-        selectAnchor(anchor.anchor);
-    } else {
-        // Select by lineNumber.
-        selectLineNumber(anchor.lineNumber);
-    }
+    selectHeader(anchor);
 }
 
-void VOutline::selectAnchor(const QString &anchor)
+void VOutline::selectHeader(const VAnchor &p_anchor)
 {
-    setCurrentItem(NULL);
-
-    if (anchor.isEmpty()) {
-        return;
-    }
-
-    int nrTop = topLevelItemCount();
-    for (int i = 0; i < nrTop; ++i) {
-        if (selectAnchorOne(topLevelItem(i), anchor)) {
-            return;
-        }
-    }
+    int idx = indexOfAnchor(p_anchor);
+    setCurrentItem(idx == -1 ? NULL : m_items[idx]);
 }
 
-bool VOutline::selectAnchorOne(QTreeWidgetItem *item, const QString &anchor)
+int VOutline::indexOfAnchor(const VAnchor &p_anchor) const
 {
-    if (!item) {
-        return false;
+    bool byAnchor = outline.type == VHeaderType::Anchor;
+    if (byAnchor ? p_anchor.anchor.isEmpty() : p_anchor.lineNumber == -1) {
+        return -1;
     }
 
-    const VHeader *header = getHeaderFromItem(item);
-    if (!header) {
-        return false;
-    }
-
-    if (header->anchor == anchor) {
-        setCurrentItem(item);
-        return true;
-    }
-
-    int nrChild = item->childCount();
-    for (int i = 0; i < nrChild; ++i) {
-        if (selectAnchorOne(item->child(i), anchor)) {
-            return true;
-        }
-    }
-    return false;
-}
-
-void VOutline::selectLineNumber(int lineNumber)
-{
-    setCurrentItem(NULL);
+    const QVector<VHeader> &headers = outline.headers;
+    auto matched = [&](const VHeader &p_header) {
+        return byAnchor ? p_header.anchor == p_anchor.anchor
+                        : p_header.lineNumber == p_anchor.lineNumber;
+    };
 
-    if (lineNumber == -1) {
-        return;
+    // The anchor usually carries the index of the header.
+    int idx = p_anchor.m_outlineIndex;
+    if (idx >= 0 && idx < m_items.size() && matched(headers[idx])) {
+        return idx;
     }
 
-    int nrTop = topLevelItemCount();
-    for (int i = 0; i < nrTop; ++i) {
-        if (selectLineNumberOne(topLevelItem(i), lineNumber)) {
-            return;
+    for (idx = 0; idx < m_items.size(); ++idx) {
+        if (matched(headers[idx])) {
+            return idx;
         }
     }
-}
-
-bool VOutline::selectLineNumberOne(QTreeWidgetItem *item, int lineNumber)
-{
-    if (!item) {
-        return false;
-    }
-
-    const VHeader *header = getHeaderFromItem(item);
-    if (!header) {
-        return false;
-    }
 
-    if (header->lineNumber == lineNumber) {
-        // Select this item
-        setCurrentItem(item);
-        return true;
-    }
-
-    int nrChild = item->childCount();
-    for (int i = 0; i < nrChild; ++i) {
-        if (selectLineNumberOne(item->child(i), lineNumber)) {
-            return true;
-        }
-    }
-    return false;
+    return -1;
 }
 
 void VOutline::keyPressEvent(QKeyEvent *event)
@@ -39,15 +39,24 @@ private:
     // Update tree according to outline.
     void updateTreeFromOutline();
 
+    // Patch the tree built from @p_oldHeaders according to outline.
+    // Only the items of the changed headers are updated or rebuilt.
+    void patchTree(const QVector<VHeader> &p_oldHeaders);
+
+    // Build items for headers in [@index, @p_end).
     // @index: the index in @headers.
-    void updateTreeByLevel(const QVector<VHeader> &headers, int &index, QTreeWidgetItem *parent,
+    // @p_topIdx: where to insert the top level items.
+    void updateTreeByLevel(const QVector<VHeader> &headers, int &index, int p_end,
+                           int &p_topIdx, QTreeWidgetItem *parent,
                            QTreeWidgetItem *last, int level);
 
     void expandTree();
-    void selectAnchor(const QString &anchor);
-    bool selectAnchorOne(QTreeWidgetItem *item, const QString &anchor);
-    void selectLineNumber(int lineNumber);
-    bool selectLineNumberOne(QTreeWidgetItem *item, int lineNumber);
+
+    // Select the item of the header @p_anchor points to.
+    void selectHeader(const VAnchor &p_anchor);
+
+    // Return the index of the header @p_anchor points to, or -1 if not found.
+    int indexOfAnchor(const VAnchor &p_anchor) const;
     QList<QTreeWidgetItem *> getVisibleItems() const;
     QList<QTreeWidgetItem *> getVisibleChildItems(const QTreeWidgetItem *p_item) const;
 
@@ -63,6 +72,9 @@ private:
     VToc outline;
     VAnchor curHeader;
 
+    // Index in outline.headers -> item.
+    QVector<QTreeWidgetItem *> m_items;
+
     // Navigation Mode.
     // Map second key to QTreeWidgetItem.
     QMap<QChar, QTreeWidgetItem *> m_keyMap;
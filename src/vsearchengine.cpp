@@ -0,0 +1,319 @@
+#include "vsearchengine.h"
+
+#include <QtConcurrent>
+#include <QTimer>
+#include <QFile>
+#include <QTextStream>
+#include <QMutexLocker>
+#include <QDir>
+#include <QDebug>
+#include "vnote.h"
+#include "vnotebook.h"
+
+extern VNote *g_vnote;
+
+const int VSearchEngine::c_maxResults = 200;
+
+const int VSearchEngine::c_maxLinesPerNote = 20;
+
+const int VSearchEngine::c_commitInterval = 200;
+
+VSearchEngine::VSearchEngine(QObject *p_parent)
+    : QObject(p_parent), m_hasPendingQuery(false), m_cancel(0),
+      m_indexedCount(0)
+{
+    m_searchWatcher = new QFutureWatcher<QVector<VSearchResult>>(this);
+    connect(m_searchWatcher, &QFutureWatcher<QVector<VSearchResult>>::finished,
+            this, &VSearchEngine::handleSearchFinished);
+
+    m_indexWatcher = new QFutureWatcher<bool>(this);
+    connect(m_indexWatcher, &QFutureWatcher<bool>::finished,
+            this, &VSearchEngine::handleIndexingFinished);
+
+    m_progressTimer = new QTimer(this);
+    m_progressTimer->setInterval(200);
+    connect(m_progressTimer, &QTimer::timeout,
+            this, [this]() {
+                emit indexingProgress(m_indexedCount.load());
+            });
+
+    m_commitTimer = new QTimer(this);
+    m_commitTimer->setSingleShot(true);
+    m_commitTimer->setInterval(c_commitInterval);
+    connect(m_commitTimer, &QTimer::timeout,
+            this, &VSearchEngine::commitChanges);
+
+    m_commitWatcher = new QFutureWatcher<void>(this);
+    connect(m_commitWatcher, &QFutureWatcher<void>::finished,
+            this, &VSearchEngine::handleCommitFinished);
+
+    connect(g_vnote->getChangeBus(), &VChangeBus::changed,
+            this, &VSearchEngine::handleChange);
+}
+
+VSearchEngine::~VSearchEngine()
+{
+    m_cancel.store(1);
+    m_searchWatcher->waitForFinished();
+    m_indexWatcher->waitForFinished();
+    m_commitWatcher->waitForFinished();
+}
+
+void VSearchEngine::search(const QString &p_query)
+{
+    if (m_searchWatcher->isRunning()) {
+        m_pendingQuery = p_query;
+        m_hasPendingQuery = true;
+        return;
+    }
+
+    startSearch(p_query);
+}
+
+void VSearchEngine::startSearch(const QString &p_query)
+{
+    m_query = p_query;
+    m_hasPendingQuery = false;
+    m_searchTimer.start();
+
+    QVector<QSharedPointer<VSearchIndex>> indexes = currentIndexes();
+    m_searchWatcher->setFuture(QtConcurrent::run([this, indexes, p_query]() {
+        return searchIndexes(indexes, p_query);
+    }));
+}
+
+void VSearchEngine::handleSearchFinished()
+{
+    if (m_hasPendingQuery) {
+        // Drop the stale results.
+        startSearch(m_pendingQuery);
+        return;
+    }
+
+    qint64 elapsed = m_searchTimer.elapsed();
+    qDebug() << "search" << m_query << "in" << elapsed << "ms";
+    emit searchFinished(m_query, m_searchWatcher->result(), elapsed);
+}
+
+bool VSearchEngine::rebuildIndex()
+{
+    if (m_indexWatcher->isRunning()) {
+        return false;
+    }
+
+    m_indexedCount.store(0);
+    m_indexStats = VNotebookScanner::Stats();
+    m_progressTimer->start();
+
+    QVector<QSharedPointer<VSearchIndex>> indexes = currentIndexes();
+    m_indexWatcher->setFuture(QtConcurrent::run([this, indexes]() {
+        return buildIndexes(indexes);
+    }));
+
+    return true;
+}
+
+bool VSearchEngine::isIndexing() const
+{
+    return m_indexWatcher->isRunning();
+}
+
+void VSearchEngine::handleIndexingFinished()
+{
+    m_progressTimer->stop();
+    emit indexingFinished(m_indexWatcher->result(), m_indexStats);
+}
+
+void VSearchEngine::handleChange(const VChange &p_change)
+{
+    switch (p_change.m_type) {
+    case VChange::Updated:
+        m_pendingChanges[p_change.m_notebookPath].m_updated.insert(p_change.m_path);
+        break;
+
+    case VChange::Removed:
+        m_pendingChanges[p_change.m_notebookPath].m_removed.insert(p_change.m_path);
+        break;
+
+    case VChange::NotebookAdded:
+        // Index will be built on first search.
+        return;
+
+    case VChange::NotebookRemoved:
+    {
+        {
+            QMutexLocker locker(&m_indexesMutex);
+            m_indexes.remove(p_change.m_notebookPath);
+        }
+
+        PendingChanges changes;
+        changes.m_notebookRemoved = true;
+        m_pendingChanges[p_change.m_notebookPath] = changes;
+        break;
+    }
+
+    default:
+        return;
+    }
+
+    if (!m_commitTimer->isActive() && !m_commitWatcher->isRunning()) {
+        m_commitTimer->start();
+    }
+}
+
+void VSearchEngine::commitChanges()
+{
+    if (m_commitWatcher->isRunning() || m_pendingChanges.isEmpty()) {
+        return;
+    }
+
+    QHash<QString, PendingChanges> changes = m_pendingChanges;
+    m_pendingChanges.clear();
+    m_commitWatcher->setFuture(QtConcurrent::run([this, changes]() {
+        applyChanges(changes);
+    }));
+}
+
+void VSearchEngine::handleCommitFinished()
+{
+    if (!m_pendingChanges.isEmpty()) {
+        m_commitTimer->start();
+    }
+}
+
+void VSearchEngine::applyChanges(const QHash<QString, PendingChanges> &p_changes)
+{
+    QMutexLocker locker(&m_buildMutex);
+    for (auto it = p_changes.begin(); it != p_changes.end(); ++it) {
+        const PendingChanges &changes = it.value();
+        if (changes.m_notebookRemoved) {
+            QDir(VSearchIndex::indexFolderOfNotebook(it.key())).removeRecursively();
+            continue;
+        }
+
+        // Index not built yet will be built from scratch on first search.
+        QSharedPointer<VSearchIndex> index = getIndex(it.key());
+        if (!index->isLoaded() && !index->load()) {
+            continue;
+        }
+
+        if (!index->update(changes.m_updated.toList(), changes.m_removed.toList())) {
+            qWarning() << "fail to update search index of" << it.key();
+        }
+    }
+}
+
+QSharedPointer<VSearchIndex> VSearchEngine::getIndex(const QString &p_notebookPath)
+{
+    QMutexLocker locker(&m_indexesMutex);
+    auto it = m_indexes.find(p_notebookPath);
+    if (it == m_indexes.end()) {
+        QSharedPointer<VSearchIndex> index(new VSearchIndex(p_notebookPath,
+                                                            VSearchIndex::indexFolderOfNotebook(p_notebookPath)));
+        it = m_indexes.insert(p_notebookPath, index);
+    }
+
+    return it.value();
+}
+
+QVector<QSharedPointer<VSearchIndex>> VSearchEngine::currentIndexes()
+{
+    QVector<QSharedPointer<VSearchIndex>> indexes;
+    const QVector<VNotebook *> &notebooks = g_vnote->getNotebooks();
+    for (auto const &nb : notebooks) {
+        indexes.append(getIndex(nb->getPath()));
+    }
+
+    return indexes;
+}
+
+bool VSearchEngine::prepareIndex(const QSharedPointer<VSearchIndex> &p_index)
+{
+    QMutexLocker locker(&m_buildMutex);
+    if (p_index->isLoaded() || p_index->load()) {
+        return true;
+    }
+
+    return p_index->rebuild(&m_cancel);
+}
+
+bool VSearchEngine::buildIndexes(const QVector<QSharedPointer<VSearchIndex>> &p_indexes)
+{
+    QMutexLocker locker(&m_buildMutex);
+
+    bool ret = true;
+    for (auto const &index : p_indexes) {
+        VNotebookScanner::Stats stats;
+        if (!index->rebuild(&m_cancel, &m_indexedCount, &stats)) {
+            ret = false;
+        }
+
+        m_indexStats.m_dirs += stats.m_dirs;
+        m_indexStats.m_files += stats.m_files;
+        m_indexStats.m_bytes += stats.m_bytes;
+        m_indexStats.m_elapsed += stats.m_elapsed;
+    }
+
+    return ret;
+}
+
+QVector<VSearchResult> VSearchEngine::searchIndexes(const QVector<QSharedPointer<VSearchIndex>> &p_indexes,
+                                                    const QString &p_query)
+{
+    QVector<VSearchResult> results;
+    for (auto const &index : p_indexes) {
+        if (m_cancel.load()) {
+            break;
+        }
+
+        if (!prepareIndex(index)) {
+            qWarning() << "fail to prepare search index of" << index->getNotebookPath();
+            continue;
+        }
+
+        results += index->search(p_query, c_maxResults);
+    }
+
+    std::stable_sort(results.begin(), results.end(),
+                     [](const VSearchResult &p_a, const VSearchResult &p_b) {
+                         return p_a.m_matches.size() > p_b.m_matches.size();
+                     });
+
+    if (results.size() > c_maxResults) {
+        results.resize(c_maxResults);
+    }
+
+    for (auto &result : results) {
+        fetchMatchedLines(result);
+    }
+
+    return results;
+}
+
+void VSearchEngine::fetchMatchedLines(VSearchResult &p_result)
+{
+    QVector<VSearchMatch> &matches = p_result.m_matches;
+    if (matches.size() > c_maxLinesPerNote) {
+        matches.resize(c_maxLinesPerNote);
+    }
+
+    QFile file(p_result.m_filePath);
+    if (matches.isEmpty() || !file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        return;
+    }
+
+    // Matches are sorted by line number.
+    QTextStream stream(&file);
+    stream.setCodec("UTF-8");
+    int lineNum = 0;
+    int idx = 0;
+    while (idx < matches.size() && !stream.atEnd()) {
+        QString line = stream.readLine();
+        if (lineNum == matches[idx].m_lineNumber) {
+            matches[idx].m_text = line.trimmed();
+            ++idx;
+        }
+
+        ++lineNum;
+    }
+}
@@ -0,0 +1,154 @@
+#ifndef VSEARCHENGINE_H
+#define VSEARCHENGINE_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QHash>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QSharedPointer>
+#include <QFutureWatcher>
+#include <QElapsedTimer>
+#include <QSet>
+#include "vsearchindex.h"
+#include "vchangebus.h"
+
+class QTimer;
+
+// Full-text search over all the notebooks.
+// Indexes are loaded or built on first use and queried in background.
+// Changes published on the change bus are batched and committed to the
+// loaded indexes in background.
+class VSearchEngine : public QObject
+{
+    Q_OBJECT
+public:
+    explicit VSearchEngine(QObject *p_parent = 0);
+
+    ~VSearchEngine();
+
+    // Search @p_query in all the notebooks in background.
+    // If a search is running, @p_query will be searched after it and
+    // the queries in between are dropped.
+    void search(const QString &p_query);
+
+    // Rebuild the indexes of all the notebooks in background.
+    // Returns false if it is busy.
+    bool rebuildIndex();
+
+    bool isIndexing() const;
+
+    // Get the index of notebook @p_notebookPath. Create it if not exists.
+    QSharedPointer<VSearchIndex> getIndex(const QString &p_notebookPath);
+
+signals:
+    // @p_elapsed: time used in msecs.
+    void searchFinished(const QString &p_query,
+                        const QVector<VSearchResult> &p_results,
+                        qint64 p_elapsed);
+
+    // @p_value notes indexed so far.
+    void indexingProgress(int p_value);
+
+    // @p_stats: statistics of scanning all the notebooks.
+    void indexingFinished(bool p_succeed, const VNotebookScanner::Stats &p_stats);
+
+private slots:
+    void handleSearchFinished();
+
+    void handleIndexingFinished();
+
+    void handleChange(const VChange &p_change);
+
+    // Commit pending changes to the indexes in background.
+    void commitChanges();
+
+    void handleCommitFinished();
+
+private:
+    // Pending changes of a notebook.
+    struct PendingChanges
+    {
+        PendingChanges() : m_notebookRemoved(false)
+        {
+        }
+
+        QSet<QString> m_updated;
+        QSet<QString> m_removed;
+        bool m_notebookRemoved;
+    };
+
+    // Apply @p_changes to the indexes.
+    void applyChanges(const QHash<QString, PendingChanges> &p_changes);
+
+    // Indexes of current notebooks.
+    QVector<QSharedPointer<VSearchIndex>> currentIndexes();
+
+    void startSearch(const QString &p_query);
+
+    // Load @p_index, or build it if there is no valid one on disk.
+    bool prepareIndex(const QSharedPointer<VSearchIndex> &p_index);
+
+    // Rebuild @p_indexes from scratch and fill m_indexStats.
+    bool buildIndexes(const QVector<QSharedPointer<VSearchIndex>> &p_indexes);
+
+    // Search @p_query in @p_indexes and fill the matched lines.
+    QVector<VSearchResult> searchIndexes(const QVector<QSharedPointer<VSearchIndex>> &p_indexes,
+                                         const QString &p_query);
+
+    // Fill the text of matched lines of @p_result.
+    static void fetchMatchedLines(VSearchResult &p_result);
+
+    // Notebook path -> index.
+    QHash<QString, QSharedPointer<VSearchIndex>> m_indexes;
+
+    // Protect m_indexes.
+    QMutex m_indexesMutex;
+
+    // Serialize loading and building of indexes.
+    QMutex m_buildMutex;
+
+    QFutureWatcher<QVector<VSearchResult>> *m_searchWatcher;
+    QFutureWatcher<bool> *m_indexWatcher;
+
+    // Query being searched.
+    QString m_query;
+
+    // Query to search after current one.
+    QString m_pendingQuery;
+
+    bool m_hasPendingQuery;
+
+    QElapsedTimer m_searchTimer;
+
+    QAtomicInt m_cancel;
+
+    QAtomicInt m_indexedCount;
+
+    // Statistics of last rebuild.
+    VNotebookScanner::Stats m_indexStats;
+
+    // Poll the indexing progress.
+    QTimer *m_progressTimer;
+
+    // Notebook path -> changes not committed yet.
+    QHash<QString, PendingChanges> m_pendingChanges;
+
+    // Batch the changes within an interval.
+    QTimer *m_commitTimer;
+
+    QFutureWatcher<void> *m_commitWatcher;
+
+    // Interval in msecs to commit changes.
+    static const int c_commitInterval;
+
+    // Max number of notes returned.
+    static const int c_maxResults;
+
+    // Max number of matched lines of one note to show.
+    static const int c_maxLinesPerNote;
+};
+
+#endif // VSEARCHENGINE_H
@@ -0,0 +1,917 @@
+#include "vsearchindex.h"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QCryptographicHash>
+#include <QSet>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QDebug>
+#include <algorithm>
+#include "vconfigmanager.h"
+#include "utils/vutils.h"
+#include "utils/vtokenizer.h"
+
+extern VConfigManager vconfig;
+
+const QString VSearchIndex::c_manifestFile = "manifest.json";
+
+const quint32 VSearchIndex::c_segmentMagic = 0x56534958;
+
+const quint32 VSearchIndex::c_segmentVersion = 1;
+
+const int VSearchIndex::c_maxSegments = 8;
+
+static void writeVarInt(QByteArray &p_data, quint32 p_val)
+{
+    while (p_val >= 0x80) {
+        p_data.append(char((p_val & 0x7F) | 0x80));
+        p_val >>= 7;
+    }
+
+    p_data.append(char(p_val));
+}
+
+static quint32 readVarInt(const char *&p_ptr, const char *p_end)
+{
+    quint32 val = 0;
+    int shift = 0;
+    while (p_ptr < p_end) {
+        uchar byte = (uchar)*p_ptr++;
+        val |= (quint32)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            break;
+        }
+
+        shift += 7;
+    }
+
+    return val;
+}
+
+// Returns the index of @p_term in sorted @p_terms, or -1.
+static int findTerm(const QStringList &p_terms, const QString &p_term)
+{
+    auto it = std::lower_bound(p_terms.begin(), p_terms.end(), p_term);
+    if (it != p_terms.end() && *it == p_term) {
+        return it - p_terms.begin();
+    }
+
+    return -1;
+}
+
+VSearchIndex::VSearchIndex(const QString &p_notebookPath, const QString &p_indexFolder)
+    : m_notebookPath(QDir::cleanPath(p_notebookPath)), m_indexFolder(p_indexFolder),
+      m_loaded(false), m_generation(0)
+{
+}
+
+bool VSearchIndex::load()
+{
+    QWriteLocker locker(&m_lock);
+
+    QFile file(QDir(m_indexFolder).filePath(c_manifestFile));
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QJsonObject manifest = QJsonDocument::fromJson(file.readAll()).object();
+    file.close();
+
+    if (manifest["version"].toInt() != (int)c_segmentVersion) {
+        qWarning() << "invalid search index manifest in" << m_indexFolder;
+        return false;
+    }
+
+    QVector<QSharedPointer<Segment>> segments;
+    QJsonArray segArray = manifest["segments"].toArray();
+    for (int i = 0; i < segArray.size(); ++i) {
+        QString fileName = segArray[i].toString();
+        QSharedPointer<Segment> seg = readSegment(QDir(m_indexFolder).filePath(fileName));
+        if (seg.isNull()) {
+            qWarning() << "fail to read search index segment" << fileName;
+            return false;
+        }
+
+        segments.append(seg);
+    }
+
+    QHash<QString, int> deleted;
+    QJsonObject delObj = manifest["deleted"].toObject();
+    for (auto it = delObj.begin(); it != delObj.end(); ++it) {
+        deleted.insert(it.key(), it.value().toInt());
+    }
+
+    m_segments = segments;
+    m_deleted = deleted;
+    m_generation = manifest["generation"].toInt();
+    m_loaded = true;
+    updateLiveDocs();
+
+    locker.unlock();
+
+    removeStaleSegmentFiles();
+
+    qDebug() << "search index loaded" << m_notebookPath << segments.size() << "segments";
+    return true;
+}
+
+bool VSearchIndex::rebuild(const QAtomicInt *p_cancel,
+                           QAtomicInt *p_progress,
+                           VNotebookScanner::Stats *p_stats)
+{
+    SegmentBuilder builder;
+    QMutex builderMutex;
+
+    // Tokenize in the scanner threads and only add the terms under lock.
+    VNotebookScanner::Stats stats = VNotebookScanner::scan(m_notebookPath,
+                                                           &VSearchIndex::isNote,
+                                                           [&](const VScannedNote &p_note) {
+        SegmentBuilder::DocTerms terms = SegmentBuilder::collectTerms(p_note.m_content);
+        QString path = relativePath(p_note.m_path);
+
+        QMutexLocker locker(&builderMutex);
+        builder.addDocument(path, p_note.m_modified, terms);
+        if (p_progress) {
+            p_progress->ref();
+        }
+    }, p_cancel);
+
+    if (p_stats) {
+        *p_stats = stats;
+    }
+
+    if (p_cancel && p_cancel->load()) {
+        return false;
+    }
+
+    int generation;
+    {
+        QReadLocker locker(&m_lock);
+        generation = m_generation + 1;
+    }
+
+    QSharedPointer<Segment> seg = builder.build(generation);
+    if (!VUtils::makePath(m_indexFolder)
+        || !writeSegment(QDir(m_indexFolder).filePath(seg->m_fileName), *seg)) {
+        qWarning() << "fail to write search index segment in" << m_indexFolder;
+        return false;
+    }
+
+    QVector<QSharedPointer<Segment>> segments;
+    segments.append(seg);
+
+    QWriteLocker locker(&m_lock);
+    if (!writeManifest(segments, QHash<QString, int>(), generation)) {
+        return false;
+    }
+
+    m_segments = segments;
+    m_deleted.clear();
+    m_generation = generation;
+    m_loaded = true;
+    updateLiveDocs();
+
+    locker.unlock();
+
+    removeStaleSegmentFiles();
+
+    qDebug() << "search index rebuilt" << m_notebookPath << seg->m_docs.size() << "notes"
+             << seg->m_terms.size() << "terms";
+    return true;
+}
+
+bool VSearchIndex::update(const QStringList &p_updated, const QStringList &p_removed)
+{
+    QStringList notes;
+    QStringList removed;
+    for (auto const &path : p_removed) {
+        removed.append(relativePath(path));
+    }
+
+    for (auto const &path : p_updated) {
+        QFileInfo info(path);
+        if (info.isDir()) {
+            notes += listNotes(path);
+        } else if (!info.exists()) {
+            removed.append(relativePath(path));
+        } else if (isNote(path)) {
+            notes.append(QDir::cleanPath(path));
+        }
+    }
+
+    notes.removeDuplicates();
+    if (notes.isEmpty() && removed.isEmpty()) {
+        return true;
+    }
+
+    SegmentBuilder builder;
+    for (auto const &note : notes) {
+        QFileInfo info(note);
+        builder.addDocument(relativePath(note),
+                            info.lastModified().toMSecsSinceEpoch(),
+                            VUtils::readFileFromDisk(note));
+    }
+
+    int generation;
+    {
+        QReadLocker locker(&m_lock);
+        generation = m_generation + 2;
+    }
+
+    // Deletions take the generation before the new segment, so a note removed
+    // and added again in one update stays live.
+    int delGeneration = generation - 1;
+
+    QSharedPointer<Segment> seg;
+    if (!builder.isEmpty()) {
+        seg = builder.build(generation);
+        if (!VUtils::makePath(m_indexFolder)
+            || !writeSegment(QDir(m_indexFolder).filePath(seg->m_fileName), *seg)) {
+            qWarning() << "fail to write search index segment in" << m_indexFolder;
+            return false;
+        }
+    }
+
+    QWriteLocker locker(&m_lock);
+    QVector<QSharedPointer<Segment>> segments = m_segments;
+    QHash<QString, int> deleted = m_deleted;
+    for (auto const &oldSeg : segments) {
+        for (auto const &doc : oldSeg->m_docs) {
+            for (auto const &path : removed) {
+                if (doc.m_path == path
+                    || (doc.m_path.startsWith(path) && doc.m_path.at(path.size()) == '/')) {
+                    deleted.insert(doc.m_path, delGeneration);
+                    break;
+                }
+            }
+        }
+    }
+
+    if (!seg.isNull()) {
+        segments.append(seg);
+    }
+
+    if (!writeManifest(segments, deleted, generation)) {
+        return false;
+    }
+
+    m_segments = segments;
+    m_deleted = deleted;
+    m_generation = generation;
+    updateLiveDocs();
+
+    bool needMerge = m_segments.size() > c_maxSegments;
+
+    locker.unlock();
+
+    qDebug() << "search index updated" << m_notebookPath << notes.size() << "notes"
+             << removed.size() << "removed";
+
+    if (needMerge) {
+        mergeSegments();
+    }
+
+    removeStaleSegmentFiles();
+    return true;
+}
+
+bool VSearchIndex::mergeSegments()
+{
+    QSharedPointer<Segment> merged;
+    int generation;
+    {
+        QReadLocker locker(&m_lock);
+        generation = m_generation + 1;
+
+        // Map documents of each segment to the merged one.
+        SegmentBuilder builder;
+        QVector<QVector<int>> docMaps(m_segments.size());
+        for (int si = 0; si < m_segments.size(); ++si) {
+            const Segment &seg = *m_segments[si];
+            QVector<int> &docMap = docMaps[si];
+            docMap.fill(-1, seg.m_docs.size());
+            for (int i = 0; i < seg.m_docs.size(); ++i) {
+                if (m_liveDocs[si][i]) {
+                    docMap[i] = builder.addDocInfo(seg.m_docs[i]);
+                }
+            }
+        }
+
+        // Documents of later segments have larger indexes, so postings of
+        // a term are added in increasing order of documents.
+        for (int si = 0; si < m_segments.size(); ++si) {
+            const Segment &seg = *m_segments[si];
+            const QVector<int> &docMap = docMaps[si];
+            for (int ti = 0; ti < seg.m_terms.size(); ++ti) {
+                QVector<Posting> postings = decodePostings(seg.m_postings[ti]);
+                for (auto const &posting : postings) {
+                    int doc = docMap[posting.m_doc];
+                    if (doc != -1) {
+                        builder.addPosting(seg.m_terms[ti], doc,
+                                           posting.m_positions, posting.m_lines);
+                    }
+                }
+            }
+        }
+
+        merged = builder.build(generation);
+    }
+
+    if (!writeSegment(QDir(m_indexFolder).filePath(merged->m_fileName), *merged)) {
+        qWarning() << "fail to write merged search index segment in" << m_indexFolder;
+        return false;
+    }
+
+    QVector<QSharedPointer<Segment>> segments;
+    segments.append(merged);
+
+    QWriteLocker locker(&m_lock);
+    if (!writeManifest(segments, QHash<QString, int>(), generation)) {
+        return false;
+    }
+
+    m_segments = segments;
+    m_deleted.clear();
+    m_generation = generation;
+    updateLiveDocs();
+
+    qDebug() << "search index segments merged" << m_notebookPath << merged->m_docs.size() << "notes";
+    return true;
+}
+
+bool VSearchIndex::isLoaded() const
+{
+    QReadLocker locker(&m_lock);
+    return m_loaded;
+}
+
+const QString &VSearchIndex::getNotebookPath() const
+{
+    return m_notebookPath;
+}
+
+QVector<VSearchResult> VSearchIndex::search(const QString &p_query, int p_maxResults) const
+{
+    QVector<VSearchResult> results;
+    QVector<QVector<Clause>> groups = parseQuery(p_query);
+    if (groups.isEmpty()) {
+        return results;
+    }
+
+    // Relative path -> matched lines.
+    QHash<QString, QVector<int>> matched;
+
+    QReadLocker locker(&m_lock);
+    for (int si = 0; si < m_segments.size(); ++si) {
+        const Segment &seg = *m_segments[si];
+        DocMatches segMatches;
+        for (auto const &group : groups) {
+            DocMatches groupMatches;
+            bool hasPositive = false;
+            for (auto const &clause : group) {
+                if (clause.m_isNegative) {
+                    continue;
+                }
+
+                DocMatches clauseMatches = evaluateClause(seg, clause);
+                if (!hasPositive) {
+                    groupMatches = clauseMatches;
+                    hasPositive = true;
+                } else {
+                    for (auto it = groupMatches.begin(); it != groupMatches.end();) {
+                        auto cit = clauseMatches.find(it.key());
+                        if (cit == clauseMatches.end()) {
+                            it = groupMatches.erase(it);
+                        } else {
+                            it.value() += cit.value();
+                            ++it;
+                        }
+                    }
+                }
+
+                if (groupMatches.isEmpty()) {
+                    break;
+                }
+            }
+
+            if (!hasPositive || groupMatches.isEmpty()) {
+                continue;
+            }
+
+            for (auto const &clause : group) {
+                if (!clause.m_isNegative) {
+                    continue;
+                }
+
+                DocMatches clauseMatches = evaluateClause(seg, clause);
+                for (auto it = clauseMatches.begin(); it != clauseMatches.end(); ++it) {
+                    groupMatches.remove(it.key());
+                }
+            }
+
+            for (auto it = groupMatches.begin(); it != groupMatches.end(); ++it) {
+                segMatches[it.key()] += it.value();
+            }
+        }
+
+        const QVector<bool> &live = m_liveDocs[si];
+        for (auto it = segMatches.begin(); it != segMatches.end(); ++it) {
+            if (live[it.key()]) {
+                matched[seg.m_docs[it.key()].m_path] += it.value();
+            }
+        }
+    }
+
+    locker.unlock();
+
+    results.reserve(matched.size());
+    for (auto it = matched.begin(); it != matched.end(); ++it) {
+        QVector<int> &lines = it.value();
+        std::sort(lines.begin(), lines.end());
+        lines.erase(std::unique(lines.begin(), lines.end()), lines.end());
+
+        VSearchResult result;
+        result.m_notebookPath = m_notebookPath;
+        result.m_filePath = absolutePath(it.key());
+        result.m_matches.reserve(lines.size());
+        for (int line : lines) {
+            result.m_matches.append(VSearchMatch(line, QString()));
+        }
+
+        results.append(result);
+    }
+
+    // Notes with more matched lines first.
+    std::sort(results.begin(), results.end(),
+              [](const VSearchResult &p_a, const VSearchResult &p_b) {
+                  if (p_a.m_matches.size() != p_b.m_matches.size()) {
+                      return p_a.m_matches.size() > p_b.m_matches.size();
+                  }
+
+                  return p_a.m_filePath < p_b.m_filePath;
+              });
+
+    if (p_maxResults > 0 && results.size() > p_maxResults) {
+        results.resize(p_maxResults);
+    }
+
+    return results;
+}
+
+QVector<QVector<VSearchIndex::Clause>> VSearchIndex::parseQuery(const QString &p_query)
+{
+    QVector<QVector<Clause>> groups(1);
+    int size = p_query.size();
+    int i = 0;
+    while (i < size) {
+        if (p_query[i].isSpace()) {
+            ++i;
+            continue;
+        }
+
+        bool negative = false;
+        if (p_query[i] == '-' && i + 1 < size && !p_query[i + 1].isSpace()) {
+            negative = true;
+            ++i;
+        }
+
+        QString word;
+        bool quoted = false;
+        if (p_query[i] == '"') {
+            int end = p_query.indexOf('"', i + 1);
+            if (end == -1) {
+                end = size;
+            }
+
+            word = p_query.mid(i + 1, end - i - 1);
+            i = end + 1;
+            quoted = true;
+        } else {
+            int start = i;
+            while (i < size && !p_query[i].isSpace()) {
+                ++i;
+            }
+
+            word = p_query.mid(start, i - start);
+        }
+
+        if (!quoted && !negative && word == "OR") {
+            if (!groups.last().isEmpty()) {
+                groups.append(QVector<Clause>());
+            }
+
+            continue;
+        }
+
+        Clause clause;
+        clause.m_isNegative = negative;
+        if (!quoted && word.endsWith('*')) {
+            word.chop(1);
+            clause.m_isPrefix = true;
+        }
+
+        QVector<VToken> tokens = VTokenizer::tokenizeQuery(word);
+        if (tokens.isEmpty()) {
+            continue;
+        }
+
+        // Prefix of a phrase is not supported.
+        if (tokens.size() > 1) {
+            clause.m_isPrefix = false;
+        }
+
+        for (auto const &token : tokens) {
+            clause.m_terms.append(token.m_term);
+            clause.m_offsets.append(token.m_position - tokens[0].m_position);
+        }
+
+        groups.last().append(clause);
+    }
+
+    if (groups.last().isEmpty()) {
+        groups.removeLast();
+    }
+
+    return groups;
+}
+
+QVector<VSearchIndex::Posting> VSearchIndex::decodePostings(const QByteArray &p_data)
+{
+    QVector<Posting> postings;
+    const char *ptr = p_data.constData();
+    const char *end = ptr + p_data.size();
+    int doc = -1;
+    while (ptr < end) {
+        Posting posting;
+        doc += readVarInt(ptr, end);
+        posting.m_doc = doc;
+
+        int freq = readVarInt(ptr, end);
+        posting.m_positions.reserve(freq);
+        posting.m_lines.reserve(freq);
+        int pos = 0;
+        int line = 0;
+        for (int i = 0; i < freq; ++i) {
+            pos += readVarInt(ptr, end);
+            line += readVarInt(ptr, end);
+            posting.m_positions.append(pos);
+            posting.m_lines.append(line);
+        }
+
+        postings.append(posting);
+    }
+
+    return postings;
+}
+
+VSearchIndex::DocMatches VSearchIndex::evaluateClause(const Segment &p_segment,
+                                                      const Clause &p_clause)
+{
+    DocMatches matches;
+    if (p_clause.m_terms.isEmpty()) {
+        return matches;
+    }
+
+    const QStringList &terms = p_segment.m_terms;
+    if (p_clause.m_isPrefix) {
+        const QString &prefix = p_clause.m_terms[0];
+        auto it = std::lower_bound(terms.begin(), terms.end(), prefix);
+        for (; it != terms.end() && it->startsWith(prefix); ++it) {
+            QVector<Posting> postings = decodePostings(p_segment.m_postings[it - terms.begin()]);
+            for (auto const &posting : postings) {
+                matches[posting.m_doc] += posting.m_lines;
+            }
+        }
+
+        return matches;
+    }
+
+    // Postings of each term of the phrase.
+    QVector<QHash<int, Posting>> termPostings;
+    for (auto const &term : p_clause.m_terms) {
+        int idx = findTerm(terms, term);
+        if (idx == -1) {
+            return matches;
+        }
+
+        QHash<int, Posting> docPostings;
+        QVector<Posting> postings = decodePostings(p_segment.m_postings[idx]);
+        for (auto const &posting : postings) {
+            docPostings.insert(posting.m_doc, posting);
+        }
+
+        termPostings.append(docPostings);
+    }
+
+    const QHash<int, Posting> &first = termPostings[0];
+    for (auto it = first.begin(); it != first.end(); ++it) {
+        int doc = it.key();
+        if (termPostings.size() == 1) {
+            matches[doc] = it.value().m_lines;
+            continue;
+        }
+
+        bool allContain = true;
+        for (int i = 1; i < termPostings.size(); ++i) {
+            if (!termPostings[i].contains(doc)) {
+                allContain = false;
+                break;
+            }
+        }
+
+        if (!allContain) {
+            continue;
+        }
+
+        const Posting &posting = it.value();
+        for (int k = 0; k < posting.m_positions.size(); ++k) {
+            int pos = posting.m_positions[k];
+            bool found = true;
+            for (int i = 1; i < termPostings.size(); ++i) {
+                const QVector<int> &positions = termPostings[i][doc].m_positions;
+                if (!std::binary_search(positions.begin(), positions.end(),
+                                        pos + p_clause.m_offsets[i])) {
+                    found = false;
+                    break;
+                }
+            }
+
+            if (found) {
+                matches[doc].append(posting.m_lines[k]);
+            }
+        }
+    }
+
+    return matches;
+}
+
+bool VSearchIndex::writeSegment(const QString &p_filePath, const Segment &p_segment)
+{
+    QSaveFile file(p_filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_0);
+    out << c_segmentMagic << c_segmentVersion << (qint32)p_segment.m_generation;
+
+    out << (qint32)p_segment.m_docs.size();
+    for (auto const &doc : p_segment.m_docs) {
+        out << doc.m_path << doc.m_modified;
+    }
+
+    out << (qint32)p_segment.m_terms.size();
+    for (int i = 0; i < p_segment.m_terms.size(); ++i) {
+        out << p_segment.m_terms[i] << p_segment.m_postings[i];
+    }
+
+    if (out.status() != QDataStream::Ok) {
+        file.cancelWriting();
+        return false;
+    }
+
+    return file.commit();
+}
+
+QSharedPointer<VSearchIndex::Segment> VSearchIndex::readSegment(const QString &p_filePath)
+{
+    QSharedPointer<Segment> seg;
+    QFile file(p_filePath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return seg;
+    }
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_0);
+
+    quint32 magic, version;
+    qint32 generation, docCount, termCount;
+    in >> magic >> version >> generation;
+    if (magic != c_segmentMagic || version != c_segmentVersion) {
+        return seg;
+    }
+
+    seg.reset(new Segment());
+    seg->m_generation = generation;
+    seg->m_fileName = QFileInfo(p_filePath).fileName();
+
+    in >> docCount;
+    seg->m_docs.resize(qMax(docCount, 0));
+    for (int i = 0; i < seg->m_docs.size(); ++i) {
+        in >> seg->m_docs[i].m_path >> seg->m_docs[i].m_modified;
+    }
+
+    in >> termCount;
+    seg->m_terms.reserve(qMax(termCount, 0));
+    seg->m_postings.resize(qMax(termCount, 0));
+    for (int i = 0; i < seg->m_postings.size(); ++i) {
+        QString term;
+        in >> term >> seg->m_postings[i];
+        seg->m_terms.append(term);
+    }
+
+    if (in.status() != QDataStream::Ok) {
+        seg.clear();
+    }
+
+    return seg;
+}
+
+bool VSearchIndex::writeManifest(const QVector<QSharedPointer<Segment>> &p_segments,
+                                 const QHash<QString, int> &p_deleted,
+                                 int p_generation) const
+{
+    QJsonArray segArray;
+    for (auto const &seg : p_segments) {
+        segArray.append(seg->m_fileName);
+    }
+
+    QJsonObject delObj;
+    for (auto it = p_deleted.begin(); it != p_deleted.end(); ++it) {
+        delObj[it.key()] = it.value();
+    }
+
+    QJsonObject manifest;
+    manifest["version"] = (int)c_segmentVersion;
+    manifest["generation"] = p_generation;
+    manifest["segments"] = segArray;
+    manifest["deleted"] = delObj;
+
+    QSaveFile file(QDir(m_indexFolder).filePath(c_manifestFile));
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "fail to open search index manifest to write" << file.fileName();
+        return false;
+    }
+
+    file.write(QJsonDocument(manifest).toJson(QJsonDocument::Compact));
+    return file.commit();
+}
+
+void VSearchIndex::updateLiveDocs()
+{
+    // Only the newest version of a document is live.
+    QHash<QString, int> newest;
+    for (auto const &seg : m_segments) {
+        for (auto const &doc : seg->m_docs) {
+            int &gen = newest[doc.m_path];
+            gen = qMax(gen, seg->m_generation);
+        }
+    }
+
+    m_liveDocs.resize(m_segments.size());
+    for (int si = 0; si < m_segments.size(); ++si) {
+        const Segment &seg = *m_segments[si];
+        QVector<bool> &live = m_liveDocs[si];
+        live.resize(seg.m_docs.size());
+        for (int i = 0; i < seg.m_docs.size(); ++i) {
+            const QString &path = seg.m_docs[i].m_path;
+            live[i] = newest.value(path) == seg.m_generation
+                      && m_deleted.value(path, -1) < seg.m_generation;
+        }
+    }
+}
+
+void VSearchIndex::removeStaleSegmentFiles() const
+{
+    QSet<QString> files;
+    {
+        QReadLocker locker(&m_lock);
+        for (auto const &seg : m_segments) {
+            files.insert(seg->m_fileName);
+        }
+    }
+
+    QDir dir(m_indexFolder);
+    QStringList segFiles = dir.entryList(QStringList() << "*.vsi", QDir::Files);
+    for (auto const &file : segFiles) {
+        if (!files.contains(file)) {
+            dir.remove(file);
+        }
+    }
+}
+
+QString VSearchIndex::relativePath(const QString &p_filePath) const
+{
+    return QDir(m_notebookPath).relativeFilePath(p_filePath);
+}
+
+QString VSearchIndex::absolutePath(const QString &p_relativePath) const
+{
+    return QDir::cleanPath(QDir(m_notebookPath).filePath(p_relativePath));
+}
+
+QStringList VSearchIndex::listNotes(const QString &p_path)
+{
+    QStringList notes;
+    QDirIterator it(p_path,
+                    QStringList() << "*.md" << "*.markdown" << "*.mkd",
+                    QDir::Files | QDir::NoSymLinks,
+                    QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        notes.append(QDir::cleanPath(it.next()));
+    }
+
+    return notes;
+}
+
+bool VSearchIndex::isNote(const QString &p_path)
+{
+    QString suffix = QFileInfo(p_path).suffix().toLower();
+    return suffix == "md" || suffix == "markdown" || suffix == "mkd";
+}
+
+QString VSearchIndex::indexFolderOfNotebook(const QString &p_notebookPath)
+{
+    QByteArray hash = QCryptographicHash::hash(QDir::cleanPath(p_notebookPath).toUtf8(),
+                                               QCryptographicHash::Md5).toHex();
+    return QDir(vconfig.getConfigFolder()).filePath("search_index/" + QString::fromLatin1(hash));
+}
+
+void VSearchIndex::SegmentBuilder::addDocument(const QString &p_path,
+                                               qint64 p_modified,
+                                               const QString &p_text)
+{
+    addDocument(p_path, p_modified, collectTerms(p_text));
+}
+
+VSearchIndex::SegmentBuilder::DocTerms VSearchIndex::SegmentBuilder::collectTerms(const QString &p_text)
+{
+    DocTerms terms;
+    QVector<VToken> tokens = VTokenizer::tokenize(p_text);
+    for (auto const &token : tokens) {
+        auto &val = terms[token.m_term];
+        val.first.append(token.m_position);
+        val.second.append(token.m_line);
+    }
+
+    return terms;
+}
+
+void VSearchIndex::SegmentBuilder::addDocument(const QString &p_path,
+                                               qint64 p_modified,
+                                               const DocTerms &p_terms)
+{
+    int docIdx = addDocInfo(DocInfo(p_path, p_modified));
+    for (auto it = p_terms.begin(); it != p_terms.end(); ++it) {
+        addPosting(it.key(), docIdx, it.value().first, it.value().second);
+    }
+}
+
+int VSearchIndex::SegmentBuilder::addDocInfo(const DocInfo &p_doc)
+{
+    m_docs.append(p_doc);
+    return m_docs.size() - 1;
+}
+
+void VSearchIndex::SegmentBuilder::addPosting(const QString &p_term, int p_doc,
+                                              const QVector<int> &p_positions,
+                                              const QVector<int> &p_lines)
+{
+    Q_ASSERT(p_positions.size() == p_lines.size());
+    TermBuffer &buf = m_terms[p_term];
+    Q_ASSERT(p_doc > buf.m_lastDoc);
+    writeVarInt(buf.m_data, p_doc - buf.m_lastDoc);
+    buf.m_lastDoc = p_doc;
+
+    writeVarInt(buf.m_data, p_positions.size());
+    int lastPos = 0;
+    int lastLine = 0;
+    for (int i = 0; i < p_positions.size(); ++i) {
+        writeVarInt(buf.m_data, p_positions[i] - lastPos);
+        writeVarInt(buf.m_data, p_lines[i] - lastLine);
+        lastPos = p_positions[i];
+        lastLine = p_lines[i];
+    }
+}
+
+bool VSearchIndex::SegmentBuilder::isEmpty() const
+{
+    return m_docs.isEmpty();
+}
+
+QSharedPointer<VSearchIndex::Segment> VSearchIndex::SegmentBuilder::build(int p_generation)
+{
+    QSharedPointer<Segment> seg(new Segment());
+    seg->m_generation = p_generation;
+    seg->m_fileName = QString("seg_%1.vsi").arg(p_generation);
+    seg->m_docs = m_docs;
+
+    seg->m_terms = m_terms.keys();
+    std::sort(seg->m_terms.begin(), seg->m_terms.end());
+    seg->m_postings.reserve(seg->m_terms.size());
+    for (auto const &term : seg->m_terms) {
+        seg->m_postings.append(m_terms.value(term).m_data);
+    }
+
+    return seg;
+}
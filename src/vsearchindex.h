@@ -0,0 +1,272 @@
+#ifndef VSEARCHINDEX_H
+#define VSEARCHINDEX_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QHash>
+#include <QMap>
+#include <QByteArray>
+#include <QSharedPointer>
+#include <QReadWriteLock>
+#include <QAtomicInt>
+#include <QPair>
+#include "vnotebookscanner.h"
+
+// One matched line of a note.
+struct VSearchMatch
+{
+    VSearchMatch() : m_lineNumber(-1)
+    {
+    }
+
+    VSearchMatch(int p_lineNumber, const QString &p_text)
+        : m_lineNumber(p_lineNumber), m_text(p_text)
+    {
+    }
+
+    // Based on 0.
+    int m_lineNumber;
+
+    QString m_text;
+};
+
+// Search result of one note.
+struct VSearchResult
+{
+    // Path of the notebook the note belongs to.
+    QString m_notebookPath;
+
+    // Absolute path of the note.
+    QString m_filePath;
+
+    QVector<VSearchMatch> m_matches;
+};
+
+// Full-text search index of the Markdown notes of a notebook.
+// The index consists of immutable segment files with positional postings
+// and a manifest listing the live segments. Both are written atomically,
+// so a crash leaves either the old or the new index on disk.
+// Changes are added as new segments, and notes in older segments are
+// shadowed or marked deleted. Segments are merged when there are too many.
+// Searching is thread-safe. Calls to load(), rebuild() and update() should
+// be serialized by the caller.
+class VSearchIndex
+{
+public:
+    // @p_notebookPath: root folder of the notebook.
+    // @p_indexFolder: folder to store the index files.
+    VSearchIndex(const QString &p_notebookPath, const QString &p_indexFolder);
+
+    // Load the index from disk.
+    // Returns false if there is no valid index.
+    bool load();
+
+    // Build the index of all the notes of the notebook from scratch and
+    // replace current one. Notes are read and tokenized in parallel.
+    // @p_cancel: stop building if it becomes non-zero.
+    // @p_progress: updated with the number of notes indexed.
+    // @p_stats: filled with the statistics of the scan.
+    // Returns false if it fails or is cancelled.
+    bool rebuild(const QAtomicInt *p_cancel = NULL,
+                 QAtomicInt *p_progress = NULL,
+                 VNotebookScanner::Stats *p_stats = NULL);
+
+    // Update the index incrementally with a new segment.
+    // @p_updated: absolute paths of notes or directories which are added or
+    // modified. Non-existing ones are treated as removed.
+    // @p_removed: absolute paths of notes or directories which are removed.
+    // Returns false if it fails.
+    bool update(const QStringList &p_updated, const QStringList &p_removed);
+
+    // Search @p_query.
+    // Supported syntax:
+    // - word: notes containing the word;
+    // - "some phrase": notes containing the words in sequence;
+    // - pref*: notes containing words starting with pref;
+    // - -word: notes not containing the word;
+    // - a b OR c: (a AND b) OR c.
+    // Returns at most @p_maxResults results with matched line numbers.
+    QVector<VSearchResult> search(const QString &p_query, int p_maxResults) const;
+
+    bool isLoaded() const;
+
+    const QString &getNotebookPath() const;
+
+    // List all the Markdown notes within folder @p_path on disk.
+    static QStringList listNotes(const QString &p_path);
+
+    // Whether @p_path is a Markdown note to index.
+    static bool isNote(const QString &p_path);
+
+    // Get the default index folder of notebook @p_notebookPath.
+    static QString indexFolderOfNotebook(const QString &p_notebookPath);
+
+private:
+    struct DocInfo
+    {
+        DocInfo() : m_modified(0)
+        {
+        }
+
+        DocInfo(const QString &p_path, qint64 p_modified)
+            : m_path(p_path), m_modified(p_modified)
+        {
+        }
+
+        // Path relative to the notebook root.
+        QString m_path;
+
+        // Last modified time in msecs since epoch.
+        qint64 m_modified;
+    };
+
+    // Immutable segment of the index.
+    struct Segment
+    {
+        Segment() : m_generation(0)
+        {
+        }
+
+        int m_generation;
+
+        QString m_fileName;
+
+        QVector<DocInfo> m_docs;
+
+        // Sorted terms and their encoded postings.
+        QStringList m_terms;
+        QVector<QByteArray> m_postings;
+    };
+
+    // Positions and lines of one term within one document.
+    struct Posting
+    {
+        int m_doc;
+        QVector<int> m_positions;
+        QVector<int> m_lines;
+    };
+
+    // Query clause.
+    struct Clause
+    {
+        Clause() : m_isPrefix(false), m_isNegative(false)
+        {
+        }
+
+        // Terms with their relative positions.
+        // More than one term means a phrase.
+        QStringList m_terms;
+        QVector<int> m_offsets;
+
+        bool m_isPrefix;
+        bool m_isNegative;
+    };
+
+    // Documents matched within a segment: doc index -> matched lines.
+    typedef QMap<int, QVector<int>> DocMatches;
+
+    // Build the segment from the collected documents.
+    class SegmentBuilder
+    {
+    public:
+        // Term -> positions and lines of its tokens in a document.
+        typedef QHash<QString, QPair<QVector<int>, QVector<int>>> DocTerms;
+
+        // Tokenize @p_text. Could be called from any thread.
+        static DocTerms collectTerms(const QString &p_text);
+
+        void addDocument(const QString &p_path, qint64 p_modified, const QString &p_text);
+
+        void addDocument(const QString &p_path, qint64 p_modified, const DocTerms &p_terms);
+
+        // Add a document without its terms.
+        // Returns the index of the document.
+        int addDocInfo(const DocInfo &p_doc);
+
+        // Add the postings of @p_term in document @p_doc.
+        // Should be called in increasing order of @p_doc for one term.
+        void addPosting(const QString &p_term, int p_doc,
+                        const QVector<int> &p_positions,
+                        const QVector<int> &p_lines);
+
+        bool isEmpty() const;
+
+        QSharedPointer<Segment> build(int p_generation);
+
+    private:
+        struct TermBuffer
+        {
+            TermBuffer() : m_lastDoc(-1)
+            {
+            }
+
+            QByteArray m_data;
+            int m_lastDoc;
+        };
+
+        QVector<DocInfo> m_docs;
+        QHash<QString, TermBuffer> m_terms;
+    };
+
+    // Parse @p_query into groups of clauses, which are ORed.
+    static QVector<QVector<Clause>> parseQuery(const QString &p_query);
+
+    static QVector<Posting> decodePostings(const QByteArray &p_data);
+
+    // Evaluate @p_clause within @p_segment.
+    static DocMatches evaluateClause(const Segment &p_segment, const Clause &p_clause);
+
+    static bool writeSegment(const QString &p_filePath, const Segment &p_segment);
+
+    static QSharedPointer<Segment> readSegment(const QString &p_filePath);
+
+    bool writeManifest(const QVector<QSharedPointer<Segment>> &p_segments,
+                       const QHash<QString, int> &p_deleted,
+                       int p_generation) const;
+
+    // Merge all the segments into one containing only live documents.
+    bool mergeSegments();
+
+    // Compute the live documents of @p_segments.
+    // Should be called with write lock held.
+    void updateLiveDocs();
+
+    // Remove segment files not listed in the manifest.
+    void removeStaleSegmentFiles() const;
+
+    QString relativePath(const QString &p_filePath) const;
+
+    QString absolutePath(const QString &p_relativePath) const;
+
+    QString m_notebookPath;
+
+    QString m_indexFolder;
+
+    mutable QReadWriteLock m_lock;
+
+    bool m_loaded;
+
+    // The latest generation.
+    int m_generation;
+
+    // Ordered from old to new.
+    QVector<QSharedPointer<Segment>> m_segments;
+
+    // Deleted documents: relative path -> generation of the deletion.
+    QHash<QString, int> m_deleted;
+
+    // Whether a document in a segment is live, indexed as m_segments.
+    QVector<QVector<bool>> m_liveDocs;
+
+    static const QString c_manifestFile;
+
+    static const quint32 c_segmentMagic;
+
+    static const quint32 c_segmentVersion;
+
+    // Merge segments if there are more than this.
+    static const int c_maxSegments;
+};
+
+#endif // VSEARCHINDEX_H
@@ -17,9 +17,20 @@ void VTabIndicator::setupUI()
     m_readonlyLabel = new QLabel(tr("<span style=\"font-weight:bold; color:red;\">ReadOnly</span>"),
                                  this);
     m_cursorLabel = new QLabel(this);
+    m_undoLabel = new QLabel(this);
+    m_undoLabel->setToolTip(tr("Undo steps kept for current note and the memory they use"));
+    m_undoLabel->hide();
+    m_largeFileLabel = new QLabel(tr("<span style=\"font-weight:bold; color:red;\">LargeFile</span>"),
+                                  this);
+    m_largeFileLabel->setToolTip(tr("Large file mode: image preview is disabled, only the text "
+                                    "around the viewport is highlighted and the outline is "
+                                    "updated on saving"));
+    m_largeFileLabel->hide();
 
     QHBoxLayout *mainLayout = new QHBoxLayout(this);
     mainLayout->addWidget(m_cursorLabel);
+    mainLayout->addWidget(m_undoLabel);
+    mainLayout->addWidget(m_largeFileLabel);
     mainLayout->addWidget(m_readonlyLabel);
     mainLayout->addWidget(m_docTypeLabel);
     mainLayout->setContentsMargins(0, 0, 0, 0);
@@ -62,6 +73,8 @@ void VTabIndicator::update(const VEditTabInfo &p_info)
     const VFile *file = NULL;
     DocType docType = DocType::Html;
     bool readonly = true;
+    bool largeFile = false;
+    bool showUndo = false;
     QString cursorStr;
 
     if (p_info.m_editTab)
@@ -87,6 +100,15 @@ void VTabIndicator::update(const VEditTabInfo &p_info)
                                    .arg(col, 3);
             m_cursorLabel->setText(cursorText);
             m_cursorLabel->show();
+
+            largeFile = p_info.m_largeFile;
+
+            if (p_info.m_undoSteps >= 0) {
+                m_undoLabel->setText(tr("Undo: %1 (%2 KB)")
+                                       .arg(p_info.m_undoSteps)
+                                       .arg((p_info.m_undoBytes + 1023) / 1024));
+                showUndo = true;
+            }
         } else {
             m_cursorLabel->hide();
         }
@@ -94,4 +116,6 @@ void VTabIndicator::update(const VEditTabInfo &p_info)
 
     m_docTypeLabel->setText(docTypeToString(docType));
     m_readonlyLabel->setVisible(readonly);
+    m_largeFileLabel->setVisible(largeFile);
+    m_undoLabel->setVisible(showUndo);
 }
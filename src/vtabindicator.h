@@ -27,6 +27,12 @@ private:
 
     // Indicate the position of current cursor.
     QLabel *m_cursorLabel;
+
+    // Indicate the footprint of the undo history.
+    QLabel *m_undoLabel;
+
+    // Indicate the large file mode.
+    QLabel *m_largeFileLabel;
 };
 
 #endif // VTABINDICATOR_H
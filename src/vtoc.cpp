@@ -1,6 +1,6 @@
 #include "vtoc.h"
 
 VToc::VToc()
-    : type(VHeaderType::Anchor), valid(false)
+    : type(VHeaderType::Anchor), valid(false), m_samePrefix(0), m_sameSuffix(0)
 {
 }
@@ -25,6 +25,15 @@ struct VHeader
     // Index in the outline, based on 0.
     int index;
 
+    bool operator==(const VHeader &p_header) const
+    {
+        return level == p_header.level
+               && name == p_header.name
+               && anchor == p_header.anchor
+               && lineNumber == p_header.lineNumber
+               && index == p_header.index;
+    }
+
     // Whether it is an empty (fake) header.
     bool isEmpty() const
     {
@@ -73,6 +82,12 @@ public:
     int type;
     const VFile *m_file;
     bool valid;
+
+    // The first @m_samePrefix and the last @m_sameSuffix headers are known to
+    // be the same as the last outline of the same file, except the line numbers.
+    // Used to patch the outline tree.
+    int m_samePrefix;
+    int m_sameSuffix;
 };
 
 #endif // VTOC_H
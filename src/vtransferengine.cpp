@@ -0,0 +1,475 @@
+#include "vtransferengine.h"
+
+#include <QtConcurrent>
+#include <QThreadPool>
+#include <QTimer>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QDebug>
+#include "vconfigmanager.h"
+#include "utils/vutils.h"
+
+#if defined(Q_OS_LINUX)
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <linux/fs.h>
+#endif
+
+const int VTransferEngine::c_maxParallelCopies = 4;
+
+// Bytes copied in one step, between which the cancellation is checked.
+static const qint64 c_copyChunkSize = 1024 * 1024;
+
+VTransferJob::VTransferJob(const QString &p_title, const QVector<VTransferItem> &p_items,
+                           QObject *p_parent)
+    : QObject(p_parent), m_title(p_title), m_items(p_items), m_cancelled(0),
+      m_doneBytes(0), m_totalBytes(0)
+{
+}
+
+const QString &VTransferJob::getTitle() const
+{
+    return m_title;
+}
+
+const QVector<VTransferItem> &VTransferJob::getItems() const
+{
+    return m_items;
+}
+
+void VTransferJob::cancel()
+{
+    m_cancelled.store(1);
+}
+
+bool VTransferJob::isCancelled() const
+{
+    return m_cancelled.load();
+}
+
+const QString &VTransferJob::getErrorString() const
+{
+    return m_errorString;
+}
+
+VTransferEngine::VTransferEngine(QObject *p_parent)
+    : QObject(p_parent)
+{
+    m_jobWatcher = new QFutureWatcher<bool>(this);
+    connect(m_jobWatcher, &QFutureWatcher<bool>::finished,
+            this, &VTransferEngine::handleJobFinished);
+
+    m_progressTimer = new QTimer(this);
+    m_progressTimer->setInterval(200);
+    connect(m_progressTimer, &QTimer::timeout,
+            this, &VTransferEngine::updateProgress);
+
+    m_copyPool = new QThreadPool(this);
+    m_copyPool->setMaxThreadCount(c_maxParallelCopies);
+}
+
+VTransferEngine::~VTransferEngine()
+{
+    for (auto const &job : m_jobs) {
+        if (job) {
+            job->cancel();
+        }
+    }
+
+    if (m_currentJob) {
+        m_currentJob->cancel();
+    }
+
+    m_jobWatcher->waitForFinished();
+}
+
+VTransferJob *VTransferEngine::addJob(const QString &p_title, const QVector<VTransferItem> &p_items)
+{
+    VTransferJob *job = new VTransferJob(p_title, p_items, this);
+    m_jobs.enqueue(job);
+    emit jobAdded(job);
+
+    if (!isBusy()) {
+        startNextJob();
+    }
+
+    return job;
+}
+
+bool VTransferEngine::isBusy() const
+{
+    return !m_currentJob.isNull();
+}
+
+QVector<const VTransferJob *> VTransferEngine::pendingJobs() const
+{
+    QVector<const VTransferJob *> jobs;
+    if (m_currentJob) {
+        jobs.append(m_currentJob.data());
+    }
+
+    for (auto const &job : m_jobs) {
+        if (job) {
+            jobs.append(job.data());
+        }
+    }
+
+    return jobs;
+}
+
+QStringList VTransferEngine::reservedNames(const QString &p_dirPath) const
+{
+    QStringList names;
+    QString dirPath = QDir::cleanPath(p_dirPath);
+    for (auto job : pendingJobs()) {
+        for (auto const &item : job->getItems()) {
+            if (VUtils::basePathFromPath(item.m_destPath) == dirPath) {
+                names.append(VUtils::fileNameFromPath(item.m_destPath));
+            }
+        }
+    }
+
+    return names;
+}
+
+// Whether @p_path is @p_dir or within it.
+static bool isPathWithin(const QString &p_path, const QString &p_dir)
+{
+    return p_path == p_dir || p_path.startsWith(p_dir + "/");
+}
+
+bool VTransferEngine::isInvolved(const QString &p_path) const
+{
+    QString path = QDir::cleanPath(p_path);
+    for (auto job : pendingJobs()) {
+        for (auto const &item : job->getItems()) {
+            QString srcPath = QDir::cleanPath(item.m_srcPath);
+            QString destPath = QDir::cleanPath(item.m_destPath);
+            if (isPathWithin(path, srcPath) || isPathWithin(srcPath, path)
+                || isPathWithin(path, destPath) || isPathWithin(destPath, path)) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+bool VTransferEngine::revert(const VTransferJob *p_job)
+{
+    bool ret = true;
+    const QVector<VTransferItem> &items = p_job->getItems();
+    for (int i = items.size() - 1; i >= 0; --i) {
+        const VTransferItem &item = items[i];
+        bool isDir = QFileInfo(item.m_destPath).isDir();
+        bool reverted;
+        if (item.m_cut) {
+            reverted = isDir ? VUtils::copyDirectory(item.m_destPath, item.m_srcPath, true)
+                             : VUtils::copyFile(item.m_destPath, item.m_srcPath, true);
+        } else {
+            reverted = isDir ? QDir(item.m_destPath).removeRecursively()
+                             : QFile::remove(item.m_destPath);
+        }
+
+        if (!reverted) {
+            qWarning() << "fail to revert the transfer of" << item.m_srcPath << "to" << item.m_destPath;
+            ret = false;
+        }
+    }
+
+    return ret;
+}
+
+bool VTransferEngine::isMoving(const QString &p_path) const
+{
+    QString path = QDir::cleanPath(p_path);
+    for (auto job : pendingJobs()) {
+        for (auto const &item : job->getItems()) {
+            if (item.m_cut && isPathWithin(path, item.m_srcPath)) {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+void VTransferEngine::startNextJob()
+{
+    while (!m_jobs.isEmpty()) {
+        QPointer<VTransferJob> job = m_jobs.dequeue();
+        if (!job) {
+            continue;
+        }
+
+        m_currentJob = job;
+        m_progressTimer->start();
+
+        VTransferJob *jobPtr = job.data();
+        QThreadPool *pool = m_copyPool;
+        m_jobWatcher->setFuture(QtConcurrent::run([jobPtr, pool]() {
+            return runJob(jobPtr, pool);
+        }));
+        return;
+    }
+}
+
+void VTransferEngine::updateProgress()
+{
+    if (m_currentJob) {
+        emit m_currentJob->progress(m_currentJob->m_doneBytes.load(),
+                                    m_currentJob->m_totalBytes.load());
+    }
+}
+
+void VTransferEngine::handleJobFinished()
+{
+    m_progressTimer->stop();
+    updateProgress();
+
+    VTransferJob *job = m_currentJob.data();
+    m_currentJob = NULL;
+    if (job) {
+        bool ret = m_jobWatcher->result();
+        qDebug() << "transfer job" << job->getTitle() << (ret ? "finished" : "failed")
+                 << job->getErrorString();
+
+        // Handlers update the configs. Coalesce their writes, which must be
+        // flushed before the next job copies any config.
+        VConfigManager::beginDirectoryConfigBatch();
+        emit job->finished(ret);
+        VConfigManager::endDirectoryConfigBatch();
+
+        job->deleteLater();
+    }
+
+    startNextJob();
+}
+
+bool VTransferEngine::runJob(VTransferJob *p_job, QThreadPool *p_pool)
+{
+    const QVector<VTransferItem> &items = p_job->getItems();
+
+    // Items moved by renaming, to be renamed back on failure.
+    QVector<VTransferItem> renamedItems;
+
+    // Items to copy, to be removed from the destination on failure.
+    QVector<VTransferItem> copiedItems;
+
+    QVector<FileTask> tasks;
+    qint64 totalBytes = 0;
+    QString errorString;
+
+    for (auto const &item : items) {
+        if (p_job->isCancelled()) {
+            errorString = tr("Cancelled.");
+            break;
+        }
+
+        if (!QFileInfo::exists(item.m_srcPath)) {
+            errorString = tr("%1 does not exist.").arg(item.m_srcPath);
+            break;
+        }
+
+        if (QFileInfo::exists(item.m_destPath)) {
+            errorString = tr("%1 already exists.").arg(item.m_destPath);
+            break;
+        }
+
+        if (!VUtils::makePath(VUtils::basePathFromPath(item.m_destPath))) {
+            errorString = tr("Fail to create folder %1.").arg(VUtils::basePathFromPath(item.m_destPath));
+            break;
+        }
+
+        // Fast path within the same file system.
+        if (item.m_cut && QDir().rename(item.m_srcPath, item.m_destPath)) {
+            renamedItems.append(item);
+            continue;
+        }
+
+        copiedItems.append(item);
+        if (!collectTasks(item.m_srcPath, item.m_destPath, tasks, totalBytes)) {
+            errorString = tr("Fail to create folder %1.").arg(item.m_destPath);
+            break;
+        }
+    }
+
+    if (errorString.isEmpty() && !tasks.isEmpty()) {
+        p_job->m_totalBytes.store(totalBytes);
+
+        // Workers pick the next task until all are done or one fails.
+        QAtomicInt nextTask(0);
+        QAtomicInt failed(0);
+        QMutex errorMutex;
+        QVector<QFuture<void>> workers;
+        int nrWorkers = qMin(c_maxParallelCopies, tasks.size());
+        for (int i = 0; i < nrWorkers; ++i) {
+            workers.append(QtConcurrent::run(p_pool, [&]() {
+                int idx;
+                while (!failed.load() && (idx = nextTask.fetchAndAddRelaxed(1)) < tasks.size()) {
+                    QString err;
+                    if (!copyFileData(tasks[idx], p_job, err)) {
+                        QMutexLocker locker(&errorMutex);
+                        if (!failed.load()) {
+                            errorString = err;
+                            failed.store(1);
+                        }
+                    }
+                }
+            }));
+        }
+
+        for (auto &worker : workers) {
+            worker.waitForFinished();
+        }
+    }
+
+    if (!errorString.isEmpty()) {
+        // Roll back.
+        for (auto const &item : copiedItems) {
+            if (QFileInfo(item.m_destPath).isDir()) {
+                QDir(item.m_destPath).removeRecursively();
+            } else {
+                QFile::remove(item.m_destPath);
+            }
+        }
+
+        for (auto const &item : renamedItems) {
+            if (!QDir().rename(item.m_destPath, item.m_srcPath)) {
+                qWarning() << "fail to move back" << item.m_destPath << "to" << item.m_srcPath;
+            }
+        }
+
+        p_job->m_errorString = errorString;
+        return false;
+    }
+
+    // Remove the sources of moves across file systems.
+    for (auto const &item : copiedItems) {
+        if (!item.m_cut) {
+            continue;
+        }
+
+        bool ret = QFileInfo(item.m_srcPath).isDir() ? QDir(item.m_srcPath).removeRecursively()
+                                                     : QFile::remove(item.m_srcPath);
+        if (!ret) {
+            qWarning() << "fail to remove" << item.m_srcPath << "after moving it";
+        }
+    }
+
+    return true;
+}
+
+bool VTransferEngine::collectTasks(const QString &p_srcPath, const QString &p_destPath,
+                                   QVector<FileTask> &p_tasks, qint64 &p_totalBytes)
+{
+    QFileInfo info(p_srcPath);
+    if (!info.isDir()) {
+        FileTask task;
+        task.m_srcPath = p_srcPath;
+        task.m_destPath = p_destPath;
+        task.m_size = info.size();
+        p_tasks.append(task);
+        p_totalBytes += task.m_size;
+        return true;
+    }
+
+    if (!QDir().mkpath(p_destPath)) {
+        qWarning() << "fail to create directory" << p_destPath;
+        return false;
+    }
+
+    QDir srcDir(p_srcPath);
+    QDir destDir(p_destPath);
+    QFileInfoList nodes = srcDir.entryInfoList(QDir::Dirs | QDir::Files | QDir::Hidden
+                                               | QDir::NoSymLinks | QDir::NoDotAndDotDot);
+    for (auto const &node : nodes) {
+        QString name = node.fileName();
+        if (!collectTasks(srcDir.filePath(name), destDir.filePath(name), p_tasks, p_totalBytes)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool VTransferEngine::copyFileData(const FileTask &p_task, VTransferJob *p_job, QString &p_errorString)
+{
+    QFile srcFile(p_task.m_srcPath);
+    if (!srcFile.open(QIODevice::ReadOnly)) {
+        p_errorString = tr("Fail to read %1.").arg(p_task.m_srcPath);
+        return false;
+    }
+
+    QFile destFile(p_task.m_destPath);
+    if (!destFile.open(QIODevice::WriteOnly)) {
+        p_errorString = tr("Fail to write %1.").arg(p_task.m_destPath);
+        return false;
+    }
+
+    destFile.setPermissions(srcFile.permissions());
+
+#if defined(Q_OS_LINUX)
+    int srcFd = srcFile.handle();
+    int destFd = destFile.handle();
+
+#if defined(FICLONE)
+    // Share the data blocks on file systems supporting it.
+    if (::ioctl(destFd, FICLONE, srcFd) == 0) {
+        p_job->m_doneBytes.fetchAndAddRelaxed(p_task.m_size);
+        return true;
+    }
+#endif
+
+#if defined(__NR_copy_file_range)
+    // Copy in kernel without going through user space.
+    qint64 copied = 0;
+    while (copied < p_task.m_size) {
+        if (p_job->isCancelled()) {
+            p_errorString = tr("Cancelled.");
+            return false;
+        }
+
+        qint64 len = qMin(c_copyChunkSize, p_task.m_size - copied);
+        long ret = ::syscall(__NR_copy_file_range, srcFd, NULL, destFd, NULL, (size_t)len, 0u);
+        if (ret <= 0) {
+            break;
+        }
+
+        copied += ret;
+        p_job->m_doneBytes.fetchAndAddRelaxed(ret);
+    }
+
+    if (copied >= p_task.m_size) {
+        return true;
+    } else if (copied > 0) {
+        p_errorString = tr("Fail to copy %1.").arg(p_task.m_srcPath);
+        return false;
+    }
+
+    // Not supported. Fall back to copy in user space.
+#endif
+#endif
+
+    QByteArray buf;
+    while (!srcFile.atEnd()) {
+        if (p_job->isCancelled()) {
+            p_errorString = tr("Cancelled.");
+            return false;
+        }
+
+        buf = srcFile.read(c_copyChunkSize);
+        if (buf.isEmpty() || destFile.write(buf) != buf.size()) {
+            p_errorString = tr("Fail to copy %1.").arg(p_task.m_srcPath);
+            return false;
+        }
+
+        p_job->m_doneBytes.fetchAndAddRelaxed(buf.size());
+    }
+
+    return true;
+}
@@ -0,0 +1,161 @@
+#ifndef VTRANSFERENGINE_H
+#define VTRANSFERENGINE_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QQueue>
+#include <QPointer>
+#include <QAtomicInt>
+#include <QAtomicInteger>
+#include <QFutureWatcher>
+
+class QTimer;
+class QThreadPool;
+
+// A file or directory to copy or move.
+struct VTransferItem
+{
+    VTransferItem() : m_cut(false)
+    {
+    }
+
+    VTransferItem(const QString &p_srcPath, const QString &p_destPath, bool p_cut)
+        : m_srcPath(p_srcPath), m_destPath(p_destPath), m_cut(p_cut)
+    {
+    }
+
+    QString m_srcPath;
+
+    // Should not exist. Its parent will be created if needed.
+    QString m_destPath;
+
+    bool m_cut;
+};
+
+// A queued transfer of several items. It succeeds only if all the items are
+// transferred. Otherwise, the transferred data is rolled back.
+class VTransferJob : public QObject
+{
+    Q_OBJECT
+public:
+    const QString &getTitle() const;
+
+    const QVector<VTransferItem> &getItems() const;
+
+    // Request to stop. The transferred data will be rolled back.
+    void cancel();
+
+    bool isCancelled() const;
+
+    // Valid after finished().
+    const QString &getErrorString() const;
+
+signals:
+    // In bytes. @p_total is 0 if it is unknown or there is nothing to copy.
+    void progress(qint64 p_done, qint64 p_total);
+
+    // Emitted in the GUI thread. The job will be deleted later.
+    void finished(bool p_succeed);
+
+private:
+    friend class VTransferEngine;
+
+    VTransferJob(const QString &p_title, const QVector<VTransferItem> &p_items,
+                 QObject *p_parent = 0);
+
+    QString m_title;
+
+    QVector<VTransferItem> m_items;
+
+    QAtomicInt m_cancelled;
+
+    QAtomicInteger<qint64> m_doneBytes;
+
+    QAtomicInteger<qint64> m_totalBytes;
+
+    QString m_errorString;
+};
+
+// Copy or move notes and folders in background.
+// Jobs are run one by one while the files of a job are copied in parallel.
+// A move within the same file system is a rename. The configs should be
+// updated only after the job finishes. The config writes of the finished jobs
+// are batched until the engine is idle or a job transferring folders starts.
+class VTransferEngine : public QObject
+{
+    Q_OBJECT
+public:
+    explicit VTransferEngine(QObject *p_parent = 0);
+
+    ~VTransferEngine();
+
+    // Queue a job to transfer @p_items. Connect to the signals of the returned
+    // job to track it.
+    VTransferJob *addJob(const QString &p_title, const QVector<VTransferItem> &p_items);
+
+    bool isBusy() const;
+
+    // Names in directory @p_dirPath to be created by the queued or running jobs.
+    QStringList reservedNames(const QString &p_dirPath) const;
+
+    // Whether @p_path or its ancestor is to be moved by the queued or running jobs.
+    bool isMoving(const QString &p_path) const;
+
+    // Whether @p_path is, contains or is within the source or destination of
+    // an item of the queued or running jobs.
+    bool isInvolved(const QString &p_path) const;
+
+    // Undo the transfer of finished job @p_job, such as when the configs could
+    // not be updated. Returns false if fail to undo some of the items.
+    static bool revert(const VTransferJob *p_job);
+
+signals:
+    void jobAdded(VTransferJob *p_job);
+
+private slots:
+    void handleJobFinished();
+
+    void updateProgress();
+
+private:
+    // A file to copy.
+    struct FileTask
+    {
+        QString m_srcPath;
+        QString m_destPath;
+        qint64 m_size;
+    };
+
+    void startNextJob();
+
+    // Get the queued and running jobs.
+    QVector<const VTransferJob *> pendingJobs() const;
+
+    // Run @p_job in a worker thread, copying files in @p_pool.
+    static bool runJob(VTransferJob *p_job, QThreadPool *p_pool);
+
+    // Create directories and collect the files to copy @p_srcPath to @p_destPath.
+    static bool collectTasks(const QString &p_srcPath, const QString &p_destPath,
+                             QVector<FileTask> &p_tasks, qint64 &p_totalBytes);
+
+    // Copy the data of a file, using a reflink or in-kernel copy if available.
+    static bool copyFileData(const FileTask &p_task, VTransferJob *p_job, QString &p_errorString);
+
+    QQueue<QPointer<VTransferJob>> m_jobs;
+
+    QPointer<VTransferJob> m_currentJob;
+
+    QFutureWatcher<bool> *m_jobWatcher;
+
+    // Poll the progress of current job.
+    QTimer *m_progressTimer;
+
+    QThreadPool *m_copyPool;
+
+    // Max number of files copied concurrently.
+    static const int c_maxParallelCopies;
+};
+
+#endif // VTRANSFERENGINE_H
@@ -0,0 +1,254 @@
+#include "vundohistory.h"
+
+#include <QTextDocument>
+#include <QTextCursor>
+#include <QDateTime>
+#include <QDebug>
+#include "utils/veditutils.h"
+
+const int VUndoHistory::c_mergeInterval = 1000;
+
+VUndoHistory::VUndoHistory(QTextDocument *p_doc, QObject *p_parent)
+    : QObject(p_parent), m_doc(p_doc), m_index(0), m_cleanIndex(0),
+      m_bytes(0), m_maxSteps(0), m_maxBytes(0), m_lastTime(0),
+      m_applying(false), m_revision(0)
+{
+    reset();
+}
+
+void VUndoHistory::setLimits(int p_maxSteps, qint64 p_maxBytes)
+{
+    m_maxSteps = p_maxSteps;
+    m_maxBytes = p_maxBytes;
+    trim();
+}
+
+void VUndoHistory::handleContentsChange(int p_position, int p_charsRemoved, int p_charsAdded)
+{
+    Q_UNUSED(p_charsAdded);
+
+    // The reported range may cover the whole document including the last
+    // paragraph separator, so derive the added length from the new size.
+    int size = m_doc->characterCount() - 1;
+    int pos = qMin(p_position, m_text.size());
+    int removed = qMin(p_charsRemoved, m_text.size() - pos);
+    int added = size - (m_text.size() - removed);
+    if (removed < 0 || added < 0 || pos + added > size) {
+        qWarning() << "undo history out of sync with the document, reset it";
+        reset();
+        return;
+    }
+
+    QTextCursor cursor(m_doc);
+    cursor.setPosition(pos);
+    cursor.setPosition(pos + added, QTextCursor::KeepAnchor);
+    QString addedText = VEditUtils::selectedText(cursor);
+
+    // Trim the common prefix and suffix, such as the whole block of a format
+    // change.
+    int prefix = 0;
+    while (prefix < removed && prefix < added
+           && m_text[pos + prefix] == addedText[prefix]) {
+        ++prefix;
+    }
+
+    int suffix = 0;
+    while (suffix < removed - prefix && suffix < added - prefix
+           && m_text[pos + removed - 1 - suffix] == addedText[added - 1 - suffix]) {
+        ++suffix;
+    }
+
+    if (prefix + suffix == removed && prefix + suffix == added) {
+        return;
+    }
+
+    Change change;
+    change.m_position = pos + prefix;
+    change.m_removed = m_text.mid(change.m_position, removed - prefix - suffix);
+    change.m_added = addedText.mid(prefix, added - prefix - suffix);
+
+    m_text.replace(change.m_position, change.m_removed.size(), change.m_added);
+    ++m_revision;
+
+    if (m_applying) {
+        return;
+    }
+
+    record(change);
+}
+
+bool VUndoHistory::canUndo() const
+{
+    return m_index > 0;
+}
+
+bool VUndoHistory::canRedo() const
+{
+    return m_index < m_changes.size();
+}
+
+int VUndoHistory::undo()
+{
+    if (!canUndo()) {
+        return -1;
+    }
+
+    Change change = m_changes[--m_index];
+    replace(change.m_position, change.m_added.size(), change.m_removed);
+
+    // Do not merge new typing into the step before.
+    m_lastTime = 0;
+    return change.m_position + change.m_removed.size();
+}
+
+int VUndoHistory::redo()
+{
+    if (!canRedo()) {
+        return -1;
+    }
+
+    Change change = m_changes[m_index++];
+    replace(change.m_position, change.m_removed.size(), change.m_added);
+
+    m_lastTime = 0;
+    return change.m_position + change.m_added.size();
+}
+
+void VUndoHistory::reset()
+{
+    QTextCursor cursor(m_doc);
+    cursor.movePosition(QTextCursor::End, QTextCursor::KeepAnchor);
+    m_text = VEditUtils::selectedText(cursor);
+
+    m_changes.clear();
+    m_index = 0;
+    m_cleanIndex = 0;
+    m_bytes = 0;
+    m_lastTime = 0;
+    ++m_revision;
+}
+
+bool VUndoHistory::isClean() const
+{
+    return m_cleanIndex == m_index;
+}
+
+void VUndoHistory::markClean()
+{
+    m_cleanIndex = m_index;
+}
+
+int VUndoHistory::undoSteps() const
+{
+    return m_index;
+}
+
+qint64 VUndoHistory::bytes() const
+{
+    return m_bytes;
+}
+
+int VUndoHistory::revision() const
+{
+    return m_revision;
+}
+
+void VUndoHistory::record(const Change &p_change)
+{
+    // Drop the steps to redo.
+    while (m_changes.size() > m_index) {
+        m_bytes -= sizeOfChange(m_changes.last());
+        m_changes.removeLast();
+    }
+
+    if (m_cleanIndex > m_index) {
+        m_cleanIndex = -1;
+    }
+
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    bool merged = false;
+    if (m_index > 0 && m_cleanIndex != m_index && now - m_lastTime < c_mergeInterval) {
+        Change &last = m_changes.last();
+        qint64 oldSize = sizeOfChange(last);
+        merged = mergeChange(last, p_change);
+        if (merged) {
+            m_bytes += sizeOfChange(last) - oldSize;
+        }
+    }
+
+    if (!merged) {
+        m_changes.append(p_change);
+        m_bytes += sizeOfChange(p_change);
+        ++m_index;
+    }
+
+    m_lastTime = now;
+    trim();
+}
+
+void VUndoHistory::replace(int p_position, int p_len, const QString &p_text)
+{
+    m_applying = true;
+
+    QTextCursor cursor(m_doc);
+    cursor.setPosition(p_position);
+    cursor.setPosition(p_position + p_len, QTextCursor::KeepAnchor);
+    cursor.insertText(p_text);
+
+    m_applying = false;
+}
+
+void VUndoHistory::dropFirst(int p_count)
+{
+    for (int i = 0; i < p_count; ++i) {
+        m_bytes -= sizeOfChange(m_changes.first());
+        m_changes.removeFirst();
+    }
+
+    m_index -= p_count;
+    m_cleanIndex = m_cleanIndex >= p_count ? m_cleanIndex - p_count : -1;
+}
+
+void VUndoHistory::trim()
+{
+    // Keep the latest step anyway.
+    while (m_index > 1
+           && ((m_maxSteps > 0 && m_changes.size() > m_maxSteps)
+               || (m_maxBytes > 0 && m_bytes > m_maxBytes))) {
+        dropFirst(1);
+    }
+}
+
+qint64 VUndoHistory::sizeOfChange(const Change &p_change)
+{
+    return sizeof(Change)
+           + (p_change.m_removed.size() + p_change.m_added.size()) * sizeof(QChar);
+}
+
+bool VUndoHistory::mergeChange(Change &p_last, const Change &p_change)
+{
+    if (p_change.m_removed.isEmpty() && p_change.m_added.size() == 1) {
+        // Typing right after the last step. A new line starts a new step.
+        if (p_change.m_added[0] != '\n'
+            && !p_last.m_added.isEmpty()
+            && !p_last.m_added.endsWith('\n')
+            && p_change.m_position == p_last.m_position + p_last.m_added.size()) {
+            p_last.m_added.append(p_change.m_added);
+            return true;
+        }
+    } else if (p_change.m_added.isEmpty() && p_change.m_removed.size() == 1
+               && p_last.m_added.isEmpty()) {
+        if (p_change.m_position + 1 == p_last.m_position) {
+            // Backspace.
+            p_last.m_removed.prepend(p_change.m_removed);
+            p_last.m_position = p_change.m_position;
+            return true;
+        } else if (p_change.m_position == p_last.m_position) {
+            // Delete.
+            p_last.m_removed.append(p_change.m_removed);
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,116 @@
+#ifndef VUNDOHISTORY_H
+#define VUNDOHISTORY_H
+
+#include <QObject>
+#include <QString>
+#include <QList>
+
+class QTextDocument;
+
+// Bounded undo history of the plain text of a QTextDocument, whose own undo
+// stack should be disabled.
+// Each change is recorded as a replacement with the common prefix and suffix
+// trimmed. Consecutive typing and deleting are merged into one step. The
+// oldest steps are dropped once the budget of steps or bytes is exceeded.
+class VUndoHistory : public QObject
+{
+    Q_OBJECT
+public:
+    VUndoHistory(QTextDocument *p_doc, QObject *p_parent = 0);
+
+    // @p_maxSteps, @p_maxBytes: 0 for no limit.
+    void setLimits(int p_maxSteps, qint64 p_maxBytes);
+
+    // Should be called on each QTextDocument::contentsChange() before any
+    // other handler which depends on revision().
+    void handleContentsChange(int p_position, int p_charsRemoved, int p_charsAdded);
+
+    bool canUndo() const;
+
+    bool canRedo() const;
+
+    // Undo or redo one step and return the cursor position after it.
+    // Returns -1 if there is nothing to undo or redo.
+    int undo();
+
+    int redo();
+
+    // Clear the history and take a snapshot of current content.
+    void reset();
+
+    // Whether current content is at the step marked by markClean().
+    bool isClean() const;
+
+    void markClean();
+
+    // Number of the steps to undo.
+    int undoSteps() const;
+
+    // Memory used by the history in bytes.
+    qint64 bytes() const;
+
+    // Increased on each change of the text, including undoing and redoing.
+    int revision() const;
+
+private:
+    struct Change
+    {
+        Change() : m_position(0)
+        {
+        }
+
+        // Position of the replacement.
+        int m_position;
+
+        // Text before and after the change.
+        QString m_removed;
+        QString m_added;
+    };
+
+    // Push a change made by user.
+    void record(const Change &p_change);
+
+    // Replace @p_len characters at @p_position with @p_text without recording.
+    void replace(int p_position, int p_len, const QString &p_text);
+
+    // Drop the first @p_count steps.
+    void dropFirst(int p_count);
+
+    // Drop the oldest steps until the budget is met.
+    void trim();
+
+    static qint64 sizeOfChange(const Change &p_change);
+
+    // Try to merge typing or deleting @p_change into @p_last.
+    static bool mergeChange(Change &p_last, const Change &p_change);
+
+    QTextDocument *m_doc;
+
+    // Snapshot of the plain text to get the removed text of a change.
+    QString m_text;
+
+    // Changes [0, m_index) could be undone and the rest could be redone.
+    QList<Change> m_changes;
+    int m_index;
+
+    // m_index of the clean state, -1 if it is not reachable.
+    int m_cleanIndex;
+
+    qint64 m_bytes;
+
+    int m_maxSteps;
+    qint64 m_maxBytes;
+
+    // Time of the last recorded change in ms, to merge typing.
+    qint64 m_lastTime;
+
+    // Whether it is undoing or redoing.
+    bool m_applying;
+
+    int m_revision;
+
+    // Typing within this interval in ms could be merged.
+    static const int c_mergeInterval;
+};
+
+#endif // VUNDOHISTORY_H
@@ -0,0 +1,231 @@
+#include "vunusedimagecollector.h"
+
+#include <QtConcurrent>
+#include <QDirIterator>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QUrl>
+#include <QDebug>
+#include "vnotebook.h"
+#include "utils/vutils.h"
+
+VUnusedImageCollector::VUnusedImageCollector(QObject *p_parent)
+    : QObject(p_parent), m_dryRun(true)
+{
+    m_listWatcher = new QFutureWatcher<NotebookFiles>(this);
+    connect(m_listWatcher, &QFutureWatcher<NotebookFiles>::finished,
+            this, &VUnusedImageCollector::handleListFinished);
+
+    m_scanWatcher = new QFutureWatcher<QSet<QString>>(this);
+    connect(m_scanWatcher, &QFutureWatcher<QSet<QString>>::finished,
+            this, &VUnusedImageCollector::handleScanFinished);
+    connect(m_scanWatcher, &QFutureWatcher<QSet<QString>>::progressValueChanged,
+            this, [this](int p_value) {
+                emit progressChanged(p_value, m_scanWatcher->progressMaximum());
+            });
+
+    m_deleteWatcher = new QFutureWatcher<QString>(this);
+    connect(m_deleteWatcher, &QFutureWatcher<QString>::finished,
+            this, &VUnusedImageCollector::handleDeleteFinished);
+    connect(m_deleteWatcher, &QFutureWatcher<QString>::progressValueChanged,
+            this, [this](int p_value) {
+                emit progressChanged(p_value, m_deleteWatcher->progressMaximum());
+            });
+}
+
+VUnusedImageCollector::~VUnusedImageCollector()
+{
+    cancel();
+
+    m_listWatcher->waitForFinished();
+    m_scanWatcher->waitForFinished();
+    m_deleteWatcher->waitForFinished();
+}
+
+bool VUnusedImageCollector::collect(const VNotebook *p_notebook, bool p_dryRun)
+{
+    if (isRunning()) {
+        return false;
+    }
+
+    m_dryRun = p_dryRun;
+    m_images.clear();
+
+    emit progressChanged(0, 0);
+
+    m_listWatcher->setFuture(QtConcurrent::run(&VUnusedImageCollector::listNotebookFiles,
+                                               p_notebook->getPath(),
+                                               p_notebook->getImageFolder()));
+    return true;
+}
+
+bool VUnusedImageCollector::deleteImages(const QStringList &p_images)
+{
+    if (isRunning()) {
+        return false;
+    }
+
+    m_images = p_images;
+    m_deleteWatcher->setFuture(QtConcurrent::filtered(m_images,
+                                                      &VUnusedImageCollector::deleteFile));
+    return true;
+}
+
+void VUnusedImageCollector::cancel()
+{
+    // Listing could not be cancelled. It will be checked when it finishes.
+    m_listWatcher->cancel();
+    m_scanWatcher->cancel();
+    m_deleteWatcher->cancel();
+}
+
+bool VUnusedImageCollector::isRunning() const
+{
+    return m_listWatcher->isRunning()
+           || m_scanWatcher->isRunning()
+           || m_deleteWatcher->isRunning();
+}
+
+void VUnusedImageCollector::handleListFinished()
+{
+    if (m_listWatcher->isCanceled()) {
+        emit cancelled();
+        return;
+    }
+
+    NotebookFiles files = m_listWatcher->result();
+    m_images = files.m_images;
+    if (m_images.isEmpty()) {
+        emit finished(QStringList(), false);
+        return;
+    }
+
+    qDebug() << "scan" << files.m_notes.size() << "notes for"
+             << m_images.size() << "images";
+
+    m_scanWatcher->setFuture(QtConcurrent::mappedReduced(files.m_notes,
+                                                         &VUnusedImageCollector::fetchNoteImages,
+                                                         &VUnusedImageCollector::mergeImages,
+                                                         QtConcurrent::UnorderedReduce));
+}
+
+void VUnusedImageCollector::handleScanFinished()
+{
+    if (m_scanWatcher->isCanceled()) {
+        m_images.clear();
+        emit cancelled();
+        return;
+    }
+
+    // A note without any image will not contribute a result.
+    QSet<QString> usedImages;
+    if (m_scanWatcher->future().resultCount() > 0) {
+        usedImages = m_scanWatcher->result();
+    }
+
+    QStringList unusedImages;
+    for (auto const &image : m_images) {
+        if (!usedImages.contains(imagePathKey(image))) {
+            unusedImages.append(image);
+        }
+    }
+
+    qDebug() << "found" << unusedImages.size() << "unused images of"
+             << m_images.size() << "images";
+
+    if (m_dryRun || unusedImages.isEmpty()) {
+        m_images.clear();
+        emit finished(unusedImages, false);
+        return;
+    }
+
+    m_images = unusedImages;
+    m_deleteWatcher->setFuture(QtConcurrent::filtered(m_images,
+                                                      &VUnusedImageCollector::deleteFile));
+}
+
+void VUnusedImageCollector::handleDeleteFinished()
+{
+    // Report the deleted ones even if it is cancelled.
+    QStringList deleted = m_deleteWatcher->future().results();
+    qDebug() << "deleted" << deleted.size() << "unused images of" << m_images.size();
+
+    m_images.clear();
+    emit finished(deleted, true);
+}
+
+VUnusedImageCollector::NotebookFiles VUnusedImageCollector::listNotebookFiles(const QString &p_rootPath,
+                                                                              const QString &p_imageFolder)
+{
+    NotebookFiles files;
+
+    QDirIterator it(p_rootPath,
+                    QDir::Files | QDir::Hidden | QDir::NoSymLinks,
+                    QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        QString filePath = QDir::cleanPath(it.next());
+        QFileInfo info = it.fileInfo();
+        if (info.dir().dirName() == p_imageFolder) {
+            files.m_images.append(filePath);
+            continue;
+        }
+
+        QString suffix = info.suffix().toLower();
+        if (suffix == "md" || suffix == "markdown" || suffix == "mkd") {
+            files.m_notes.append(filePath);
+        }
+    }
+
+    return files;
+}
+
+QSet<QString> VUnusedImageCollector::fetchNoteImages(const QString &p_notePath)
+{
+    QSet<QString> images;
+    QString text = VUtils::readFileFromDisk(p_notePath);
+    if (text.isEmpty()) {
+        return images;
+    }
+
+    QDir baseDir(VUtils::basePathFromPath(p_notePath));
+    QStringList urls = VUtils::fetchImageUrlsFromMarkdownText(text);
+    for (auto const &url : urls) {
+        // Only local images matter. No need to check existence here.
+        // Links may be percent-encoded, such as %20 for spaces. Keep the raw
+        // one too in case the file name contains a literal %.
+        images.insert(imagePathKey(baseDir.absoluteFilePath(url)));
+
+        QString decodedUrl = QUrl::fromPercentEncoding(url.toUtf8());
+        if (decodedUrl != url) {
+            images.insert(imagePathKey(baseDir.absoluteFilePath(decodedUrl)));
+        }
+    }
+
+    return images;
+}
+
+QString VUnusedImageCollector::imagePathKey(const QString &p_path)
+{
+    QString path = QDir::cleanPath(p_path);
+#if defined(Q_OS_WIN) || defined(Q_OS_MACOS) || defined(Q_OS_MAC)
+    // Case-insensitive file systems.
+    path = path.toLower();
+#endif
+    return path;
+}
+
+void VUnusedImageCollector::mergeImages(QSet<QString> &p_result, const QSet<QString> &p_images)
+{
+    p_result.unite(p_images);
+}
+
+bool VUnusedImageCollector::deleteFile(const QString &p_file)
+{
+    if (QFile::remove(p_file)) {
+        return true;
+    }
+
+    qWarning() << "fail to delete unused image" << p_file;
+    return false;
+}
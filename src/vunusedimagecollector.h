@@ -0,0 +1,89 @@
+#ifndef VUNUSEDIMAGECOLLECTOR_H
+#define VUNUSEDIMAGECOLLECTOR_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QSet>
+#include <QFutureWatcher>
+
+class VNotebook;
+
+// Collect images within the image folders of a notebook which are not
+// referenced by any note of the notebook.
+// All the disk operations are done in background threads.
+class VUnusedImageCollector : public QObject
+{
+    Q_OBJECT
+public:
+    explicit VUnusedImageCollector(QObject *p_parent = 0);
+
+    ~VUnusedImageCollector();
+
+    // Start to collect unused images of @p_notebook.
+    // If @p_dryRun is false, delete the unused images after collection.
+    // Returns false if it is busy.
+    bool collect(const VNotebook *p_notebook, bool p_dryRun);
+
+    // Delete @p_images in background.
+    // Returns false if it is busy.
+    bool deleteImages(const QStringList &p_images);
+
+    void cancel();
+
+    bool isRunning() const;
+
+signals:
+    // @p_total is 0 if it is not known yet.
+    void progressChanged(int p_value, int p_total);
+
+    // Collection or deletion is finished.
+    // @p_images: unused images found, or images deleted if @p_deleted is true.
+    void finished(const QStringList &p_images, bool p_deleted);
+
+    // Collection or deletion is cancelled.
+    void cancelled();
+
+private slots:
+    void handleListFinished();
+    void handleScanFinished();
+    void handleDeleteFinished();
+
+private:
+    // Notes and images of a notebook on disk.
+    struct NotebookFiles
+    {
+        // Absolute paths of all the Markdown files.
+        QStringList m_notes;
+
+        // Absolute clean paths of all the files within image folders.
+        QStringList m_images;
+    };
+
+    // List notes and images under @p_rootPath.
+    static NotebookFiles listNotebookFiles(const QString &p_rootPath,
+                                           const QString &p_imageFolder);
+
+    // Fetch the keys of the local images referenced by note @p_notePath.
+    static QSet<QString> fetchNoteImages(const QString &p_notePath);
+
+    // Get the key of @p_path to compare paths of images. It is clean and
+    // lower case on case-insensitive file systems.
+    static QString imagePathKey(const QString &p_path);
+
+    static void mergeImages(QSet<QString> &p_result, const QSet<QString> &p_images);
+
+    // Returns true if @p_file is deleted.
+    static bool deleteFile(const QString &p_file);
+
+    QFutureWatcher<NotebookFiles> *m_listWatcher;
+    QFutureWatcher<QSet<QString>> *m_scanWatcher;
+    QFutureWatcher<QString> *m_deleteWatcher;
+
+    // Images found in current collection.
+    QStringList m_images;
+
+    bool m_dryRun;
+};
+
+#endif // VUNUSEDIMAGECOLLECTOR_H